@@ -43,3 +43,104 @@ export class FrameUpdateManager {
     return true;
   }
 }
+
+/**
+ * Dirty rects from frame-update messages, kept per frame number until a
+ * search of a frame no longer needs them.
+ *
+ * A search that reuses results from an earlier frame must be given every
+ * change between the two. Messages arrive after their frame is readable, and
+ * one numbered N carries the changes since the previous message through
+ * frame N. take() therefore only returns rects when the log holds every
+ * change since the last searched frame through the one being searched;
+ * otherwise it returns null and the caller searches the whole frame.
+ */
+export class DirtyRectLog {
+  constructor(maxRects = 256) {
+    this.maxRects = maxRects;
+    this.entries = [];
+    this.rectCount = 0;
+    this.receivedFrameNumber = 0;
+    // Every change to frames after this number is in the log (null: none).
+    this.coveredAfter = null;
+    // The frame the last search ran on (null: unknown, or it failed).
+    this.searchedFrameNumber = null;
+  }
+
+  /**
+   * Records a frame-update message's rects.
+   * @param {number} frameNumber - The message's frameNumber.
+   * @param {Array<object>} rects - Its dirtyRects.
+   */
+  add(frameNumber, rects = []) {
+    if (!frameNumber || frameNumber <= this.receivedFrameNumber) {
+      // Unnumbered, or the capture restarted its numbering: nothing before
+      // this is usable.
+      this.entries.length = 0;
+      this.rectCount = 0;
+      this.coveredAfter = null;
+      this.receivedFrameNumber = 0;
+      if (!frameNumber) return;
+    }
+    this.receivedFrameNumber = frameNumber;
+    if (this.coveredAfter === null || this.rectCount + rects.length > this.maxRects) {
+      // Frames up to this message may have changed where no entry says so.
+      this.entries.length = 0;
+      this.rectCount = 0;
+      this.coveredAfter = frameNumber;
+      return;
+    }
+    this.entries.push({ frameNumber, rects });
+    this.rectCount += rects.length;
+  }
+
+  /**
+   * Called as a search of `frameNumber` starts. Returns the rects changed
+   * since the last searched frame, or null when the search must cover the
+   * whole frame.
+   * @param {number|null} frameNumber - The frame being searched.
+   * @param {number|null} postedFrameNumber - frameSource.postedFrameNumber().
+   * @returns {Array<object>|null}
+   */
+  take(frameNumber, postedFrameNumber) {
+    const previous = this.searchedFrameNumber;
+    this.searchedFrameNumber = frameNumber || null;
+    if (!frameNumber) return null;
+    const reached = Math.min(frameNumber, postedFrameNumber ?? frameNumber);
+    const complete =
+      previous !== null &&
+      this.coveredAfter !== null &&
+      this.coveredAfter <= previous &&
+      previous <= frameNumber &&
+      this.receivedFrameNumber >= reached;
+
+    let rects = null;
+    if (complete) {
+      rects = [];
+      for (const entry of this.entries) {
+        rects.push(...entry.rects);
+        // It may also carry changes to later frames; those are not searched
+        // here, which only makes this search look at more than it must.
+        if (entry.frameNumber >= frameNumber) break;
+      }
+    }
+
+    // Entries through this frame are spent; one that reaches past it still
+    // covers later frames and stays.
+    let spent = 0;
+    while (spent < this.entries.length && this.entries[spent].frameNumber <= frameNumber) {
+      this.rectCount -= this.entries[spent].rects.length;
+      spent++;
+    }
+    this.entries.splice(0, spent);
+    if (this.coveredAfter !== null) {
+      this.coveredAfter = Math.max(this.coveredAfter, frameNumber);
+    }
+    return rects;
+  }
+
+  /** The last search failed: the next one covers the whole frame. */
+  forget() {
+    this.searchedFrameNumber = null;
+  }
+}
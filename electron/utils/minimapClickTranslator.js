@@ -5,7 +5,8 @@ const MINIMAP_HEIGHT = 109; // From preprocessMinimaps.js
  * Translates global minimap coordinates to absolute screen coordinates for clicking.
  * @param {number} targetMapX - The target X coordinate on the global minimap.
  * @param {number} targetMapY - The target Y coordinate on the global minimap.
- * @param {{x: number, y: number, z: number}} playerMinimapPosition - The player's current position on the global minimap.
+ * @param {{x: number, y: number, z: number, zoomScale?: number}} playerMinimapPosition - The player's current position on the global minimap.
+ *   zoomScale is the minimap zoom the position was found at (screen pixels per tile, 1 when absent).
  * @param {{x: number, y: number, width: number, height: number}} minimapRegionDef - The screen coordinates and dimensions of the visible minimap.
  * @returns {{x: number, y: number}|null} The absolute screen coordinates for the click, or null if inputs are invalid.
  */
@@ -22,11 +23,13 @@ export function getAbsoluteClickCoordinates(
     return null;
   }
 
-  // Calculate relative pixel position on the visible minimap
+  // Calculate relative pixel position on the visible minimap. The player sits
+  // at its centre pixel; when zoomed in every tile spans zoomScale pixels.
+  const zoomScale = playerMinimapPosition.zoomScale || 1;
   const relativePixelX =
-    targetMapX - playerMinimapPosition.x + MINIMAP_WIDTH / 2;
+    (targetMapX - playerMinimapPosition.x) * zoomScale + MINIMAP_WIDTH / 2;
   const relativePixelY =
-    targetMapY - playerMinimapPosition.y + MINIMAP_HEIGHT / 2;
+    (targetMapY - playerMinimapPosition.y) * zoomScale + MINIMAP_HEIGHT / 2;
 
   // Bounds check: Ensure the calculated relative pixel is within the visible minimap area
   if (
@@ -2,6 +2,7 @@ import fs from 'fs/promises';
 import path from 'path';
 import { createLogger } from './logger.js';
 import MinimapMatcherNative from 'minimap_matcher-native';
+import { PALETTE_DATA } from '../constants/palette.js';
 
 const logger = createLogger({ info: false, error: true, debug: false });
 
@@ -50,6 +51,7 @@ class MinimapMatcher {
         LANDMARK_SIZE,
         LANDMARK_PATTERN_BYTES,
         EXCLUDED_COLORS_RGB,
+        PALETTE_RGB: PALETTE_DATA,
       });
     } catch (error) {
       logger(
@@ -164,6 +166,37 @@ class MinimapMatcher {
       targetZ,
     );
 
+    return this._trackResult(resultPromise, targetZ);
+  }
+
+  /**
+   * Finds the player position straight from a raw capture frame.
+   * The native module maps the minimap region's BGRA pixels to palette
+   * indices itself, so no JS conversion loop or region copy is needed.
+   * @param {Buffer} frameBuffer - The capture buffer (8-byte header + BGRA).
+   * @param {number} frameWidth - Width of the full captured frame.
+   * @param {object} minimapRegion - The {x, y, width, height} of the minimap.
+   * @param {number} targetZ
+   * @returns {Promise<object|null>} A promise that resolves with the result object.
+   */
+  async findPositionInFrame(frameBuffer, frameWidth, minimapRegion, targetZ) {
+    if (!this.isLoaded) {
+      throw new Error(
+        'MinimapMatcher is not loaded. Call loadMapData() first.',
+      );
+    }
+
+    const resultPromise = this.nativeMatcher.findPositionInFrame(
+      frameBuffer,
+      frameWidth,
+      minimapRegion,
+      targetZ,
+    );
+
+    return this._trackResult(resultPromise, targetZ);
+  }
+
+  _trackResult(resultPromise, targetZ) {
     resultPromise
       .then((result) => {
         if (result && result.position) {
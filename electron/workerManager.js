@@ -23,6 +23,8 @@ import {
 
 // NEW: Unified SAB State Management
 import { SABState, CONTROL_STATES } from './workers/sabState/index.js';
+import { FRAME_RING_SLOTS } from './workers/capture/config.js';
+import { frameRingByteLength } from './workers/capture/frameRing.js';
 
 const log = createLogger();
 
@@ -221,7 +223,9 @@ class WorkerManager {
     const imageSAB_A = new SharedArrayBuffer(maxImageSize + 8); // +8 for width/height header
     const imageSAB_B = new SharedArrayBuffer(maxImageSize + 8);
     const MAX_DIRTY_REGIONS = 100;
-    const SYNC_BUFFER_SIZE = 6 + 1 + MAX_DIRTY_REGIONS * 4; // +1 for READABLE_BUFFER_INDEX
+    // +1 for READABLE_BUFFER_INDEX, +4 for the frame numbers (two buffers,
+    // drained, posted)
+    const SYNC_BUFFER_SIZE = 6 + 1 + MAX_DIRTY_REGIONS * 4 + 4;
     const syncSAB = new SharedArrayBuffer(
       SYNC_BUFFER_SIZE * Int32Array.BYTES_PER_ELEMENT,
     );
@@ -246,6 +250,13 @@ class WorkerManager {
     const targetSAB = new SharedArrayBuffer(
       TARGET_SAB_SIZE * Int32Array.BYTES_PER_ELEMENT,
     );
+    // Optional zero-copy frame ring written directly by the native capture.
+    const frameRingSAB =
+      FRAME_RING_SLOTS > 0
+        ? new SharedArrayBuffer(
+            frameRingByteLength(FRAME_RING_SLOTS, 3840, 2160),
+          )
+        : null;
 
     this.sharedData = {
       imageSAB_A,
@@ -258,6 +269,7 @@ class WorkerManager {
       lootingSAB,
       targetingListSAB,
       targetSAB,
+      frameRingSAB,
     };
     log('info', '[Worker Manager] Created SharedArrayBuffers.');
     
@@ -421,6 +433,7 @@ class WorkerManager {
             x: playerPosResult.data.x,
             y: playerPosResult.data.y,
             z: playerPosResult.data.z,
+            zoomScale: playerPosResult.data.zoomScale || 1,
           };
           hasUpdates = true;
         }
@@ -1,5 +1,35 @@
 export const TARGET_FPS = 60;
 
+// 'timer' grabs every 1/TARGET_FPS. 'damage' grabs right after the game draws
+// (XDamage on the window), with TARGET_FPS only as a cap; idle frames are skipped.
+export const PACING_MODE = 'timer';
+
+// Slots in the SharedArrayBuffer frame ring the native capture writes into
+// directly (see capture/frameRing.js). 0 keeps the copy-based double buffer.
+export const FRAME_RING_SLOTS = 0;
+
+// Window sub-rectangles captured at their own rate, e.g.
+// { x: 0, y: 0, width: 200, height: 40, fps: 120 }. When any are registered the
+// native thread only grabs due regions instead of the whole window; leave empty
+// to capture the full window at TARGET_FPS.
+export const CAPTURE_REGIONS = [];
+
+// Dirty tracking. 'rects' coalesces changed spans into rects. 'tiles' tracks a
+// fixed DIFF_TILE_SIZE grid instead (multiple of 8), which costs the same every
+// frame and never allocates; getLatestFrame then also returns `dirtyTiles`.
+// 'fused' is 'tiles' with copy, diff and per-tile content hashes done in one
+// streaming pass (see getTileHashes()).
+export const DIFF_MODE = 'rects';
+export const DIFF_TILE_SIZE = 16;
+
+// Downscaled luma plane kept next to each frame (2 or 4; 0 disables). Read it
+// with getLumaPlane() when full-resolution BGRA is not needed.
+export const LUMA_PLANE_SCALE = 0;
+
+// When set, every captured frame is also streamed to this file for offline
+// replay (FrameReplay, tools/benchmark_native_modules.cjs --recording=).
+export const RECORDING_PATH = '';
+
 // --- SharedArrayBuffer (SAB) Indices ---
 export const FRAME_COUNTER_INDEX = 0;
 export const WIDTH_INDEX = 1;
@@ -13,3 +43,17 @@ export const DIRTY_REGIONS_START_INDEX = 7;
 // --- Capture Limits ---
 // This must match the value used when creating the SharedArrayBuffer
 export const MAX_DIRTY_REGIONS = 100;
+
+// Double buffer mode: the frame number held by image buffer A and B (two
+// words, after the dirty regions). 0 while the buffer is being written. It is
+// the number frame-update messages carry, so readers can tell whether the
+// dirty rects they received reach the frame they read.
+export const BUFFER_FRAME_NUMBER_INDEX =
+  DIRTY_REGIONS_START_INDEX + MAX_DIRTY_REGIONS * 4;
+
+// The frame number every change up to which has been handed to frame-update
+// messages, and the number of the latest frame-update message posted. A
+// reader that has received that message, or a message numbered at least as
+// high as its frame, holds every dirty rect up to its frame.
+export const DRAINED_FRAME_NUMBER_INDEX = BUFFER_FRAME_NUMBER_INDEX + 2;
+export const POSTED_FRAME_NUMBER_INDEX = BUFFER_FRAME_NUMBER_INDEX + 3;
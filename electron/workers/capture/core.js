@@ -10,7 +10,7 @@ import { PerformanceTracker } from './performanceTracker.js';
 const { sharedData, display } = workerData;
 if (!sharedData) throw new Error('[CaptureCore] Shared data not provided.');
 
-const { imageSAB_A, imageSAB_B, syncSAB } = sharedData;
+const { imageSAB_A, imageSAB_B, syncSAB, frameRingSAB } = sharedData;
 const syncArray = new Int32Array(syncSAB);
 // Double buffering: maintain 2 buffers, write to inactive one
 const imageBuffers = [
@@ -60,7 +60,27 @@ async function captureLoop() {
   }
 
   try {
+    if (frameRingSAB) {
+      // Native capture publishes straight into the shared ring; no per-frame copy.
+      captureInstance.attachFrameRing(
+        Buffer.from(frameRingSAB),
+        config.FRAME_RING_SLOTS,
+      );
+    }
+    captureInstance.setPacingMode(config.PACING_MODE);
+    if (config.DIFF_MODE !== 'rects') {
+      captureInstance.setDiffMode(config.DIFF_MODE, config.DIFF_TILE_SIZE);
+    }
+    if (config.LUMA_PLANE_SCALE) {
+      captureInstance.setLumaPlane(config.LUMA_PLANE_SCALE);
+    }
+    if (config.RECORDING_PATH) {
+      captureInstance.startRecording(config.RECORDING_PATH);
+    }
     captureInstance.startMonitorInstance(windowId, config.TARGET_FPS);
+    for (const { fps, ...rect } of config.CAPTURE_REGIONS) {
+      captureInstance.addCaptureRegion(rect, fps);
+    }
     isCapturing = true;
     console.log(
       `[CaptureCore] Started monitoring window: ${windowId} at ${config.TARGET_FPS} FPS.`,
@@ -80,9 +100,19 @@ async function captureLoop() {
     const loopStartTime = performance.now();
 
     try {
-      // Double buffering: write to the INACTIVE buffer (readers use the other one)
+      // Double buffering: write to the INACTIVE buffer (readers use the other one).
+      // In ring mode the frame is already shared; only metadata is fetched.
       const writeBuffer = imageBuffers[writeBufferIndex];
-      const frameResult = captureInstance.getLatestFrame(writeBuffer);
+      if (!frameRingSAB) {
+        Atomics.store(
+          syncArray,
+          config.BUFFER_FRAME_NUMBER_INDEX + writeBufferIndex,
+          0,
+        );
+      }
+      const frameResult = frameRingSAB
+        ? captureInstance.getLatestFrame()
+        : captureInstance.getLatestFrame(writeBuffer);
 
       if (frameResult) {
         // --- START OF SYNCHRONIZED UPDATE ---
@@ -117,13 +147,26 @@ async function captureLoop() {
         Atomics.store(syncArray, config.WIDTH_INDEX, frameResult.width);
         Atomics.store(syncArray, config.HEIGHT_INDEX, frameResult.height);
 
+        // The number frame-update messages carry: the ring frame the dirty
+        // rects reach, or the frame counter this frame is published under.
+        const frameNumber = frameRingSAB
+          ? frameResult.frameNumber
+          : Atomics.load(syncArray, config.FRAME_COUNTER_INDEX) + 1;
+
         // 2. *** THE "COMMIT" STEP ***
         // Atomically swap the readable buffer index to point to the freshly written buffer
         // This ensures readers always see a complete, non-torn frame
-        Atomics.store(syncArray, config.READABLE_BUFFER_INDEX, writeBufferIndex);
-        
-        // Toggle write buffer for next frame
-        writeBufferIndex = 1 - writeBufferIndex;
+        if (!frameRingSAB) {
+          Atomics.store(
+            syncArray,
+            config.BUFFER_FRAME_NUMBER_INDEX + writeBufferIndex,
+            frameNumber,
+          );
+          Atomics.store(syncArray, config.READABLE_BUFFER_INDEX, writeBufferIndex);
+
+          // Toggle write buffer for next frame
+          writeBufferIndex = 1 - writeBufferIndex;
+        }
         
         // Finally, increment frame counter and notify readers
         const newFrameCounter = Atomics.add(
@@ -135,19 +178,28 @@ async function captureLoop() {
 
         // --- END OF SYNCHRONIZED UPDATE ---
 
-        // This message is sent after the commit, so it's safe.
+        // This message is sent after the commit, so it's safe. The posted
+        // number is stored before it goes out and the drained one after, so a
+        // reader that sees the drained number also sees the post.
         if (
           frameResult.changedRegions &&
           frameResult.changedRegions.length > 0
         ) {
+          Atomics.store(
+            syncArray,
+            config.POSTED_FRAME_NUMBER_INDEX,
+            frameNumber,
+          );
           parentPort.postMessage({
             type: 'frame-update',
             payload: {
               frameCounter: newFrameCounter,
+              frameNumber,
               dirtyRects: frameResult.changedRegions,
             },
           });
         }
+        Atomics.store(syncArray, config.DRAINED_FRAME_NUMBER_INDEX, frameNumber);
 
         const loopDuration = performance.now() - loopStartTime;
         perfTracker.addFrameMeasurement(loopDuration, regionsToWrite);
@@ -166,6 +218,8 @@ async function captureLoop() {
 
   if (isCapturing) {
     captureInstance.stopMonitorInstance();
+    if (config.RECORDING_PATH) captureInstance.stopRecording();
+    if (frameRingSAB) captureInstance.detachFrameRing();
     isCapturing = false;
     console.log('[CaptureCore] Stopped capture instance.');
   }
@@ -0,0 +1,259 @@
+// capture/frameRing.js
+// Reader side of the native SharedArrayBuffer frame ring.
+// Layout mirrors nativeModules/x11RegionCapture/src/frameRing.h.
+
+import {
+  BUFFER_FRAME_NUMBER_INDEX,
+  DRAINED_FRAME_NUMBER_INDEX,
+  POSTED_FRAME_NUMBER_INDEX,
+  READABLE_BUFFER_INDEX,
+} from './config.js';
+
+export const RING_HEADER_BYTES = 64;
+export const MAX_SLOT_RECTS = 64;
+export const SLOT_RECTS_OFFSET = 32;
+export const FRAME_OFFSET =
+  (SLOT_RECTS_OFFSET + MAX_SLOT_RECTS * 16 + 63) & ~63;
+export const FRAME_HEADER_SIZE = 8;
+
+// Ring header words
+const H_SLOT_COUNT = 2;
+const H_SLOT_STRIDE = 3;
+const H_LATEST_SLOT = 6;
+const H_PUBLISH_COUNT = 7;
+
+// Slot words
+const S_SEQUENCE = 0;
+const S_WIDTH = 1;
+const S_HEIGHT = 2;
+const S_FRAME_NUMBER = 5;
+const S_DIRTY_COUNT = 6;
+
+/**
+ * Bytes needed for a ring of `slotCount` frames of up to maxWidth x maxHeight.
+ */
+export function frameRingByteLength(slotCount, maxWidth, maxHeight) {
+  const slotStride =
+    (FRAME_OFFSET + FRAME_HEADER_SIZE + maxWidth * maxHeight * 4 + 63) & ~63;
+  return RING_HEADER_BYTES + slotCount * slotStride;
+}
+
+/**
+ * Creates a reader over a frame ring SAB.
+ * Frames are read in place; `isIntact(frame)` tells whether the slot was
+ * rewritten since it was obtained (seqlock check).
+ */
+export function createFrameRingReader(frameRingSAB) {
+  const header = new Int32Array(frameRingSAB, 0, RING_HEADER_BYTES / 4);
+  let slotViews = null;
+
+  function ensureViews() {
+    if (slotViews) return slotViews.length > 0;
+    const slotCount = Atomics.load(header, H_SLOT_COUNT);
+    const slotStride = Atomics.load(header, H_SLOT_STRIDE);
+    if (slotCount <= 0 || slotStride <= 0) return false;
+    slotViews = [];
+    for (let i = 0; i < slotCount; i++) {
+      const slotOffset = RING_HEADER_BYTES + i * slotStride;
+      slotViews.push({
+        words: new Int32Array(frameRingSAB, slotOffset, SLOT_RECTS_OFFSET / 4),
+        rects: new Int32Array(
+          frameRingSAB,
+          slotOffset + SLOT_RECTS_OFFSET,
+          MAX_SLOT_RECTS * 4,
+        ),
+        // Same layout as the double-buffered image SABs: 8-byte header + BGRA.
+        frame: Buffer.from(
+          frameRingSAB,
+          slotOffset + FRAME_OFFSET,
+          slotStride - FRAME_OFFSET,
+        ),
+      });
+    }
+    return true;
+  }
+
+  /**
+   * @returns {object|null} { slot, sequence, frameNumber, width, height, buffer, dirtyRects }
+   *   `dirtyRects` is null when the whole frame should be treated as changed.
+   */
+  function readLatestFrame() {
+    if (!ensureViews()) return null;
+    const slot = Atomics.load(header, H_LATEST_SLOT);
+    if (slot < 0) return null;
+    const view = slotViews[slot];
+    const sequence = Atomics.load(view.words, S_SEQUENCE);
+    if (sequence & 1) return null; // Being rewritten; caller retries next frame.
+
+    const dirtyCount = view.words[S_DIRTY_COUNT];
+    let dirtyRects = null;
+    if (dirtyCount >= 0) {
+      dirtyRects = new Array(dirtyCount);
+      for (let i = 0; i < dirtyCount; i++) {
+        const o = i * 4;
+        dirtyRects[i] = {
+          x: view.rects[o],
+          y: view.rects[o + 1],
+          width: view.rects[o + 2],
+          height: view.rects[o + 3],
+        };
+      }
+    }
+    const frame = {
+      slot,
+      sequence,
+      frameNumber: view.words[S_FRAME_NUMBER],
+      width: view.words[S_WIDTH],
+      height: view.words[S_HEIGHT],
+      buffer: view.frame,
+      dirtyRects,
+    };
+    return isIntact(frame) ? frame : null;
+  }
+
+  function isIntact(frame) {
+    return (
+      frame !== null &&
+      Atomics.load(slotViews[frame.slot].words, S_SEQUENCE) === frame.sequence
+    );
+  }
+
+  function publishCount() {
+    return Atomics.load(header, H_PUBLISH_COUNT);
+  }
+
+  return { readLatestFrame, isIntact, publishCount };
+}
+
+// A slot read only fails when the writer has just lapped onto it; the next
+// read picks up the slot it published in the meantime.
+const RING_READ_ATTEMPTS = 3;
+
+/**
+ * Returns a `getReadableBuffer()` for a worker's sharedData. It reads the
+ * frame ring in place when one is shared, otherwise the double-buffered SABs.
+ *
+ * A ring slot is only valid until the writer laps onto it. Callers that hold
+ * a frame across an await use `getReadableFrame()` and check
+ * `isIntact(readable)` before trusting what they read from it.
+ */
+export function createFrameSource(sharedData) {
+  const { imageSAB_A, imageSAB_B, syncSAB, frameRingSAB } = sharedData;
+  const syncArray = new Int32Array(syncSAB);
+  const imageBuffers = [Buffer.from(imageSAB_A), Buffer.from(imageSAB_B)];
+  const ringReader = frameRingSAB ? createFrameRingReader(frameRingSAB) : null;
+
+  /**
+   * @returns {{ buffer: Buffer, ringFrame: object|null, bufferIndex: number,
+   *   frameNumber: number|null }}
+   *   `ringFrame` is the ring slot the buffer views, or null for the double
+   *   buffer (`bufferIndex`). When no intact ring slot can be read, this falls
+   *   back to the double buffer (whose header reports a 0x0 frame in ring
+   *   mode) rather than handing out a slot that is being rewritten.
+   *   `frameNumber` is the number frame-update messages carry for this frame,
+   *   or null when it is not known.
+   */
+  function getReadableFrame() {
+    if (ringReader) {
+      for (let attempt = 0; attempt < RING_READ_ATTEMPTS; attempt++) {
+        const frame = ringReader.readLatestFrame();
+        if (frame) {
+          return {
+            buffer: frame.buffer,
+            ringFrame: frame,
+            bufferIndex: -1,
+            frameNumber: frame.frameNumber,
+          };
+        }
+      }
+    }
+    const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
+    const frameNumber = Atomics.load(
+      syncArray,
+      BUFFER_FRAME_NUMBER_INDEX + index,
+    );
+    return {
+      buffer: imageBuffers[index],
+      ringFrame: null,
+      bufferIndex: index,
+      frameNumber: frameNumber > 0 ? frameNumber : null,
+    };
+  }
+
+  function getReadableBuffer() {
+    return getReadableFrame().buffer;
+  }
+
+  // True while the frame returned by getReadableFrame() has not been rewritten.
+  // The capture zeroes a double buffer's frame number before writing it; in
+  // ring mode the double buffer is only a 0x0 placeholder.
+  function isIntact(readable) {
+    if (readable.ringFrame) return ringReader.isIntact(readable.ringFrame);
+    if (ringReader) return true;
+    return (
+      readable.frameNumber !== null &&
+      Atomics.load(syncArray, BUFFER_FRAME_NUMBER_INDEX + readable.bufferIndex) ===
+        readable.frameNumber
+    );
+  }
+
+  /**
+   * The number of the latest frame-update message posted once every change up
+   * to `frameNumber` had been, or null if the capture has not got that far.
+   * Pass it to DirtyRectLog.take() with the frame.
+   */
+  function postedFrameNumber(frameNumber) {
+    if (!frameNumber) return null;
+    if (Atomics.load(syncArray, DRAINED_FRAME_NUMBER_INDEX) < frameNumber) {
+      return null;
+    }
+    return Atomics.load(syncArray, POSTED_FRAME_NUMBER_INDEX);
+  }
+
+  let pinnedBuffer = null;
+
+  /**
+   * Copies rows [top, bottom) of the latest frame, plus its header, into a
+   * buffer owned by this worker, so a scan that spans awaits (or runs off the
+   * thread) sees one frame from start to finish. Rows outside the range are
+   * left over from earlier pins. The buffer is reused by the next call.
+   * @returns {{ buffer: Buffer, frameNumber: number|null }|null} null when no
+   *   intact frame could be copied. frameNumber is getReadableFrame()'s.
+   */
+  function pinFrame(top = 0, bottom = Infinity) {
+    for (let attempt = 0; attempt < RING_READ_ATTEMPTS; attempt++) {
+      const readable = getReadableFrame();
+      const source = readable.buffer;
+      const width = source.readUInt32LE(0);
+      const height = source.readUInt32LE(4);
+      const frameBytes = FRAME_HEADER_SIZE + width * height * 4;
+      if (frameBytes > source.length) return null;
+      if (!pinnedBuffer || pinnedBuffer.length < frameBytes) {
+        pinnedBuffer = Buffer.alloc(frameBytes);
+      }
+      const rowBytes = width * 4;
+      const y0 = Math.max(0, Math.min(height, Math.floor(top)));
+      const y1 = Math.max(y0, Math.min(height, Math.ceil(bottom)));
+      source.copy(pinnedBuffer, 0, 0, FRAME_HEADER_SIZE);
+      source.copy(
+        pinnedBuffer,
+        FRAME_HEADER_SIZE + y0 * rowBytes,
+        FRAME_HEADER_SIZE + y0 * rowBytes,
+        FRAME_HEADER_SIZE + y1 * rowBytes,
+      );
+      if (isIntact(readable)) {
+        return { buffer: pinnedBuffer, frameNumber: readable.frameNumber };
+      }
+    }
+    return null;
+  }
+
+  return {
+    getReadableBuffer,
+    getReadableFrame,
+    isIntact,
+    pinFrame,
+    postedFrameNumber,
+    ringReader,
+  };
+}
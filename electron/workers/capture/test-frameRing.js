@@ -0,0 +1,145 @@
+#!/usr/bin/env node
+
+// Checks the frame ring reader against a ring written the way
+// x11RegionCapture's WriteRingSlot does. Run: node test-frameRing.js
+
+import {
+  FRAME_OFFSET,
+  RING_HEADER_BYTES,
+  createFrameRingReader,
+  createFrameSource,
+  frameRingByteLength,
+} from './frameRing.js';
+import {
+  BUFFER_FRAME_NUMBER_INDEX,
+  DRAINED_FRAME_NUMBER_INDEX,
+  POSTED_FRAME_NUMBER_INDEX,
+  READABLE_BUFFER_INDEX,
+} from './config.js';
+
+let failures = 0;
+function check(cond, label) {
+  console.log(`  ${cond ? '✓' : '✗'} ${label}`);
+  if (!cond) failures++;
+}
+
+const SLOTS = 3;
+const WIDTH = 4;
+const HEIGHT = 2;
+const ringSAB = new SharedArrayBuffer(frameRingByteLength(SLOTS, WIDTH, HEIGHT));
+const header = new Int32Array(ringSAB, 0, RING_HEADER_BYTES / 4);
+const slotStride = (ringSAB.byteLength - RING_HEADER_BYTES) / SLOTS;
+header[2] = SLOTS;
+header[3] = slotStride;
+Atomics.store(header, 6, -1);
+
+const slotWords = (slot) =>
+  new Int32Array(ringSAB, RING_HEADER_BYTES + slot * slotStride, 8);
+
+function beginWrite(slot) {
+  const words = slotWords(slot);
+  const seq = Atomics.load(words, 0) | 1;
+  Atomics.store(words, 0, seq);
+  return seq;
+}
+function endWrite(slot, seq) {
+  Atomics.store(slotWords(slot), 0, seq + 1);
+}
+function writeFrame(slot, frameNumber) {
+  const seq = beginWrite(slot);
+  const words = slotWords(slot);
+  words[1] = WIDTH;
+  words[2] = HEIGHT;
+  words[5] = frameNumber;
+  words[6] = -1;
+  const pixels = new Uint8Array(
+    ringSAB,
+    RING_HEADER_BYTES + slot * slotStride + FRAME_OFFSET,
+    8 + WIDTH * HEIGHT * 4,
+  );
+  const frameHeader = new DataView(pixels.buffer, pixels.byteOffset, 8);
+  frameHeader.setUint32(0, WIDTH, true);
+  frameHeader.setUint32(4, HEIGHT, true);
+  pixels.fill(frameNumber & 0xff, 8);
+  endWrite(slot, seq);
+  Atomics.store(header, 6, slot);
+  Atomics.add(header, 7, 1);
+}
+
+console.log('1. Reader');
+const reader = createFrameRingReader(ringSAB);
+check(reader.readLatestFrame() === null, 'empty ring has no frame');
+writeFrame(0, 1);
+const first = reader.readLatestFrame();
+check(first && first.frameNumber === 1 && first.slot === 0, 'reads the latest slot');
+check(first && first.dirtyRects === null, 'dirty count -1 means whole frame');
+check(reader.isIntact(first), 'untouched slot is intact');
+writeFrame(0, 4);
+check(!reader.isIntact(first), 'rewritten slot is not intact');
+const seq = beginWrite(0);
+check(reader.readLatestFrame() === null, 'slot being written is rejected');
+endWrite(0, seq);
+
+console.log('\n2. Frame source');
+const imageSAB_A = new SharedArrayBuffer(64);
+const imageSAB_B = new SharedArrayBuffer(64);
+const syncSAB = new SharedArrayBuffer((POSTED_FRAME_NUMBER_INDEX + 1) * 4);
+const source = createFrameSource({ imageSAB_A, imageSAB_B, syncSAB, frameRingSAB: ringSAB });
+writeFrame(1, 2);
+const readable = source.getReadableFrame();
+check(readable.ringFrame && readable.ringFrame.slot === 1, 'returns the ring slot');
+check(readable.buffer[8] === 2, 'buffer views the slot pixels');
+check(readable.frameNumber === 2, 'carries the slot frame number');
+check(source.isIntact(readable), 'fresh frame is intact');
+writeFrame(1, 5);
+check(!source.isIntact(readable), 'frame source notices a lapped slot');
+
+// Writer stuck on the latest slot: fall back to the double buffer rather
+// than the slot being rewritten.
+const stuck = beginWrite(1);
+const fallback = source.getReadableFrame();
+check(fallback.ringFrame === null, 'no ring frame while the slot is written');
+const index = Atomics.load(new Int32Array(syncSAB), READABLE_BUFFER_INDEX);
+check(
+  fallback.buffer.buffer === (index ? imageSAB_B : imageSAB_A),
+  'falls back to the double buffer',
+);
+check(source.isIntact(fallback), 'double buffer frames are always intact');
+endWrite(1, stuck);
+
+console.log('\n3. Pinned frames');
+writeFrame(2, 6);
+const pinned = source.pinFrame(0, 1);
+check(pinned && pinned.frameNumber === 6, 'pinned frame keeps its number');
+check(pinned && pinned.buffer.readUInt32LE(0) === WIDTH, 'pinned frame keeps the header');
+check(pinned && pinned.buffer[8] === 6, 'pinned rows are copied');
+check(pinned && pinned.buffer[8 + WIDTH * 4] === 0, 'rows outside the range are not');
+writeFrame(0, 7);
+check(pinned.buffer[8] === 6, 'pinned copy survives the next frame');
+const writing = beginWrite(0);
+const empty = source.pinFrame();
+check(empty && empty.buffer.readUInt32LE(0) === 0, 'pinning a lapped ring falls back to the double buffer');
+check(empty && empty.frameNumber === null, 'the placeholder has no frame number');
+endWrite(0, writing);
+
+console.log('\n4. Double buffer');
+const sync = new Int32Array(syncSAB);
+const doubleSource = createFrameSource({ imageSAB_A, imageSAB_B, syncSAB });
+Atomics.store(sync, READABLE_BUFFER_INDEX, 1);
+Atomics.store(sync, BUFFER_FRAME_NUMBER_INDEX + 1, 9);
+const current = doubleSource.getReadableFrame();
+check(current.frameNumber === 9, 'reads the buffer frame number');
+check(doubleSource.isIntact(current), 'unchanged buffer is intact');
+Atomics.store(sync, BUFFER_FRAME_NUMBER_INDEX + 1, 0);
+check(!doubleSource.isIntact(current), 'buffer being rewritten is not intact');
+check(doubleSource.pinFrame() === null, 'a buffer being written is not pinned');
+Atomics.store(sync, BUFFER_FRAME_NUMBER_INDEX + 1, 11);
+check(doubleSource.pinFrame()?.frameNumber === 11, 'pins the rewritten frame');
+Atomics.store(sync, DRAINED_FRAME_NUMBER_INDEX, 10);
+Atomics.store(sync, POSTED_FRAME_NUMBER_INDEX, 8);
+check(doubleSource.postedFrameNumber(11) === null, 'no posted number before the frame is drained');
+Atomics.store(sync, DRAINED_FRAME_NUMBER_INDEX, 11);
+check(doubleSource.postedFrameNumber(11) === 8, 'posted number once it is');
+
+console.log(failures ? `\n✗ ${failures} check(s) failed` : '\n✓ All checks passed');
+process.exit(failures ? 1 : 0);
@@ -2,9 +2,7 @@ import { parentPort, workerData } from 'worker_threads';
 import { performance } from 'perf_hooks';
 import { createLogger } from '../utils/logger.js';
 import { createWorkerInterface, WORKER_IDS } from './sabState/index.js';
-import findTarget from 'find-target-native';
-import findHealthBars from 'find-healthbars-native';
-import findSequences from 'find-sequences-native';
+import frameAnalyzer from 'frame-analyzer-native';
 import Pathfinder from 'pathfinder-native';
 import pkg from 'font-ocr';
 import regionDefinitions from '../constants/regionDefinitions.js';
@@ -13,8 +11,9 @@ import {
   getGameCoordinatesFromScreen,
   getAbsoluteGameWorldClickCoordinates,
 } from '../utils/gameWorldClickTranslator.js';
-import { FrameUpdateManager } from '../utils/frameUpdateManager.js';
-import { SABStateManager } from './sabStateManager.js';
+import { DirtyRectLog, FrameUpdateManager } from '../utils/frameUpdateManager.js';
+import { SABStateManager, hpCodeToString } from './sabStateManager.js';
+import { createFrameSource } from './capture/frameRing.js';
 import { findBestNameMatch } from '../utils/nameMatcher.js';
 import { processPlayerList, processNpcList } from './creatureMonitor/ocr.js';
 import {
@@ -30,15 +29,36 @@ const BATTLELIST_ALLOWED_CHARS =
 // Nameplate OCR should NOT include dots (creatures never have dots in names)
 const NAMEPLATE_ALLOWED_CHARS =
   'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ ';
+// Battle list target marker (only when actually TARGETED, not just hovered):
+// [255, 0, 0] - targeted, [255, 128, 128] - targeted+hovered
+// Note: We do NOT check white [255, 255, 255] because that's hover-only, not targeted
+const BATTLE_LIST_TARGET_SEQUENCES = Object.fromEntries(
+  [
+    [255, 0, 0], // Pure targeted (red)
+    [255, 128, 128], // Targeted + hovered (light red)
+  ].map((color, i) => [
+    `target_bar_${i}`,
+    { sequence: new Array(5).fill(color), direction: 'vertical' },
+  ]),
+);
 
 const frameUpdateManager = new FrameUpdateManager();
+// Gives each health bar an id that survives while it moves by up to a tile
+// per scan, so creatures follow their own bar instead of the nearest one.
+const healthBarTracker = frameAnalyzer.createHealthBarTracker();
+// Everything dirtied since the tracker's last scan, so the next scan only
+// rescans those parts of the game world. Rects arrive after their frame is
+// published; when they do not reach the pinned frame yet (or too many piled
+// up while scans were skipped) the scan covers the whole area.
+const healthBarDirtyRects = new DirtyRectLog();
+// Ints per bar in analyzeFrame's 'records' output: x, y, hpPercent,
+// healthClass (an hp code), id.
+const HEALTH_BAR_RECORD_FIELDS = 5;
 let pathfinderInstance = null;
 const { sharedData, paths } = workerData;
 if (!sharedData) throw new Error('[CreatureMonitor] Shared data not provided.');
 
 const {
-  imageSAB_A,
-  imageSAB_B,
   syncSAB,
   playerPosSAB,
   pathDataSAB,
@@ -49,19 +69,11 @@ const {
   targetSAB,
 } = sharedData;
 
-// Double buffering: maintain views of both buffers
-const imageBuffers = [
-  Buffer.from(imageSAB_A),
-  Buffer.from(imageSAB_B)
-];
 const syncArray = new Int32Array(syncSAB);
-const READABLE_BUFFER_INDEX = 5; // From capture/config.js
 
-// Helper to get current readable buffer
-function getReadableBuffer() {
-  const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
-  return imageBuffers[index];
-}
+// Double buffering, or the zero-copy frame ring when one is shared
+const { getReadableBuffer, pinFrame, postedFrameNumber } =
+  createFrameSource(sharedData);
 
 let sharedBufferView = getReadableBuffer(); // Initialize
 
@@ -112,6 +124,8 @@ let lastStablePlayerMinimapPosition = { x: 0, y: 0, z: 0 };
 let lastBattleListOcrTime = 0;
 // Performance caches for detection
 let lastBarAreas = [];
+let operationRunning = false;
+let operationQueued = false;
 let lastReachableSig = null;
 let lastReachableTiles = null;
 // Region snapshot management
@@ -300,33 +314,35 @@ function rectanglesIntersectWithMargin(a, b, marginX = 0, marginY = marginX) {
   return rectsIntersect(expanded, b);
 }
 
-function unionRect(rects, margin = 0) {
-  if (!rects || rects.length === 0) return null;
-  let minX = Infinity, minY = Infinity, maxX = -Infinity, maxY = -Infinity;
-  for (const r of rects) {
-    if (!r) continue;
-    minX = Math.min(minX, r.x);
-    minY = Math.min(minY, r.y);
-    maxX = Math.max(maxX, r.x + r.width);
-    maxY = Math.max(maxY, r.y + r.height);
+// Whether the frame analyzer's OCR prescan saw a font-colour pixel in any
+// cell overlapping rect; recognizeText cannot find text anywhere else.
+function ocrCellsHit(ocr, rect) {
+  if (!ocr || !rect) return true;
+  const { cellSize, columns, rows, cells } = ocr;
+  const c0 = Math.max(0, Math.floor((rect.x - ocr.x) / cellSize));
+  const r0 = Math.max(0, Math.floor((rect.y - ocr.y) / cellSize));
+  const c1 = Math.min(columns, Math.ceil((rect.x + rect.width - ocr.x) / cellSize));
+  const r1 = Math.min(rows, Math.ceil((rect.y + rect.height - ocr.y) / cellSize));
+  for (let r = r0; r < r1; r++) {
+    for (let c = c0; c < c1; c++) {
+      if (cells[r * columns + c]) return true;
+    }
   }
-  if (!isFinite(minX)) return null;
-  return {
-    x: Math.max(0, Math.floor(minX - margin)),
-    y: Math.max(0, Math.floor(minY - margin)),
-    width: Math.max(0, Math.ceil(maxX - minX + margin * 2)),
-    height: Math.max(0, Math.ceil(maxY - minY + margin * 2)),
-  };
+  return false;
 }
 
-function intersectRects(a, b) {
-  if (!a || !b) return null;
-  const x1 = Math.max(a.x, b.x);
-  const y1 = Math.max(a.y, b.y);
-  const x2 = Math.min(a.x + a.width, b.x + b.width);
-  const y2 = Math.min(a.y + a.height, b.y + b.height);
-  if (x2 <= x1 || y2 <= y1) return null;
-  return { x: x1, y: y1, width: x2 - x1, height: y2 - y1 };
+function decodeHealthBars(records) {
+  const bars = new Array(records.length / HEALTH_BAR_RECORD_FIELDS);
+  for (let i = 0, o = 0; i < bars.length; i++, o += HEALTH_BAR_RECORD_FIELDS) {
+    bars[i] = {
+      x: records[o],
+      y: records[o + 1],
+      hpPercent: records[o + 2],
+      healthTag: hpCodeToString[records[o + 3]] || 'Full',
+      id: records[o + 4],
+    };
+  }
+  return bars;
 }
 
 function getNameplateRegion(hb, gameWorld, tileSize) {
@@ -534,6 +550,7 @@ function updateCreatureState(
   creature.lastSeen = now;
   if (detection.name) creature.name = detection.name;
   if (detection.hp) creature.hp = detection.hp;
+  if (detection.hpPercent !== undefined) creature.hpPercent = detection.hpPercent;
 
   // Check if creature is adjacent (within 1 tile)
   const deltaX = Math.abs(currentPlayerMinimapPosition.x - finalGameCoords.x);
@@ -570,6 +587,25 @@ function updateCreatureState(
   return creature;
 }
 
+// Runs performOperation one at a time. It awaits the native frame pass, so
+// messages arriving meanwhile coalesce into a single rerun instead of
+// starting a second scan over the same creatures.
+async function runOperation() {
+  if (operationRunning) {
+    operationQueued = true;
+    return;
+  }
+  operationRunning = true;
+  try {
+    do {
+      operationQueued = false;
+      await performOperation();
+    } while (operationQueued);
+  } finally {
+    operationRunning = false;
+  }
+}
+
 async function performOperation() {
   try {
     const now = Date.now();
@@ -811,16 +847,51 @@ async function performOperation() {
     // Always scan health bars when we have battle list entries (no early return)
     // Previously this early return would skip health bar scanning, causing mismatches
 
-    // ALWAYS scan full game world - no optimizations (for debugging native module)
+    // Health bars are scanned every time; the tracker only rescans the parts
+    // of the game world dirtied since its last scan.
     let healthBars = [];
     let didScanHealthBars = false;
-    // CRITICAL: Get fresh buffer immediately before health bar scan
-    // Previous async operations may have allowed buffer swap
-    sharedBufferView = getReadableBuffer();
-    healthBars = await findHealthBars.findHealthBars(
-      sharedBufferView,
-      constrainedGameWorld,
+    // Pin the rows of the game world and battle list from the latest frame.
+    // The scan below runs off this thread and the nameplate OCR follows
+    // awaits; both must read the same frame while capture keeps writing.
+    // runOperation() serializes operations, so the next pin cannot overwrite
+    // this one before the scan settles.
+    const pinTop = Math.min(gameWorld.y, regions.battleList?.y ?? gameWorld.y);
+    const pinBottom = Math.max(
+      gameWorld.y + gameWorld.height,
+      regions.battleList ? regions.battleList.y + regions.battleList.height : 0,
+    );
+    const pinned = pinFrame(pinTop, pinBottom);
+    if (!pinned) return;
+    const pinnedFrame = pinned.buffer;
+    sharedBufferView = pinnedFrame;
+    const barDirtyRects = healthBarDirtyRects.take(
+      pinned.frameNumber,
+      postedFrameNumber(pinned.frameNumber),
     );
+    // One native pass over the frame serves health bars, the target mark,
+    // the battle list target marker and the nameplate OCR prescan. It runs
+    // off this thread, so messages keep being handled during the scan.
+    let frameAnalysis;
+    try {
+      frameAnalysis = await frameAnalyzer.analyzeFrameAsync(pinnedFrame, {
+        healthBars: {
+          area: constrainedGameWorld,
+          tracker: healthBarTracker,
+          dirtyRects: barDirtyRects ?? undefined,
+          output: 'records',
+        },
+        target: { area: gameWorld },
+        ocr: { area: gameWorld, colors: regionDefinitions.gameWorld?.ocrColors || [] },
+        ...(regions.battleList && {
+          sequences: { area: regions.battleList, sequences: BATTLE_LIST_TARGET_SEQUENCES },
+        }),
+      });
+    } catch (err) {
+      healthBarDirtyRects.forget();
+      throw err;
+    }
+    healthBars = decodeHealthBars(frameAnalysis.healthBars);
     lastHealthScanTime = now;
     lastActualHealthBarCount = healthBars.length; // Track actual scan result
     didScanHealthBars = true;
@@ -871,11 +942,14 @@ async function performOperation() {
         width: clampedWidth,
         height: clampedHeight,
       };
-      // Note: recognizeText is synchronous, so using the current sharedBufferView is safe
-      // as long as it was refreshed before the health bar scan that produced this hb
+      // No nameplate-coloured pixel there: recognizeText would find nothing.
+      if (!ocrCellsHit(frameAnalysis.ocr, ocrRegion)) {
+        return findBestNameMatch(null, canonicalNames, logger);
+      }
+      // Read from the pinned frame the health bars were found in.
       const nameplateOcrResults =
         recognizeText(
-          sharedBufferView,
+          pinnedFrame,
           ocrRegion,
           regionDefinitions.gameWorld?.ocrColors || [],
           NAMEPLATE_ALLOWED_CHARS,
@@ -890,18 +964,25 @@ async function performOperation() {
     };
 
     for (const [id, oldCreature] of activeCreatures.entries()) {
-      let bestMatch = null;
-      let minDistance = CORRELATION_DISTANCE_THRESHOLD_PIXELS;
-
-      for (const hb of healthBars) {
-        if (matchedHealthBars.has(hb)) continue;
-        const distance = screenDist(
-          { x: hb.x, y: hb.y },
-          oldCreature.absoluteCoords,
-        );
-        if (distance < minDistance) {
-          minDistance = distance;
-          bestMatch = hb;
+      // The creature's own bar from the last scan, if it is still tracked;
+      // otherwise the nearest free bar.
+      let bestMatch =
+        healthBars.find(
+          (hb) => hb.id === oldCreature.healthBarId && !matchedHealthBars.has(hb),
+        ) || null;
+
+      if (!bestMatch) {
+        let minDistance = CORRELATION_DISTANCE_THRESHOLD_PIXELS;
+        for (const hb of healthBars) {
+          if (matchedHealthBars.has(hb)) continue;
+          const distance = screenDist(
+            { x: hb.x, y: hb.y },
+            oldCreature.absoluteCoords,
+          );
+          if (distance < minDistance) {
+            minDistance = distance;
+            bestMatch = hb;
+          }
         }
       }
       
@@ -969,6 +1050,7 @@ async function performOperation() {
           healthBarY: bestMatch.y,
           name: creatureName,
           hp: bestMatch.healthTag,
+          hpPercent: bestMatch.hpPercent,
         };
         const updated = updateCreatureState(
           oldCreature,
@@ -983,6 +1065,7 @@ async function performOperation() {
           // Clear positionUncertain flag since we have a valid health bar detection
           if (updated.positionUncertain)
             delete updated.positionUncertain;
+          updated.healthBarId = bestMatch.id;
           newActiveCreatures.set(id, updated);
         }
         matchedHealthBars.add(bestMatch);
@@ -998,6 +1081,7 @@ async function performOperation() {
             healthBarY: hb.y,
             name: creatureName,
             hp: hb.healthTag,
+            hpPercent: hb.hpPercent,
           };
           const newId = nextInstanceId++;
           logger('debug', `[CREATURE NEW] ${creatureName || 'unknown'} created with ID ${newId} at screen pos (${hb.x}, ${hb.y})`);
@@ -1015,6 +1099,7 @@ async function performOperation() {
             // Ensure new creatures don't have positionUncertain flag
             if (newCreature.positionUncertain)
               delete newCreature.positionUncertain;
+            newCreature.healthBarId = hb.id;
             newActiveCreatures.set(newId, newCreature);
           }
         }
@@ -1204,18 +1289,8 @@ async function performOperation() {
         now - lastTargetScanTime >= TARGET_SCAN_FALLBACK_MS;
 
       if (needsTargetScan) {
-        let targetScanArea = null;
-        if (dirtyRects.length > 0) {
-          const margin = Math.max(8, Math.floor((tileSize?.width || 32) * 0.5));
-          const dirtyUnion = unionRect(dirtyRects, margin);
-          if (dirtyUnion) targetScanArea = intersectRects(dirtyUnion, gameWorld);
-        }
-        // Get fresh buffer for target scan
-        sharedBufferView = getReadableBuffer();
-        targetRect = await findTarget.findTarget(
-          sharedBufferView,
-          targetScanArea || gameWorld,
-        );
+        // Found by the frame analysis pass, on the same frame as the health bars
+        targetRect = frameAnalysis.target;
         didScanTarget = true;
         lastTargetScanTime = now;
       }
@@ -1270,29 +1345,8 @@ async function performOperation() {
     
     let battleListTargetName = null;
     if (battleListRegion) {
-      // Check for target marker colors (only when actually TARGETED, not just hovered):
-      // [255, 0, 0] - targeted, [255, 128, 128] - targeted+hovered
-      // Note: We do NOT check white [255, 255, 255] because that's hover-only, not targeted
-      const targetColors = [
-        [255, 0, 0],     // Pure targeted (red)
-        [255, 128, 128], // Targeted + hovered (light red)
-      ];
-      
-      const sequences = {};
-      for (let i = 0; i < targetColors.length; i++) {
-        sequences[`target_bar_${i}`] = {
-          sequence: new Array(5).fill(targetColors[i]),
-          direction: 'vertical'
-        };
-      }
-      
-      // Get fresh buffer for battle list target marker scan
-      sharedBufferView = getReadableBuffer();
-      const result = await findSequences.findSequencesNative(
-        sharedBufferView,
-        sequences,
-        battleListRegion,
-      );
+      // Target marker sequences were searched by the frame analysis pass
+      const result = frameAnalysis.sequences || {};
       
       // Check if any of the target colors were found
       let markerY = null;
@@ -1718,6 +1772,10 @@ parentPort.on('message', async (message) => {
   try {
     if (message.type === 'frame-update') {
       frameUpdateManager.addDirtyRects(message.payload.dirtyRects);
+      healthBarDirtyRects.add(
+        message.payload.frameNumber,
+        message.payload.dirtyRects,
+      );
     }
     if (message.type === 'shutdown') {
       isShuttingDown = true;
@@ -1760,7 +1818,7 @@ parentPort.on('message', async (message) => {
           );
       }
     }
-    performOperation();
+    runOperation();
   } catch (e) {
     logger('error', '[CreatureMonitor] Error handling message:', e);
   }
@@ -9,6 +9,7 @@ import { extractBGRA } from './helpers.js';
 import { processMinimapData, setSABInterface } from './processing.js';
 import { LANDMARK_SIZE, MINIMAP_FALLBACK_INTERVAL_MS } from './config.js';
 import { createWorkerInterface, WORKER_IDS } from '../sabState/index.js';
+import { createFrameSource } from '../capture/frameRing.js';
 
 let currentState = null;
 let isShuttingDown = false;
@@ -23,14 +24,9 @@ let lastProcessedTime = Date.now();
 let regionsStale = false;
 let lastRequestedRegionsVersion = -1;
 
-const { imageSAB_A, imageSAB_B, syncSAB } = workerData.sharedData;
+const { syncSAB } = workerData.sharedData;
 const syncArray = new Int32Array(syncSAB);
-const imageBuffers = [Buffer.from(imageSAB_A), Buffer.from(imageSAB_B)];
-const READABLE_BUFFER_INDEX = 5;
-function getReadableBuffer() {
-  const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
-  return imageBuffers[index];
-}
+const { getReadableBuffer } = createFrameSource(workerData.sharedData);
 let sharedBufferView = getReadableBuffer();
 
 async function initialize() {
@@ -78,16 +74,17 @@ async function performOperation(dirtyRects) {
   const screenWidth = Atomics.load(syncArray, config.WIDTH_INDEX);
   if (!minimapFull || !minimapFloorIndicatorColumn || screenWidth <= 0) return;
 
-  const minimapData = extractBGRA(sharedBufferView, screenWidth, minimapFull);
   const floorIndicatorData = extractBGRA(
     sharedBufferView,
     screenWidth,
     minimapFloorIndicatorColumn,
   );
 
-  if (minimapData && floorIndicatorData) {
+  if (floorIndicatorData) {
     await processMinimapData(
-      minimapData,
+      sharedBufferView,
+      screenWidth,
+      minimapFull,
       floorIndicatorData,
       minimapMatcher,
       workerData,
@@ -4,30 +4,28 @@ import { parentPort } from 'worker_threads';
 import { performance } from 'perf_hooks';
 import findSequences from 'find-sequences-native';
 import { floorLevelIndicators } from '../../constants/index.js';
-import {
-  MINIMAP_WIDTH,
-  MINIMAP_HEIGHT,
-  HEADER_SIZE,
-  colorToIndexMap,
-} from './config.js';
+import { HEADER_SIZE } from './config.js';
 import { CONTROL_COMMANDS } from '../sabState/schema.js';
 
 let lastWrittenPosition = null;
 let sabInterface = null;
+// Floor indicator search, compiled once (see findSequences.compileSearchPlan).
+let floorSearchPlan = null;
 
 export const setSABInterface = (sab) => {
   sabInterface = sab;
 };
 
-// Pre-allocate the buffer for minimap processing to avoid re-allocation on every frame.
-const minimapIndexData = new Uint8Array(MINIMAP_WIDTH * MINIMAP_HEIGHT);
-
 /**
  * Analyzes minimap and floor indicator data to determine player position.
+ * The minimap itself is read straight from the capture frame by the native
+ * matcher, which also does the BGRA -> palette index mapping.
  * @returns {Promise<number|null>} The processing duration in ms if successful, otherwise null.
  */
 export async function processMinimapData(
-  minimapBuffer,
+  frameBuffer,
+  frameWidth,
+  minimapRegion,
   floorIndicatorBuffer,
   minimapMatcher,
   workerData,
@@ -42,15 +40,16 @@ export async function processMinimapData(
     floorIndicatorSearchBuffer.writeUInt32LE(63, 4);
     floorIndicatorBuffer.copy(floorIndicatorSearchBuffer, HEADER_SIZE);
 
-    const searchResults = await findSequences.findSequencesNativeBatch(
-      floorIndicatorSearchBuffer,
-      {
-        floor: {
-          sequences: floorLevelIndicators,
-          searchArea: { x: 0, y: 0, width: 2, height: 63 },
-          occurrence: 'first',
-        },
+    floorSearchPlan ??= findSequences.compileSearchPlan({
+      floor: {
+        sequences: floorLevelIndicators,
+        searchArea: { x: 0, y: 0, width: 2, height: 63 },
+        occurrence: 'first',
       },
+    });
+    const searchResults = await findSequences.runPlan(
+      floorSearchPlan,
+      floorIndicatorSearchBuffer,
     );
 
     const foundFloor = searchResults.floor || {};
@@ -65,26 +64,17 @@ export async function processMinimapData(
 
     if (detectedZ === null) return null;
 
-    for (let i = 0; i < minimapIndexData.length; i++) {
-      const p = i * 4;
-      // BGRA to RGB integer key
-      const key =
-        (minimapBuffer[p + 2] << 16) |
-        (minimapBuffer[p + 1] << 8) |
-        minimapBuffer[p];
-      minimapIndexData[i] = colorToIndexMap.get(key) ?? 0;
-    }
-
-    const result = await minimapMatcher.findPosition(
-      minimapIndexData,
-      MINIMAP_WIDTH,
-      MINIMAP_HEIGHT,
+    const result = await minimapMatcher.findPositionInFrame(
+      frameBuffer,
+      frameWidth,
+      minimapRegion,
       detectedZ,
     );
 
     if (result?.position) {
       const newPos = {
         ...result.position,
+        zoomScale: result.zoomScale || 1,
         positionSearchMs: result.performance?.totalTimeMs?.toFixed(2) || 0,
       };
 
@@ -92,7 +82,8 @@ export async function processMinimapData(
         !lastWrittenPosition ||
         newPos.x !== lastWrittenPosition.x ||
         newPos.y !== lastWrittenPosition.y ||
-        newPos.z !== lastWrittenPosition.z
+        newPos.z !== lastWrittenPosition.z ||
+        newPos.zoomScale !== lastWrittenPosition.zoomScale
       ) {
         // Write position to unified SAB (primary source of truth)
         // Workers read position directly from SAB when needed - no broadcast required
@@ -101,6 +92,7 @@ export async function processMinimapData(
             x: newPos.x,
             y: newPos.y,
             z: newPos.z,
+            zoomScale: newPos.zoomScale,
           });
         }
 
@@ -5,17 +5,13 @@ import { parentPort, workerData } from 'worker_threads';
 import { performance } from 'perf_hooks';
 import * as config from './config.js';
 import { rectsIntersect, processOcrRegions } from './processing.js';
+import { createFrameSource } from '../capture/frameRing.js';
 
 // --- Worker Configuration & Setup ---
 const { sharedData } = workerData;
-const { imageSAB_A, imageSAB_B, syncSAB } = sharedData;
+const { syncSAB } = sharedData;
 const syncArray = new Int32Array(syncSAB);
-const imageBuffers = [Buffer.from(imageSAB_A), Buffer.from(imageSAB_B)];
-const READABLE_BUFFER_INDEX = 5;
-function getReadableBuffer() {
-  const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
-  return imageBuffers[index];
-}
+const { getReadableBuffer } = createFrameSource(sharedData);
 let sharedBufferView = getReadableBuffer();
 
 // --- State ---
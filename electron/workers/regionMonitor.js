@@ -3,7 +3,8 @@ import { parentPort, workerData } from 'worker_threads';
 import regionDefinitions from '../constants/regionDefinitions.js';
 import { setAllRegions } from '../../frontend/redux/slices/regionCoordinatesSlice.js';
 import findSequences from 'find-sequences-native';
-import { FrameUpdateManager } from '../utils/frameUpdateManager.js';
+import { DirtyRectLog, FrameUpdateManager } from '../utils/frameUpdateManager.js';
+import { createFrameSource } from './capture/frameRing.js';
 
 // --- Worker Configuration & Setup ---
 const { sharedData } = workerData;
@@ -12,15 +13,10 @@ const MIN_LOOP_DELAY_MS = 250;
 const PARTIAL_SCAN_MARGIN_PX = 24; // expand union of dirty rects to better capture anchors
 
 if (!sharedData) throw new Error('[RegionMonitor] Shared data not provided.');
-const { imageSAB_A, imageSAB_B, syncSAB } = sharedData;
+const { syncSAB } = sharedData;
 const syncArray = new Int32Array(syncSAB);
-const imageBuffers = [Buffer.from(imageSAB_A), Buffer.from(imageSAB_B)];
-const READABLE_BUFFER_INDEX = 5;
-function getReadableBuffer() {
-  const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
-  return imageBuffers[index];
-}
-let sharedBufferView = getReadableBuffer();
+const { getReadableFrame, postedFrameNumber } = createFrameSource(sharedData);
+let sharedBufferView = getReadableFrame().buffer;
 
 // --- SharedArrayBuffer Indices ---
 const WIDTH_INDEX = 1;
@@ -204,6 +200,81 @@ function calculateConstrainedSearchArea(def, fullSearchArea, metadata) {
   return constrainedArea;
 }
 
+// --- Compiled search plans ---
+// Each definitions node always searches the same sequences; only where it
+// searches changes. Its discovery tasks (singles and bounding box starts) and
+// its bounding box end tasks are compiled once into two plans. Tasks are
+// parked on an empty area, which searches nothing, and every run passes the
+// areas it needs through runPlan's searchAreas.
+//
+// Every plan also logs the capture's dirty rects and passes those since its
+// last run as runPlan's dirtyRects, so tasks whose area nothing touched keep
+// their previous results without a search. Rects arrive after their frame;
+// when the log does not reach the frame being scanned (or overflowed, or the
+// last scan failed) the run gets no dirtyRects and searches everything. Runs
+// of one plan never overlap (one scan at a time, each node runs its plans
+// once).
+const PARKED_AREA = { x: 0, y: 0, width: 0, height: 0 };
+const nodePlans = new WeakMap();
+const planStates = [];
+
+function compilePlan(tasks) {
+  if (Object.keys(tasks).length === 0) return null;
+  const state = { handle: findSequences.compileSearchPlan(tasks), log: new DirtyRectLog() };
+  planStates.push(state);
+  return state;
+}
+
+function runNodePlan(state, buffer, searchAreas, metadata) {
+  const dirtyRects = state.log.take(metadata.frameNumber, metadata.postedFrameNumber);
+  return findSequences.runPlan(
+    state.handle,
+    buffer,
+    dirtyRects ? { searchAreas, dirtyRects } : { searchAreas },
+  );
+}
+
+function addPlanDirtyRects(frameNumber, rects) {
+  for (const state of planStates) state.log.add(frameNumber, rects);
+}
+
+function forgetPlanResults() {
+  for (const state of planStates) state.log.forget();
+}
+
+function getNodePlans(definitions) {
+  let plans = nodePlans.get(definitions);
+  if (plans) return plans;
+  const discoveryTasks = {};
+  const endpointTasks = {};
+  for (const [name, def] of Object.entries(definitions)) {
+    if (def.type === 'single') {
+      discoveryTasks[name] = {
+        sequences: { [name]: def },
+        searchArea: PARKED_AREA,
+        occurrence: 'first',
+      };
+    } else if (def.type === 'boundingBox') {
+      discoveryTasks[`${name}_start`] = {
+        sequences: { [`${name}_start`]: def.start },
+        searchArea: PARKED_AREA,
+        occurrence: 'first',
+      };
+      endpointTasks[`${name}_end`] = {
+        sequences: { [`${name}_end`]: def.end },
+        searchArea: PARKED_AREA,
+        occurrence: 'first',
+      };
+    }
+  }
+  plans = {
+    discovery: compilePlan(discoveryTasks),
+    endpoint: compilePlan(endpointTasks),
+  };
+  nodePlans.set(definitions, plans);
+  return plans;
+}
+
 // --- Recursive Region Finding Logic ---
 async function findRegionsRecursive(
   buffer,
@@ -213,7 +284,7 @@ async function findRegionsRecursive(
   parentResult,
   metadata,
 ) {
-  const discoveryTasks = {};
+  const discoveryAreas = {};
   const boundingBoxDefs = {};
   const fixedDefs = {};
   const defEntries = Object.entries(definitions);
@@ -227,11 +298,7 @@ async function findRegionsRecursive(
           searchArea,
           metadata,
         );
-        discoveryTasks[name] = {
-          sequences: { [name]: def },
-          searchArea: singleSearchArea,
-          occurrence: 'first',
-        };
+        discoveryAreas[name] = singleSearchArea;
         break;
       case 'boundingBox':
         const boundingBoxSearchArea = calculateConstrainedSearchArea(
@@ -239,11 +306,7 @@ async function findRegionsRecursive(
           searchArea,
           metadata,
         );
-        discoveryTasks[`${name}_start`] = {
-          sequences: { [`${name}_start`]: def.start },
-          searchArea: boundingBoxSearchArea,
-          occurrence: 'first',
-        };
+        discoveryAreas[`${name}_start`] = boundingBoxSearchArea;
         boundingBoxDefs[name] = def;
         break;
       case 'fixed':
@@ -261,13 +324,16 @@ async function findRegionsRecursive(
     };
   }
 
-  if (!Object.keys(discoveryTasks).length) return;
+  if (!Object.keys(discoveryAreas).length) return;
 
-  const discoveryResults = await findSequences.findSequencesNativeBatch(
+  const plans = getNodePlans(definitions);
+  const discoveryResults = await runNodePlan(
+    plans.discovery,
     buffer,
-    discoveryTasks,
+    discoveryAreas,
+    metadata,
   );
-  const endpointTasks = {};
+  const endpointAreas = {};
   const foundStarts = {};
   const childInvocations = [];
 
@@ -314,19 +380,17 @@ async function findRegionsRecursive(
       height: Math.min(maxH, searchArea.y + searchArea.height - startResult.y),
     };
     if (endSearchArea.width > 0 && endSearchArea.height > 0) {
-      endpointTasks[`${name}_end`] = {
-        sequences: { [`${name}_end`]: def.end },
-        searchArea: endSearchArea,
-        occurrence: 'first',
-      };
+      endpointAreas[`${name}_end`] = endSearchArea;
     }
   }
 
   let endpointResults = {};
-  if (Object.keys(endpointTasks).length > 0) {
-    endpointResults = await findSequences.findSequencesNativeBatch(
+  if (Object.keys(endpointAreas).length > 0) {
+    endpointResults = await runNodePlan(
+      plans.endpoint,
       buffer,
-      endpointTasks,
+      endpointAreas,
+      metadata,
     );
   }
 
@@ -485,9 +549,15 @@ async function mainLoop() {
       }
 
       isScanning = true;
-      sharedBufferView = getReadableBuffer(); // Refresh buffer
+      const readable = getReadableFrame(); // Refresh buffer
+      sharedBufferView = readable.buffer;
       try {
-        const metadata = { width, height};
+        const metadata = {
+          width,
+          height,
+          frameNumber: readable.frameNumber,
+          postedFrameNumber: postedFrameNumber(readable.frameNumber),
+        };
 
         const now = Date.now();
         let updatedRegions;
@@ -525,6 +595,7 @@ async function mainLoop() {
       } catch (err) {
         console.error('[RegionMonitor] Error during scan:', err);
         lastKnownRegions = {};
+        forgetPlanResults();
       } finally {
         isScanning = false;
       }
@@ -549,6 +620,7 @@ parentPort.on('message', (message) => {
   try {
     if (message.type === 'frame-update') {
       frameUpdateManager.addDirtyRects(message.payload.dirtyRects);
+      addPlanDirtyRects(message.payload.frameNumber, message.payload.dirtyRects);
       return;
     }
 
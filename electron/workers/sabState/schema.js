@@ -31,9 +31,10 @@ export const SCHEMA = {
       x: FIELD_TYPES.INT32,
       y: FIELD_TYPES.INT32,
       z: FIELD_TYPES.INT32,
+      zoomScale: FIELD_TYPES.INT32, // Minimap pixels per tile the position was found at
       version: FIELD_TYPES.INT32,
     },
-    size: 4, // 4 Int32 fields
+    size: 5, // 5 Int32 fields
     description: 'Player minimap position (written by minimapMonitor)',
   },
 
@@ -66,7 +66,9 @@ const hpStringToCode = {
   Obstructed: 5,
 };
 
-const hpCodeToString = [
+// Indexed by hp code; the codes are also the healthClass of the native
+// health bar records.
+export const hpCodeToString = [
   'Full',
   'High',
   'Medium',
@@ -11,21 +11,17 @@ import { FrameUpdateManager } from '../utils/frameUpdateManager.js';
 import findSequences from 'find-sequences-native';
 import actionBarItems from '../constants/actionBarItems.js';
 import { rectsIntersect } from '../utils/rectsIntersect.js';
+import { createFrameSource } from './capture/frameRing.js';
 
 const { sharedData } = workerData;
 const SCAN_INTERVAL_MS = 50;
 
 if (!sharedData) throw new Error('[ScreenMonitor] Shared data not provided.');
-const { imageSAB_A, imageSAB_B, syncSAB } = sharedData;
+const { syncSAB } = sharedData;
 const syncArray = new Int32Array(syncSAB);
 
-// Double buffering
-const imageBuffers = [Buffer.from(imageSAB_A), Buffer.from(imageSAB_B)];
-const READABLE_BUFFER_INDEX = 5;
-function getReadableBuffer() {
-  const index = Atomics.load(syncArray, READABLE_BUFFER_INDEX);
-  return imageBuffers[index];
-}
+// Double buffering, or the zero-copy frame ring when one is shared
+const { getReadableBuffer } = createFrameSource(sharedData);
 let sharedBufferView = getReadableBuffer();
 
 const WIDTH_INDEX = 1;
@@ -281,37 +277,49 @@ function calculateEquippedItems(amuletSlot, ringSlot, bootsSlot) {
   };
 }
 
+let actionBarPlan = null;
+let actionBarPlanNames = null;
+
 async function findActionItemsInHotkeyBar(hotkeyBarRegion, buffer, metadata) {
     if (!hotkeyBarRegion || !hotkeyBarRegion.width || !hotkeyBarRegion.height) {
         return {};
     }
 
-    const tasks = {};
-    for (const [key, value] of Object.entries(actionBarItems)) {
-        tasks[key] = {
-            sequences: { [key]: value },
-            searchArea: hotkeyBarRegion,
-            occurrence: "first",
-        };
+    // The task set never changes, only the hotkey bar position: compile it once.
+    if (!actionBarPlan) {
+        const tasks = {};
+        for (const [key, value] of Object.entries(actionBarItems)) {
+            tasks[key] = {
+                sequences: { [key]: value },
+                searchArea: hotkeyBarRegion,
+                occurrence: "first",
+            };
+        }
+        actionBarPlan = findSequences.compileSearchPlan(tasks);
+        actionBarPlanNames = findSequences.getPlanNames(actionBarPlan);
     }
 
-    const results = await findSequences.findSequencesNativeBatch(buffer, tasks);
+    // Flat (nameIndex, x, y, variant) records: no per-item result objects.
+    const records = await findSequences.runPlan(actionBarPlan, buffer, {
+        searchArea: hotkeyBarRegion,
+        output: 'records',
+    });
     const foundItems = {};
-    for (const [itemName, itemResult] of Object.entries(results)) {
-        if (itemResult[itemName]) {
-            const def = actionBarItems[itemName];
-            const result = itemResult[itemName];
-            foundItems[itemName] = {
-                x: result.x,
-                y: result.y,
-                width: def.direction === 'vertical' ? 1 : def.sequence.length,
-                height: def.direction === 'vertical' ? def.sequence.length : 1,
-                rawPos: {
-                    x: result.x - (def.offset?.x || 0),
-                    y: result.y - (def.offset?.y || 0),
-                },
-            };
-        }
+    for (let i = 0; i < records.length; i += 4) {
+        const itemName = actionBarPlanNames[records[i]].name;
+        const x = records[i + 1];
+        const y = records[i + 2];
+        const def = actionBarItems[itemName];
+        foundItems[itemName] = {
+            x,
+            y,
+            width: def.direction === 'vertical' ? 1 : def.sequence.length,
+            height: def.direction === 'vertical' ? def.sequence.length : 1,
+            rawPos: {
+                x: x - (def.offset?.x || 0),
+                y: y - (def.offset?.y || 0),
+            },
+        };
     }
     return foundItems;
 }
@@ -0,0 +1,398 @@
+// healthBarScan.h - Health bar detection shared by findHealthBars and frameAnalyzer.
+//
+// A bar is a 31x4 black frame: black columns at x and x + 30 on all four
+// rows, black top and bottom rows between them, and a known fill colour
+// inside. BarScanner keeps the black-pixel bitmaps of the last four rows of a
+// search span, so each row is matched once and reused by the four bar
+// positions that include it. A bar's fill is measured as the run of its
+// fill colour along the inner row.
+//
+// BarTracker carries bars from one frame to the next: it gives them stable
+// ids and, given the frame's dirty rects, tells the caller which bars are
+// unchanged and where new or moved bars can be. TrackerHandle is the state
+// behind a JS tracker handle.
+
+#ifndef HEALTH_BAR_SCAN_H
+#define HEALTH_BAR_SCAN_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "pixelKernels.h"
+
+namespace health_bars {
+
+const uint32_t BAR_WIDTH = 31;
+const uint32_t BAR_HEIGHT = 4;
+const uint32_t BAR_INNER_WIDTH = BAR_WIDTH - 2;
+
+// Fill colour classes. The values are the hp codes sabStateManager stores.
+enum HealthClass : uint8_t {
+    HEALTH_FULL = 0,
+    HEALTH_HIGH = 1,
+    HEALTH_MEDIUM = 2,
+    HEALTH_LOW = 3,
+    HEALTH_CRITICAL = 4,
+    HEALTH_OBSTRUCTED = 5,
+};
+
+struct FoundHealthBar {
+    int x, y;                 // Centre: left + 15, top + 2
+    HealthClass healthClass;
+    uint8_t hpPercent;        // Filled share of the inner row, 0-100
+    uint32_t id = 0;          // BarTracker id; 0 when untracked
+};
+
+struct Rect {
+    uint32_t x, y, width, height;
+};
+
+// Record encoding, for callers that want bars as an Int32Array rather than
+// one object each: RECORD_FIELDS ints per bar, (x, y, hpPercent, healthClass,
+// id), with id 0 for untracked bars.
+const uint32_t RECORD_FIELDS = 5;
+
+// Writes up to `capacity` bars as records.
+inline void WriteRecords(const std::vector<FoundHealthBar>& bars, int32_t* p, size_t capacity) {
+    for (size_t i = 0; i < bars.size() && i < capacity; ++i, p += RECORD_FIELDS) {
+        const FoundHealthBar& bar = bars[i];
+        p[0] = bar.x;
+        p[1] = bar.y;
+        p[2] = bar.hpPercent;
+        p[3] = bar.healthClass;
+        p[4] = static_cast<int32_t>(bar.id);
+    }
+}
+
+inline bool IsKnownBarColor(uint32_t c) {
+    switch(c) {
+        case 0:          // 0x00000000 (Black - for empty bars)
+        case 49152:      // 0x0000C000
+        case 12582912:   // 0x00C00000
+        case 6340704:    // 0x0060C060
+        case 12632064:   // 0x00C0C000
+        case 12595248:   // 0x00C03030
+        case 6291456:    // 0x00600000
+        // --- NEW COLOR ADDED ---
+        case 12632256:   // 0x00C0C0C0 (Gray [192, 192, 192])
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline HealthClass GetHealthClassFromColor(uint32_t color) {
+    if (color == 0x600000 || color == 0) return HEALTH_CRITICAL;
+    if (color == 0xC00000 || color == 0xC03030) return HEALTH_LOW;
+    if (color == 0xC0C000) return HEALTH_MEDIUM;
+    if (color == 0x60C060) return HEALTH_HIGH;
+    if (color == 0x00C000) return HEALTH_FULL;
+    if (color == 0xC0C0C0) return HEALTH_OBSTRUCTED;
+    return HEALTH_FULL;
+}
+
+// The healthTag string JS sees for a class.
+inline const char* HealthTagName(HealthClass healthClass) {
+    static const char* const names[] = {"Full", "High", "Medium", "Low", "Critical", "Obstructed"};
+    return healthClass <= HEALTH_OBSTRUCTED ? names[healthClass] : "Full";
+}
+
+// Percentage of the inner row, from its left end, in fillColor. An empty
+// bar (black fill) measures 0.
+inline uint8_t MeasureFill(const uint8_t* innerRow, uint32_t fillColor) {
+    if (fillColor == 0) return 0;
+    uint64_t filled;
+    pixel_kernels::Active().matchColors(innerRow, BAR_INNER_WIDTH, &fillColor, 1, 0x00FFFFFF, &filled);
+    uint32_t run = std::min<uint32_t>(static_cast<uint32_t>(__builtin_ctzll(~filled)), BAR_INNER_WIDTH);
+    return static_cast<uint8_t>((run * 100 + BAR_INNER_WIDTH / 2) / BAR_INNER_WIDTH);
+}
+
+// True if bits [begin, begin + count) are all set.
+inline bool AllBitsSet(const uint64_t* bits, uint32_t begin, uint32_t count) {
+    for (uint32_t i = begin, end = begin + count; i < end;) {
+        uint32_t shift = i & 63, n = std::min(64 - shift, end - i);
+        uint64_t want = (n == 64 ? ~0ULL : ((1ULL << n) - 1)) << shift;
+        if ((bits[i >> 6] & want) != want) return false;
+        i += n;
+    }
+    return true;
+}
+
+// Finds bars starting in columns [x, x + width - BAR_WIDTH) of a frame;
+// width must be at least BAR_WIDTH + 1.
+class BarScanner {
+public:
+    BarScanner(uint32_t x, uint32_t width)
+        : x(x), width(width), words((width + 63) / 64), black_rows(BAR_HEIGHT * words) {}
+
+    // Matches row r's black pixels. A bar at row y needs rows y .. y + 3 added.
+    void AddRow(const uint8_t* bgraData, uint32_t stride, uint32_t r) {
+        static const uint32_t black = 0;
+        pixel_kernels::Active().matchColors(bgraData + (r * stride) + (x * 4), width, &black, 1, 0x00FFFFFF, BlackRow(r));
+    }
+
+    // Appends the bars whose top row is y.
+    void FindBars(const uint8_t* bgraData, uint32_t stride, uint32_t y, std::vector<FoundHealthBar>& out) const {
+        const uint64_t* b0 = BlackRow(y);
+        const uint64_t* b1 = BlackRow(y + 1);
+        const uint64_t* b2 = BlackRow(y + 2);
+        const uint64_t* b3 = BlackRow(y + 3);
+        const uint8_t* row1 = bgraData + ((y + 1) * stride);
+        const uint32_t endI = width - BAR_WIDTH;  // Bar starts, relative to x
+
+        for (uint32_t w = 0; w < words && w * 64 < endI; ++w) {
+            for (uint64_t left = b0[w] & b1[w] & b2[w] & b3[w]; left; left &= left - 1) {
+                uint32_t i = w * 64 + static_cast<uint32_t>(__builtin_ctzll(left));
+                if (i >= endI) break;
+
+                uint32_t r = i + BAR_WIDTH - 1;
+                if (!((b0[r >> 6] & b1[r >> 6] & b2[r >> 6] & b3[r >> 6]) >> (r & 63) & 1)) continue;
+                if (!AllBitsSet(b0, i + 1, BAR_WIDTH - 2) || !AllBitsSet(b3, i + 1, BAR_WIDTH - 2)) continue;
+
+                uint32_t current_x = x + i;
+                const uint8_t* innerPixelPtr = row1 + (current_x + 1) * 4;
+                uint32_t innerColor = (static_cast<uint32_t>(innerPixelPtr[2]) << 16) |
+                                      (static_cast<uint32_t>(innerPixelPtr[1]) << 8) |
+                                      innerPixelPtr[0];
+
+                if (!IsKnownBarColor(innerColor)) continue;
+
+                int centerX = static_cast<int>(current_x + 15);
+                int centerY = static_cast<int>(y + 2);
+                out.push_back({ centerX, centerY, GetHealthClassFromColor(innerColor), MeasureFill(innerPixelPtr, innerColor) });
+            }
+        }
+    }
+
+private:
+    uint64_t* BlackRow(uint32_t r) { return black_rows.data() + (r & 3) * words; }  // Row r in slot r % 4
+    const uint64_t* BlackRow(uint32_t r) const { return black_rows.data() + (r & 3) * words; }
+
+    uint32_t x, width, words;
+    std::vector<uint64_t> black_rows;
+};
+
+// Merges detections of the same bar (touching within a bar's size) into
+// their average position.
+inline std::vector<FoundHealthBar> ClusterBars(std::vector<FoundHealthBar>& results) {
+    if (results.empty()) return {};
+
+    const int CELL_WIDTH = 32;
+    const int CELL_HEIGHT = 4;
+
+    int minX = results[0].x, maxX = results[0].x;
+    int minY = results[0].y, maxY = results[0].y;
+    for (const auto& r : results) {
+        minX = std::min(minX, r.x);
+        maxX = std::max(maxX, r.x);
+        minY = std::min(minY, r.y);
+        maxY = std::max(maxY, r.y);
+    }
+
+    int gridW = (maxX - minX) / CELL_WIDTH + 1;
+    int gridH = (maxY - minY) / CELL_HEIGHT + 1;
+
+    // Flat grid: the detections of cell c are cellItems[cellStart[c] .. cellStart[c + 1]).
+    std::vector<uint32_t> cellOf(results.size());
+    std::vector<uint32_t> cellStart(static_cast<size_t>(gridW) * gridH + 1, 0);
+    std::vector<uint32_t> cellItems(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        int cellX = (results[i].x - minX) / CELL_WIDTH;
+        int cellY = (results[i].y - minY) / CELL_HEIGHT;
+        cellOf[i] = static_cast<uint32_t>(cellY * gridW + cellX);
+        ++cellStart[cellOf[i] + 1];
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c) cellStart[c] += cellStart[c - 1];
+    {
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < results.size(); ++i) cellItems[fill[cellOf[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<bool> visited(results.size(), false);
+    std::vector<FoundHealthBar> mergedResults;
+    std::vector<size_t> cluster;
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (visited[i]) continue;
+
+        cluster.clear();
+        cluster.push_back(i);
+        visited[i] = true;
+
+        size_t head = 0;
+        while (head < cluster.size()) {
+            size_t current_idx = cluster[head++];
+            const auto& current = results[current_idx];
+
+            int cellX = static_cast<int>(cellOf[current_idx]) % gridW;
+            int cellY = static_cast<int>(cellOf[current_idx]) / gridW;
+
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    int nx = cellX + dx;
+                    int ny = cellY + dy;
+                    if (nx < 0 || ny < 0 || nx >= gridW || ny >= gridH) continue;
+
+                    uint32_t c = static_cast<uint32_t>(ny * gridW + nx);
+                    for (uint32_t k = cellStart[c]; k < cellStart[c + 1]; ++k) {
+                        uint32_t j = cellItems[k];
+                        if (visited[j]) continue;
+                        bool x_touch = std::abs(current.x - results[j].x) <= static_cast<int>(BAR_WIDTH);
+                        bool y_touch = std::abs(current.y - results[j].y) <= static_cast<int>(BAR_HEIGHT);
+                        if (x_touch && y_touch) {
+                            visited[j] = true;
+                            cluster.push_back(j);
+                        }
+                    }
+                }
+            }
+        }
+
+        double sumX = 0, sumY = 0;
+        for (size_t idx : cluster) {
+            sumX += results[idx].x;
+            sumY += results[idx].y;
+        }
+
+        mergedResults.push_back({
+            static_cast<int>(std::round(sumX / cluster.size())),
+            static_cast<int>(std::round(sumY / cluster.size())),
+            results[cluster[0]].healthClass,
+            results[cluster[0]].hpPercent
+        });
+    }
+
+    return mergedResults;
+}
+
+// Bar top-left corners, as a rect of positions, whose bar would overlap
+// `dirty` and lie in the search area (the starts a full scan of area tries).
+// False when there are none.
+inline bool DirtyStarts(const Rect& dirty, const Rect& area, Rect& starts) {
+    if (area.width <= BAR_WIDTH || area.height == 0) return false;
+    int64_t x0 = std::max<int64_t>(area.x, static_cast<int64_t>(dirty.x) - (BAR_WIDTH - 1));
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(dirty.x) + dirty.width, area.x + area.width - BAR_WIDTH);
+    int64_t y0 = std::max<int64_t>(area.y, static_cast<int64_t>(dirty.y) - (BAR_HEIGHT - 1));
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(dirty.y) + dirty.height, area.y + area.height);
+    if (x0 >= x1 || y0 >= y1) return false;
+    starts = { static_cast<uint32_t>(x0), static_cast<uint32_t>(y0),
+               static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0) };
+    return true;
+}
+
+// Follows bars across frames. Update() gives each bar of a new frame the id
+// of the nearest unclaimed bar of the previous frame within maxMotion pixels
+// (a creature moves at most a tile between two scans), or a fresh id.
+//
+// When the caller knows what changed since the previous frame, it only has
+// to scan DirtyStarts of each dirty rect: bars no dirty rect touches sit on
+// unchanged pixels and come back from CleanBars with their ids.
+class BarTracker {
+public:
+    static const uint32_t DEFAULT_MAX_MOTION = 32;  // One tile
+
+    explicit BarTracker(uint32_t maxMotion = DEFAULT_MAX_MOTION) : maxMotion(maxMotion) {}
+
+    // Whether the previous frame's bars were found in the same frame size and
+    // search area, so CleanBars can stand in for rescanning.
+    bool HasHistory(uint32_t frameWidth, uint32_t frameHeight, const Rect& area) const {
+        return valid && frameWidth == lastWidth && frameHeight == lastHeight &&
+               area.x == lastArea.x && area.y == lastArea.y &&
+               area.width == lastArea.width && area.height == lastArea.height;
+    }
+
+    // Drops the previous frame as a base for CleanBars (ids still carry over),
+    // e.g. when the caller lost track of what changed since it.
+    void ForgetHistory() { valid = false; }
+
+    // The previous frame's bars that no dirty rect overlaps.
+    std::vector<FoundHealthBar> CleanBars(const std::vector<Rect>& dirtyRects) const {
+        std::vector<FoundHealthBar> clean;
+        for (const FoundHealthBar& bar : tracks) {
+            int64_t left = bar.x - 15, top = bar.y - 2;
+            bool touched = false;
+            for (const Rect& d : dirtyRects) {
+                if (left < static_cast<int64_t>(d.x) + d.width && left + BAR_WIDTH > d.x &&
+                    top < static_cast<int64_t>(d.y) + d.height && top + BAR_HEIGHT > d.y) {
+                    touched = true;
+                    break;
+                }
+            }
+            if (!touched) clean.push_back(bar);
+        }
+        return clean;
+    }
+
+    // Assigns ids to the bars without one and remembers bars as the previous
+    // frame. Bars that already have an id (from CleanBars) keep it.
+    void Update(std::vector<FoundHealthBar>& bars, uint32_t frameWidth, uint32_t frameHeight, const Rect& area) {
+        std::vector<bool> claimed(tracks.size(), false);
+        for (const FoundHealthBar& bar : bars) {
+            if (bar.id == 0) continue;
+            for (size_t t = 0; t < tracks.size(); ++t) {
+                if (tracks[t].id == bar.id) claimed[t] = true;
+            }
+        }
+
+        // Closest pairs first, so a bar that stayed put keeps its id even if
+        // another bar moved next to it.
+        struct Candidate { uint32_t distance, bar, track; };
+        std::vector<Candidate> candidates;
+        for (size_t b = 0; b < bars.size(); ++b) {
+            if (bars[b].id != 0) continue;
+            for (size_t t = 0; t < tracks.size(); ++t) {
+                if (claimed[t]) continue;
+                uint32_t distance = static_cast<uint32_t>(std::max(std::abs(bars[b].x - tracks[t].x),
+                                                                   std::abs(bars[b].y - tracks[t].y)));
+                if (distance <= maxMotion) candidates.push_back({ distance, static_cast<uint32_t>(b), static_cast<uint32_t>(t) });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            if (a.distance != b.distance) return a.distance < b.distance;
+            return a.bar != b.bar ? a.bar < b.bar : a.track < b.track;
+        });
+        for (const Candidate& c : candidates) {
+            if (bars[c.bar].id != 0 || claimed[c.track]) continue;
+            bars[c.bar].id = tracks[c.track].id;
+            claimed[c.track] = true;
+        }
+        for (FoundHealthBar& bar : bars) {
+            if (bar.id == 0) bar.id = nextId++;
+        }
+
+        tracks = bars;
+        lastWidth = frameWidth;
+        lastHeight = frameHeight;
+        lastArea = area;
+        valid = true;
+    }
+
+private:
+    uint32_t maxMotion;
+    uint32_t nextId = 1;
+    bool valid = false;
+    uint32_t lastWidth = 0, lastHeight = 0;
+    Rect lastArea = {0, 0, 0, 0};
+    std::vector<FoundHealthBar> tracks;
+};
+
+// What a createHealthBarTracker handle points to. findHealthBars and
+// frameAnalyzer share this type, so a tracker made by either addon works with
+// both. Calls are counted so a result that a newer call on the same tracker
+// overtook (an async frameAnalyzer scan) does not become its history.
+struct TrackerHandle {
+    BarTracker tracker;
+    uint32_t calls = 0;     // Calls started
+    uint32_t inFlight = 0;  // Calls whose results are not applied yet
+    explicit TrackerHandle(uint32_t maxMotion) : tracker(maxMotion) {}
+};
+
+// napi_type_tag (lower, upper) of the External around a TrackerHandle. JS can
+// pass any External, so the bindings check this tag before casting.
+const uint64_t TRACKER_TYPE_TAG_LOWER = 0x6a1f3c9e84b2d057ULL;
+const uint64_t TRACKER_TYPE_TAG_UPPER = 0xd93e07b5a2c4816fULL;
+
+} // namespace health_bars
+
+#endif // HEALTH_BAR_SCAN_H
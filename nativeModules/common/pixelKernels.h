@@ -0,0 +1,454 @@
+// pixelKernels.h - Per-ISA pixel scan kernels shared by the vision modules.
+//
+// The modules build for baseline x86-64 (see their binding.gyp), so one
+// artifact runs on every CPU. The hot scans live here in scalar, SSE4.2, AVX2
+// and AVX-512BW versions, each compiled with its own target attribute, and the
+// widest one the CPU supports is picked once through cpuid. AUTOMATON_SIMD=
+// scalar|sse4.2|avx2|avx512 caps the choice (benchmarks, bug reports).
+//
+// Every kernel reads `count` BGRA pixels from a row. The bitmap kernels write
+// one bit per pixel: bit i % 64 of bits[i / 64], all (count + 63) / 64 words
+// written. mapPalette writes one byte per pixel, hashLanes eight hash lanes.
+// Kernels only touch raw pointers: a std:: template instantiated inside a
+// target-attributed function could be merged into code the baseline runs.
+
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace pixel_kernels {
+
+enum class SimdLevel { Scalar, Sse42, Avx2, Avx512bw };
+
+inline const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512bw: return "avx512";
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Sse42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+// The widest level the CPU (and OS, for the wide registers) supports, capped
+// by AUTOMATON_SIMD.
+inline SimdLevel DetectSimdLevel() {
+    SimdLevel level = SimdLevel::Scalar;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) level = SimdLevel::Sse42;
+    if (__builtin_cpu_supports("avx2")) level = SimdLevel::Avx2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) level = SimdLevel::Avx512bw;
+#endif
+    if (const char* cap = getenv("AUTOMATON_SIMD")) {
+        for (int l = 0; l <= static_cast<int>(SimdLevel::Avx512bw); ++l) {
+            if (strcmp(cap, SimdLevelName(static_cast<SimdLevel>(l))) == 0 && static_cast<SimdLevel>(l) < level) level = static_cast<SimdLevel>(l);
+        }
+    }
+    return level;
+}
+
+// matchColors: (pixel & mask) equals one of colors[0 .. colorCount), which are
+//   already masked.
+// nearColor: every byte of the pixel is within the same byte of `limit` of
+//   `color`; a 0xFF limit byte ignores that channel.
+// hashFilter: bit ((pixel & 0xFFFFFF) * multiplier) >> (32 - filterBitsLog2)
+//   is set in the filter bitset (32-bit words).
+// diffPixels: the pixel differs from the same pixel of `other`.
+// mapPalette: out[i] is the index of the first of keys[0 .. keyCount) equal to
+//   pixel & 0xFFFFFF, or `fallback`; keyCount is at most 256.
+// hashLanes: pixel i is folded into lane i % 8 as lane = (lane ^ pixel) *
+//   prime, lanes starting at 0. Returns whether any pixel differs from
+//   `previous` (false when previous is null).
+using MatchColorsFn = void (*)(const uint8_t* row, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits);
+using NearColorFn = void (*)(const uint8_t* row, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits);
+using HashFilterFn = void (*)(const uint8_t* row, uint32_t count, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier, uint64_t* bits);
+using DiffPixelsFn = void (*)(const uint8_t* row, uint32_t count, const uint8_t* other, uint64_t* bits);
+using MapPaletteFn = void (*)(const uint8_t* row, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out);
+using HashLanesFn = bool (*)(const uint8_t* row, uint32_t count, const uint8_t* previous, uint32_t prime, uint32_t lanes[8]);
+
+struct Kernels {
+    SimdLevel level;
+    MatchColorsFn matchColors;
+    NearColorFn nearColor;
+    HashFilterFn hashFilter;
+    DiffPixelsFn diffPixels;
+    MapPaletteFn mapPalette;
+    HashLanesFn hashLanes;
+};
+
+// Calls fn(i) for every set bit i < count, ascending.
+template <typename F>
+inline void ForEachBit(const uint64_t* bits, uint32_t count, F&& fn) {
+    for (uint32_t w = 0; w < (count + 63) / 64; ++w) {
+        for (uint64_t word = bits[w]; word; word &= word - 1) fn(w * 64 + static_cast<uint32_t>(__builtin_ctzll(word)));
+    }
+}
+
+namespace detail {
+
+inline uint32_t LoadPixel(const uint8_t* row, uint32_t i) {
+    uint32_t pixel;
+    memcpy(&pixel, row + static_cast<size_t>(i) * 4, 4);
+    return pixel;
+}
+inline void ClearBits(uint32_t count, uint64_t* bits) { memset(bits, 0, ((count + 63) / 64) * sizeof(uint64_t)); }
+inline void SetBit(uint64_t* bits, uint32_t i) { bits[i >> 6] |= uint64_t(1) << (i & 63); }
+inline void SetBits(uint64_t* bits, uint32_t i, uint64_t laneMask) {
+    // Blocks of 4, 8 or 16 never straddle a word when i is a multiple of the block.
+    bits[i >> 6] |= laneMask << (i & 63);
+}
+
+// --- Scalar, from `begin` (used for the vector kernels' tails too) ---
+inline bool MatchesColor(uint32_t pixel, const uint32_t* colors, uint32_t colorCount, uint32_t mask) {
+    for (uint32_t c = 0; c < colorCount; ++c) if ((pixel & mask) == colors[c]) return true;
+    return false;
+}
+inline bool NearColor(uint32_t pixel, uint32_t color, uint32_t limit) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        int d = static_cast<int>((pixel >> shift) & 0xFF) - static_cast<int>((color >> shift) & 0xFF);
+        if ((d < 0 ? -d : d) > static_cast<int>((limit >> shift) & 0xFF)) return false;
+    }
+    return true;
+}
+inline bool InFilter(uint32_t pixel, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier) {
+    uint32_t h = ((pixel & 0x00FFFFFF) * multiplier) >> (32 - filterBitsLog2);
+    return filter[h >> 5] & (1u << (h & 31));
+}
+
+inline void MatchColorsTail(const uint8_t* row, uint32_t begin, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits) {
+    for (uint32_t i = begin; i < count; ++i) if (MatchesColor(LoadPixel(row, i), colors, colorCount, mask)) SetBit(bits, i);
+}
+inline void NearColorTail(const uint8_t* row, uint32_t begin, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits) {
+    for (uint32_t i = begin; i < count; ++i) if (NearColor(LoadPixel(row, i), color, limit)) SetBit(bits, i);
+}
+inline void HashFilterTail(const uint8_t* row, uint32_t begin, uint32_t count, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier, uint64_t* bits) {
+    for (uint32_t i = begin; i < count; ++i) if (InFilter(LoadPixel(row, i), filter, filterBitsLog2, multiplier)) SetBit(bits, i);
+}
+
+inline void DiffPixelsTail(const uint8_t* row, uint32_t begin, uint32_t count, const uint8_t* other, uint64_t* bits) {
+    for (uint32_t i = begin; i < count; ++i) if (LoadPixel(row, i) != LoadPixel(other, i)) SetBit(bits, i);
+}
+inline void MapPaletteTail(const uint8_t* row, uint32_t begin, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out) {
+    for (uint32_t i = begin; i < count; ++i) {
+        uint32_t key = LoadPixel(row, i) & 0x00FFFFFF;
+        uint8_t index = fallback;
+        for (uint32_t k = 0; k < keyCount; ++k) {
+            if (keys[k] == key) { index = static_cast<uint8_t>(k); break; }
+        }
+        out[i] = index;
+    }
+}
+// Continues lanes that already hold pixels [0, begin).
+inline bool HashLanesTail(const uint8_t* row, uint32_t begin, uint32_t count, const uint8_t* previous, uint32_t prime, uint32_t lanes[8], bool changed) {
+    for (uint32_t i = begin; i < count; ++i) {
+        uint32_t pixel = LoadPixel(row, i);
+        lanes[i & 7] = (lanes[i & 7] ^ pixel) * prime;
+        if (previous && !changed && pixel != LoadPixel(previous, i)) changed = true;
+    }
+    return changed;
+}
+
+inline void MatchColorsScalar(const uint8_t* row, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits) {
+    ClearBits(count, bits);
+    MatchColorsTail(row, 0, count, colors, colorCount, mask, bits);
+}
+inline void NearColorScalar(const uint8_t* row, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits) {
+    ClearBits(count, bits);
+    NearColorTail(row, 0, count, color, limit, bits);
+}
+inline void HashFilterScalar(const uint8_t* row, uint32_t count, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier, uint64_t* bits) {
+    ClearBits(count, bits);
+    HashFilterTail(row, 0, count, filter, filterBitsLog2, multiplier, bits);
+}
+inline void DiffPixelsScalar(const uint8_t* row, uint32_t count, const uint8_t* other, uint64_t* bits) {
+    ClearBits(count, bits);
+    DiffPixelsTail(row, 0, count, other, bits);
+}
+inline void MapPaletteScalar(const uint8_t* row, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out) {
+    MapPaletteTail(row, 0, count, keys, keyCount, fallback, out);
+}
+inline bool HashLanesScalar(const uint8_t* row, uint32_t count, const uint8_t* previous, uint32_t prime, uint32_t lanes[8]) {
+    memset(lanes, 0, 8 * sizeof(uint32_t));
+    return HashLanesTail(row, 0, count, previous, prime, lanes, false);
+}
+
+// --- SSE4.2: 4 pixels per step. No gather, so hashFilter stays scalar. ---
+__attribute__((target("sse4.2")))
+inline void MatchColorsSse42(const uint8_t* row, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m128i maskV = _mm_set1_epi32(static_cast<int>(mask));
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4)), maskV);
+        __m128i acc = _mm_setzero_si128();
+        for (uint32_t c = 0; c < colorCount; ++c) acc = _mm_or_si128(acc, _mm_cmpeq_epi32(pixels, _mm_set1_epi32(static_cast<int>(colors[c]))));
+        SetBits(bits, i, static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(acc))));
+    }
+    MatchColorsTail(row, i, count, colors, colorCount, mask, bits);
+}
+
+__attribute__((target("sse4.2")))
+inline void NearColorSse42(const uint8_t* row, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m128i target = _mm_set1_epi32(static_cast<int>(color));
+    const __m128i limitV = _mm_set1_epi32(static_cast<int>(limit));
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(pixels, target), _mm_subs_epu8(target, pixels));
+        __m128i over = _mm_subs_epu8(diff, limitV);
+        SetBits(bits, i, static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(over, zero)))));
+    }
+    NearColorTail(row, i, count, color, limit, bits);
+}
+
+__attribute__((target("sse4.2")))
+inline void DiffPixelsSse42(const uint8_t* row, uint32_t count, const uint8_t* other, uint64_t* bits) {
+    ClearBits(count, bits);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(other + i * 4));
+        SetBits(bits, i, static_cast<uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))) & 0xF));
+    }
+    DiffPixelsTail(row, i, count, other, bits);
+}
+
+// Keys are blended last to first, so the first matching key wins.
+__attribute__((target("sse4.2")))
+inline void MapPaletteSse42(const uint8_t* row, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out) {
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i packBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4)), rgbMask);
+        __m128i indices = _mm_set1_epi32(fallback);
+        for (uint32_t k = keyCount; k-- > 0;) {
+            __m128i hit = _mm_cmpeq_epi32(pixels, _mm_set1_epi32(static_cast<int>(keys[k])));
+            indices = _mm_blendv_epi8(indices, _mm_set1_epi32(static_cast<int>(k)), hit);
+        }
+        uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi8(indices, packBytes)));
+        memcpy(out + i, &packed, 4);
+    }
+    MapPaletteTail(row, i, count, keys, keyCount, fallback, out);
+}
+
+// Lanes 0-3 and 4-7 live in two registers; pixels go in 8 at a time.
+__attribute__((target("sse4.2")))
+inline bool HashLanesSse42(const uint8_t* row, uint32_t count, const uint8_t* previous, uint32_t prime, uint32_t lanes[8]) {
+    const __m128i primeV = _mm_set1_epi32(static_cast<int>(prime));
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128(), diff = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 4 + 16));
+        lo = _mm_mullo_epi32(_mm_xor_si128(lo, a), primeV);
+        hi = _mm_mullo_epi32(_mm_xor_si128(hi, b), primeV);
+        if (previous) {
+            diff = _mm_or_si128(diff, _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i * 4))));
+            diff = _mm_or_si128(diff, _mm_xor_si128(b, _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i * 4 + 16))));
+        }
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 4), hi);
+    return HashLanesTail(row, i, count, previous, prime, lanes, !_mm_testz_si128(diff, diff));
+}
+
+// --- AVX2: 8 pixels per step ---
+__attribute__((target("avx2")))
+inline void MatchColorsAvx2(const uint8_t* row, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m256i maskV = _mm256_set1_epi32(static_cast<int>(mask));
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4)), maskV);
+        __m256i acc = _mm256_setzero_si256();
+        for (uint32_t c = 0; c < colorCount; ++c) acc = _mm256_or_si256(acc, _mm256_cmpeq_epi32(pixels, _mm256_set1_epi32(static_cast<int>(colors[c]))));
+        SetBits(bits, i, static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(acc))));
+    }
+    MatchColorsTail(row, i, count, colors, colorCount, mask, bits);
+}
+
+__attribute__((target("avx2")))
+inline void NearColorAvx2(const uint8_t* row, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m256i target = _mm256_set1_epi32(static_cast<int>(color));
+    const __m256i limitV = _mm256_set1_epi32(static_cast<int>(limit));
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4));
+        // |pixel - target| per byte, then whatever exceeds the limit.
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(pixels, target), _mm256_subs_epu8(target, pixels));
+        __m256i over = _mm256_subs_epu8(diff, limitV);
+        SetBits(bits, i, static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(over, zero)))));
+    }
+    NearColorTail(row, i, count, color, limit, bits);
+}
+
+__attribute__((target("avx2")))
+inline void HashFilterAvx2(const uint8_t* row, uint32_t count, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+    const __m256i multiplierV = _mm256_set1_epi32(static_cast<int>(multiplier));
+    const __m256i bitMask = _mm256_set1_epi32(31);
+    const int* filterWords = reinterpret_cast<const int*>(filter);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4)), rgbMask);
+        __m256i h = _mm256_srli_epi32(_mm256_mullo_epi32(pixels, multiplierV), 32 - filterBitsLog2);
+        __m256i words = _mm256_i32gather_epi32(filterWords, _mm256_srli_epi32(h, 5), 4);
+        __m256i hit = _mm256_slli_epi32(_mm256_srlv_epi32(words, _mm256_and_si256(h, bitMask)), 31);
+        SetBits(bits, i, static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit))));
+    }
+    HashFilterTail(row, i, count, filter, filterBitsLog2, multiplier, bits);
+}
+
+__attribute__((target("avx2")))
+inline void DiffPixelsAvx2(const uint8_t* row, uint32_t count, const uint8_t* other, uint64_t* bits) {
+    ClearBits(count, bits);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i * 4));
+        SetBits(bits, i, static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))) & 0xFF));
+    }
+    DiffPixelsTail(row, i, count, other, bits);
+}
+
+__attribute__((target("avx2")))
+inline void MapPaletteAvx2(const uint8_t* row, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out) {
+    const __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+    // Gathers byte 0 of every dword into the low 4 bytes of each 128-bit lane.
+    const __m256i packBytes = _mm256_setr_epi8(
+        0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i joinLanes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4)), rgbMask);
+        __m256i indices = _mm256_set1_epi32(fallback);
+        for (uint32_t k = keyCount; k-- > 0;) {
+            __m256i hit = _mm256_cmpeq_epi32(pixels, _mm256_set1_epi32(static_cast<int>(keys[k])));
+            indices = _mm256_blendv_epi8(indices, _mm256_set1_epi32(static_cast<int>(k)), hit);
+        }
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(indices, packBytes), joinLanes);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+    }
+    MapPaletteTail(row, i, count, keys, keyCount, fallback, out);
+}
+
+// Also serves AVX-512: wider vectors would interleave the lanes differently.
+__attribute__((target("avx2")))
+inline bool HashLanesAvx2(const uint8_t* row, uint32_t count, const uint8_t* previous, uint32_t prime, uint32_t lanes[8]) {
+    const __m256i primeV = _mm256_set1_epi32(static_cast<int>(prime));
+    __m256i hash = _mm256_setzero_si256(), diff = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i * 4));
+        hash = _mm256_mullo_epi32(_mm256_xor_si256(hash, v), primeV);
+        if (previous) diff = _mm256_or_si256(diff, _mm256_xor_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + i * 4))));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), hash);
+    return HashLanesTail(row, i, count, previous, prime, lanes, !_mm256_testz_si256(diff, diff));
+}
+
+// --- AVX-512BW: 16 pixels per step, compares straight into mask registers ---
+__attribute__((target("avx512f,avx512bw")))
+inline void MatchColorsAvx512(const uint8_t* row, uint32_t count, const uint32_t* colors, uint32_t colorCount, uint32_t mask, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m512i maskV = _mm512_set1_epi32(static_cast<int>(mask));
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i pixels = _mm512_and_si512(_mm512_loadu_si512(row + i * 4), maskV);
+        __mmask16 hits = 0;
+        for (uint32_t c = 0; c < colorCount; ++c) hits |= _mm512_cmpeq_epi32_mask(pixels, _mm512_set1_epi32(static_cast<int>(colors[c])));
+        SetBits(bits, i, static_cast<uint64_t>(hits));
+    }
+    MatchColorsTail(row, i, count, colors, colorCount, mask, bits);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void NearColorAvx512(const uint8_t* row, uint32_t count, uint32_t color, uint32_t limit, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m512i target = _mm512_set1_epi32(static_cast<int>(color));
+    const __m512i limitV = _mm512_set1_epi32(static_cast<int>(limit));
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i pixels = _mm512_loadu_si512(row + i * 4);
+        __m512i diff = _mm512_max_epu8(_mm512_subs_epu8(pixels, target), _mm512_subs_epu8(target, pixels));
+        __m512i over = _mm512_subs_epu8(diff, limitV);
+        SetBits(bits, i, static_cast<uint64_t>(_mm512_testn_epi32_mask(over, over)));
+    }
+    NearColorTail(row, i, count, color, limit, bits);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void HashFilterAvx512(const uint8_t* row, uint32_t count, const uint32_t* filter, int filterBitsLog2, uint32_t multiplier, uint64_t* bits) {
+    ClearBits(count, bits);
+    const __m512i rgbMask = _mm512_set1_epi32(0x00FFFFFF);
+    const __m512i multiplierV = _mm512_set1_epi32(static_cast<int>(multiplier));
+    const __m512i bitMask = _mm512_set1_epi32(31);
+    const __m512i one = _mm512_set1_epi32(1);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i pixels = _mm512_and_si512(_mm512_loadu_si512(row + i * 4), rgbMask);
+        __m512i h = _mm512_srli_epi32(_mm512_mullo_epi32(pixels, multiplierV), 32 - filterBitsLog2);
+        __m512i words = _mm512_i32gather_epi32(_mm512_srli_epi32(h, 5), filter, 4);
+        __m512i shifted = _mm512_srlv_epi32(words, _mm512_and_si512(h, bitMask));
+        SetBits(bits, i, static_cast<uint64_t>(_mm512_test_epi32_mask(shifted, one)));
+    }
+    HashFilterTail(row, i, count, filter, filterBitsLog2, multiplier, bits);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void DiffPixelsAvx512(const uint8_t* row, uint32_t count, const uint8_t* other, uint64_t* bits) {
+    ClearBits(count, bits);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        SetBits(bits, i, static_cast<uint64_t>(_mm512_cmpneq_epi32_mask(_mm512_loadu_si512(row + i * 4), _mm512_loadu_si512(other + i * 4))));
+    }
+    DiffPixelsTail(row, i, count, other, bits);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline void MapPaletteAvx512(const uint8_t* row, uint32_t count, const uint32_t* keys, uint32_t keyCount, uint8_t fallback, uint8_t* out) {
+    const __m512i rgbMask = _mm512_set1_epi32(0x00FFFFFF);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i pixels = _mm512_and_si512(_mm512_loadu_si512(row + i * 4), rgbMask);
+        __m512i indices = _mm512_set1_epi32(fallback);
+        for (uint32_t k = keyCount; k-- > 0;) {
+            __mmask16 hit = _mm512_cmpeq_epi32_mask(pixels, _mm512_set1_epi32(static_cast<int>(keys[k])));
+            indices = _mm512_mask_mov_epi32(indices, hit, _mm512_set1_epi32(static_cast<int>(k)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm512_cvtepi32_epi8(indices));
+    }
+    MapPaletteTail(row, i, count, keys, keyCount, fallback, out);
+}
+
+inline Kernels Select(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512bw: return {level, MatchColorsAvx512, NearColorAvx512, HashFilterAvx512, DiffPixelsAvx512, MapPaletteAvx512, HashLanesAvx2};
+        case SimdLevel::Avx2: return {level, MatchColorsAvx2, NearColorAvx2, HashFilterAvx2, DiffPixelsAvx2, MapPaletteAvx2, HashLanesAvx2};
+        case SimdLevel::Sse42: return {level, MatchColorsSse42, NearColorSse42, HashFilterScalar, DiffPixelsSse42, MapPaletteSse42, HashLanesSse42};
+        default: return {level, MatchColorsScalar, NearColorScalar, HashFilterScalar, DiffPixelsScalar, MapPaletteScalar, HashLanesScalar};
+    }
+}
+
+} // namespace detail
+
+// The kernels for this CPU, chosen on first use.
+inline const Kernels& Active() {
+    static const Kernels kernels = detail::Select(DetectSimdLevel());
+    return kernels;
+}
+
+} // namespace pixel_kernels
+
+#endif // PIXEL_KERNELS_H
@@ -0,0 +1,104 @@
+// sequenceConfig.h - Parses findSequences-style sequence configs from JS.
+//
+// { name: { sequence, backupSequence?, direction?, offset?, tolerance? } },
+// where a sequence is an array of [r, g, b] or "any". Shared by every addon
+// that feeds sequences to a SequenceMatcher.
+
+#ifndef SEQUENCE_CONFIG_H
+#define SEQUENCE_CONFIG_H
+
+#include <napi.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sequenceMatcher.h"
+
+namespace sequence_config {
+
+struct SequenceDefinition {
+    uint32_t targetIndex = 0;  // Index into the caller's target names
+    std::vector<uint32_t> sequenceHashes;
+    bool horizontal = true;
+    int offsetX = 0, offsetY = 0;
+    bool primary = true;       // false: backupSequence
+    uint8_t tolerance = 0;     // Max per-channel difference, for both variants
+};
+
+inline bool ParseColorSequence(Napi::Env env, const Napi::Array& jsSeq, std::vector<uint32_t>& out) {
+    uint32_t len = jsSeq.Length();
+    out.clear();
+    out.reserve(len);
+    for (uint32_t i = 0; i < len; ++i) {
+        Napi::Value v = jsSeq.Get(i);
+        if (v.IsString() && v.As<Napi::String>().Utf8Value() == "any") {
+            out.push_back(sequence_matcher::SequenceMatcher::ANY_COLOR);
+            continue;
+        }
+        if (!v.IsArray()) return false;
+        Napi::Array arr = v.As<Napi::Array>();
+        if (arr.Length() != 3) return false;
+        uint32_t r = arr.Get(0u).As<Napi::Number>().Uint32Value();
+        uint32_t g = arr.Get(1u).As<Napi::Number>().Uint32Value();
+        uint32_t b = arr.Get(2u).As<Napi::Number>().Uint32Value();
+        out.push_back((r << 16) | (g << 8) | b);
+    }
+    return true;
+}
+
+// tolerance: max per-channel difference, 0 (exact) to 255.
+inline bool ParseTolerance(Napi::Env env, const Napi::Value& value, uint8_t& tolerance) {
+    if (!value.IsNumber()) return false;
+    int32_t t = value.As<Napi::Number>().Int32Value();
+    if (t < 0 || t > 255) return false;
+    tolerance = static_cast<uint8_t>(t);
+    return true;
+}
+
+// Sequences starting with "any" cannot be scanned for and are dropped; their
+// names are still listed so they report null.
+inline bool ParseTargetSequences(Napi::Env env,
+                                 const Napi::Object& jsSequences,
+                                 std::vector<SequenceDefinition>& sequences,
+                                 std::vector<std::string>& targetNames) {
+    const uint32_t ANY = sequence_matcher::SequenceMatcher::ANY_COLOR;
+    Napi::Array names = jsSequences.GetPropertyNames();
+    uint32_t n = names.Length();
+    sequences.clear();
+    sequences.reserve(n);
+    targetNames.clear();
+    targetNames.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        Napi::Value keyVal = names.Get(i);
+        if (!keyVal.IsString()) continue;
+        std::string name = keyVal.As<Napi::String>().Utf8Value();
+        Napi::Object cfg = jsSequences.Get(keyVal).As<Napi::Object>();
+        SequenceDefinition def;
+        def.targetIndex = static_cast<uint32_t>(targetNames.size());
+        targetNames.emplace_back(name);
+        def.horizontal = !(cfg.Has("direction") && cfg.Get("direction").As<Napi::String>().Utf8Value() == "vertical");
+        if (cfg.Has("offset")) {
+            Napi::Object off = cfg.Get("offset").As<Napi::Object>();
+            def.offsetX = off.Has("x") ? off.Get("x").As<Napi::Number>().Int32Value() : 0;
+            def.offsetY = off.Has("y") ? off.Get("y").As<Napi::Number>().Int32Value() : 0;
+        }
+        if (cfg.Has("tolerance") && !ParseTolerance(env, cfg.Get("tolerance"), def.tolerance)) return false;
+        if (cfg.Has("sequence")) {
+            def.primary = true;
+            if (!ParseColorSequence(env, cfg.Get("sequence").As<Napi::Array>(), def.sequenceHashes)) return false;
+            if (!def.sequenceHashes.empty() && def.sequenceHashes[0] != ANY)
+                sequences.push_back(def);
+        }
+        if (cfg.Has("backupSequence")) {
+            SequenceDefinition back = def;
+            back.primary = false;
+            if (!ParseColorSequence(env, cfg.Get("backupSequence").As<Napi::Array>(), back.sequenceHashes)) return false;
+            if (!back.sequenceHashes.empty() && back.sequenceHashes[0] != ANY)
+                sequences.push_back(std::move(back));
+        }
+    }
+    return true;
+}
+
+} // namespace sequence_config
+
+#endif // SEQUENCE_CONFIG_H
@@ -0,0 +1,193 @@
+// sequenceMatcher.h - All tasks' sequences compiled into one first-colour table.
+//
+// A row is scanned once, whatever the number of sequences: pixels are hashed
+// into a 64K-bit prefilter (one gather per vector), and only pixels that pass
+// are looked up in an open-addressing table keyed by 24-bit colour. Each key
+// maps to the contiguous run of sequences starting with that colour, with
+// direction/variant already resolved, so verification does no string work.
+//
+// Sequences with a tolerance match any colour within it on every channel, so
+// their first colour cannot be hashed: each distinct (colour, tolerance) is
+// tested against the row with saturating byte differences instead. Both scans
+// are pixelKernels.h kernels, so they run at the CPU's widest vector width.
+
+#ifndef SEQUENCE_MATCHER_H
+#define SEQUENCE_MATCHER_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "pixelKernels.h"
+
+namespace sequence_matcher {
+
+struct CompiledSequence {
+    uint32_t task;          // Index into the call's task list
+    uint32_t slot;          // Result slot (task's result base + target index)
+    bool horizontal;
+    bool primary;           // false: backupSequence
+    int offsetX, offsetY;
+    uint32_t colorsBegin;   // Colours after the first one, in SequenceMatcher::Colors()
+    uint32_t length;        // Including the first colour
+    uint8_t tolerance;      // Max per-channel difference; 0 is exact
+};
+
+// Whether two 24-bit colours differ by at most `tolerance` on every channel.
+inline bool ColorWithin(uint32_t a, uint32_t b, uint8_t tolerance) {
+    for (int shift = 0; shift < 24; shift += 8) {
+        int d = static_cast<int>((a >> shift) & 0xFF) - static_cast<int>((b >> shift) & 0xFF);
+        if (d > tolerance || -d > tolerance) return false;
+    }
+    return true;
+}
+
+class SequenceMatcher {
+public:
+    static constexpr uint32_t EMPTY_KEY = 0xFFFFFFFF;  // Colours are 24-bit
+    static constexpr uint32_t ANY_COLOR = 0xFFFFFFFF;  // Sequence wildcard ("any")
+    static constexpr int FILTER_BITS_LOG2 = 16;
+    static constexpr uint32_t HASH_MULTIPLIER = 0x9E3779B1u;
+    static constexpr uint32_t SCAN_BLOCK = 256;  // Pixels per kernel call
+
+    // colors[0] is the first colour (never ANY); the rest may contain ANY.
+    void Add(CompiledSequence seq, const std::vector<uint32_t>& colors) {
+        seq.colorsBegin = static_cast<uint32_t>(restColors.size());
+        seq.length = static_cast<uint32_t>(colors.size());
+        restColors.insert(restColors.end(), colors.begin() + 1, colors.end());
+        (seq.tolerance ? pendingNear : pending).push_back({colors[0], seq});
+    }
+
+    void Build() {
+        std::stable_sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) { return a.color < b.color; });
+        sequences.clear(); sequences.reserve(pending.size());
+        size_t unique = 0;
+        for (size_t i = 0; i < pending.size(); ++i) if (i == 0 || pending[i].color != pending[i - 1].color) ++unique;
+        tableBits = 4;
+        while ((1u << tableBits) < unique * 2) ++tableBits;
+        keys.assign(1u << tableBits, EMPTY_KEY);
+        ranges.assign(1u << tableBits, {0, 0});
+        filter.assign((1u << FILTER_BITS_LOG2) / 32, 0);
+        uint32_t current = 0;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            uint32_t color = pending[i].color;
+            if (i == 0 || color != pending[i - 1].color) {
+                uint32_t h = FilterIndex(color);
+                filter[h >> 5] |= 1u << (h & 31);
+                uint32_t mask = (1u << tableBits) - 1, index = TableIndex(color);
+                while (keys[index] != EMPTY_KEY) index = (index + 1) & mask;
+                keys[index] = color;
+                ranges[index] = {static_cast<uint32_t>(sequences.size()), 0};
+                current = index;
+            }
+            sequences.push_back(pending[i].seq);
+            ranges[current].second++;
+        }
+        exactCount = static_cast<uint32_t>(sequences.size());
+        pending.clear(); pending.shrink_to_fit();
+
+        // Tolerant sequences follow, grouped by (colour, tolerance).
+        std::stable_sort(pendingNear.begin(), pendingNear.end(), [](const Pending& a, const Pending& b) {
+            return a.color != b.color ? a.color < b.color : a.seq.tolerance < b.seq.tolerance;
+        });
+        nearKeys.clear();
+        for (size_t i = 0; i < pendingNear.size(); ++i) {
+            const Pending& p = pendingNear[i];
+            if (i == 0 || p.color != pendingNear[i - 1].color || p.seq.tolerance != pendingNear[i - 1].seq.tolerance) {
+                // Alpha is ignored: its byte of the limit lets any difference through.
+                nearKeys.push_back({p.color, 0xFF000000u | (0x010101u * p.seq.tolerance), static_cast<uint32_t>(sequences.size()), 0});
+            }
+            sequences.push_back(p.seq);
+            nearKeys.back().count++;
+        }
+        pendingNear.clear(); pendingNear.shrink_to_fit();
+    }
+
+    bool Empty() const { return sequences.empty(); }
+    const uint32_t* Colors(const CompiledSequence& seq) const { return restColors.data() + seq.colorsBegin; }
+
+    // Whether the rest of seq matches from pixel (x, y), whose first colour
+    // ScanRow already matched. The sequence must fit in the frame.
+    bool Matches(const uint8_t* bgra, uint32_t width, uint32_t height, uint32_t stride,
+                 const CompiledSequence& seq, uint32_t x, uint32_t y) const {
+        const uint32_t* colors = Colors(seq);
+        // Offset of the j-th pixel is base + j * step.
+        size_t base = (static_cast<size_t>(y) * stride) + (static_cast<size_t>(x) * 4);
+        size_t step;
+        if (seq.horizontal) {
+            if (x + seq.length > width) return false;
+            step = 4;
+        } else {
+            if (y + seq.length > height) return false;
+            step = stride;
+        }
+        for (uint32_t j = 1; j < seq.length; ++j) {
+            uint32_t expectedColor = colors[j - 1];
+            if (expectedColor == ANY_COLOR) continue;
+            const uint8_t* pixel = bgra + base + j * step;
+            uint32_t actualColor = (static_cast<uint32_t>(pixel[2]) << 16) | (static_cast<uint32_t>(pixel[1]) << 8) | pixel[0];
+            if (actualColor != expectedColor && (!seq.tolerance || !ColorWithin(actualColor, expectedColor, seq.tolerance))) return false;
+        }
+        return true;
+    }
+
+    // Calls onCandidate(seq, x) for every sequence whose first colour matches
+    // pixel x of the BGRA row, x in [x0, x1). Alpha is ignored.
+    template <typename F>
+    void ScanRow(const uint8_t* row, uint32_t x0, uint32_t x1, F&& onCandidate) const {
+        const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+        uint64_t bits[SCAN_BLOCK / 64];
+        for (uint32_t bx = x0; bx < x1; bx += SCAN_BLOCK) {
+            const uint32_t n = std::min(SCAN_BLOCK, x1 - bx);
+            const uint8_t* block = row + static_cast<size_t>(bx) * 4;
+            if (exactCount) {
+                kernels.hashFilter(block, n, filter.data(), FILTER_BITS_LOG2, HASH_MULTIPLIER, bits);
+                pixel_kernels::ForEachBit(bits, n, [&](uint32_t i) { VisitPixel(row, bx + i, onCandidate); });
+            }
+            for (const NearKey& key : nearKeys) {
+                kernels.nearColor(block, n, key.color, key.limit, bits);
+                pixel_kernels::ForEachBit(bits, n, [&](uint32_t i) {
+                    for (uint32_t s = key.first; s < key.first + key.count; ++s) onCandidate(sequences[s], bx + i);
+                });
+            }
+        }
+    }
+
+private:
+    struct Pending { uint32_t color; CompiledSequence seq; };
+    struct NearKey { uint32_t color, limit; uint32_t first, count; };
+
+    static uint32_t PixelColor(const uint8_t* row, uint32_t x) {
+        uint32_t bgra;
+        memcpy(&bgra, row + x * 4, 4);
+        return bgra & 0x00FFFFFF;
+    }
+    static uint32_t FilterIndex(uint32_t color) { return (color * HASH_MULTIPLIER) >> (32 - FILTER_BITS_LOG2); }
+    uint32_t TableIndex(uint32_t color) const { return (color * HASH_MULTIPLIER) >> (32 - tableBits); }
+
+    template <typename F>
+    void VisitPixel(const uint8_t* row, uint32_t x, F& onCandidate) const {
+        uint32_t color = PixelColor(row, x);
+        uint32_t mask = (1u << tableBits) - 1, index = TableIndex(color);
+        for (; keys[index] != EMPTY_KEY; index = (index + 1) & mask) {
+            if (keys[index] != color) continue;
+            const auto& range = ranges[index];
+            for (uint32_t i = range.first; i < range.first + range.second; ++i) onCandidate(sequences[i], x);
+            return;
+        }
+    }
+
+    std::vector<Pending> pending, pendingNear;
+    std::vector<NearKey> nearKeys;
+    uint32_t exactCount = 0;  // sequences[0, exactCount) are in the hash table
+    std::vector<CompiledSequence> sequences;
+    std::vector<uint32_t> restColors;
+    std::vector<uint32_t> keys;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;  // (first sequence, count) per key
+    std::vector<uint32_t> filter;
+    int tableBits = 4;
+};
+
+} // namespace sequence_matcher
+
+#endif // SEQUENCE_MATCHER_H
@@ -0,0 +1,119 @@
+// targetScan.h - Target mark detection shared by findTarget and frameAnalyzer.
+//
+// The targeted creature is framed by a red border. Callers collect the
+// border-coloured pixels of a search area (matchColors with TARGET_COLORS);
+// InferTargetRect groups them into 8-connected clusters, drops the small ones
+// (stray red pixels) and returns the creature rect inside the rest, so a
+// partially obstructed border still yields a target.
+
+#ifndef TARGET_SCAN_H
+#define TARGET_SCAN_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+namespace target_scan {
+
+// Target border colors:
+// Only detect when creature is actually TARGETED (not just hovered)
+const uint32_t TARGET_COLOR_1 = 0xFF0000;  // [255, 0, 0] - targeted
+const uint32_t TARGET_COLOR_2 = 0xFF8080;  // [255, 128, 128] - targeted + hovered
+// Note: We do NOT check for white [255, 255, 255] because that's hover-only, not targeted
+const uint32_t TARGET_COLORS[] = {TARGET_COLOR_1, TARGET_COLOR_2};
+// Minimum number of pixels a cluster must have to be considered part of the border
+const size_t MIN_CLUSTER_SIZE = 10;
+
+struct Point {
+    uint32_t x, y;
+};
+
+struct TargetRect {
+    uint32_t x, y, width, height;
+};
+
+// Inline helper: check if pixel matches any target color
+inline bool isTargetColor(uint32_t color) {
+    return color == TARGET_COLOR_1 || color == TARGET_COLOR_2;
+}
+
+// Clusters are grown only inside the search area. Returns false when no
+// cluster reaches MIN_CLUSTER_SIZE.
+inline bool InferTargetRect(const std::vector<Point>& candidatePoints,
+                            const uint8_t* bgraData, uint32_t width, uint32_t height, uint32_t stride,
+                            uint32_t searchX, uint32_t searchY, uint32_t searchW, uint32_t searchH,
+                            TargetRect& out) {
+    std::vector<std::vector<Point>> clusters;
+    std::vector<bool> visited(width * height, false);
+
+    for (const auto& start_point : candidatePoints) {
+        uint32_t start_idx = start_point.y * width + start_point.x;
+        if (visited[start_idx]) continue;
+
+        std::vector<Point> current_cluster;
+        std::queue<Point> q;
+
+        q.push(start_point);
+        visited[start_idx] = true;
+
+        while (!q.empty()) {
+            Point p = q.front();
+            q.pop();
+            current_cluster.push_back(p);
+
+            // Check 8 neighbors (Moore neighborhood)
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if (dx == 0 && dy == 0) continue;
+                    uint32_t nx = p.x + dx;
+                    uint32_t ny = p.y + dy;
+
+                    if (nx >= searchX && nx < searchX + searchW && ny >= searchY && ny < searchY + searchH) {
+                        uint32_t neighbor_idx = ny * width + nx;
+                        if (!visited[neighbor_idx]) {
+                           const uint8_t* np = bgraData + ny * stride + nx * 4;
+                           uint32_t neighborColor = (static_cast<uint32_t>(np[2]) << 16) | (static_cast<uint32_t>(np[1]) << 8) | np[0];
+                           if (isTargetColor(neighborColor)) {
+                               visited[neighbor_idx] = true;
+                               q.push({nx, ny});
+                           }
+                        }
+                    }
+                }
+            }
+        }
+        if (current_cluster.size() >= MIN_CLUSTER_SIZE) {
+            clusters.push_back(current_cluster);
+        }
+    }
+
+    if (clusters.empty()) {
+        return false;
+    }
+
+    // === Combine all valid clusters into a single bounding box ===
+    uint32_t minX = width, minY = height, maxX = 0, maxY = 0;
+
+    for (const auto& cluster : clusters) {
+        for (const auto& p : cluster) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+    }
+
+    // Add the 3px border thickness to the max coordinates to get the full creature rect
+    // The border is outside the creature, so the creature rect is inside minX+3, minY+3
+    out.x = minX + 3;
+    out.y = minY + 3;
+    out.width = (maxX - 3) - out.x + 1;
+    out.height = (maxY - 3) - out.y + 1;
+    return true;
+}
+
+} // namespace target_scan
+
+#endif // TARGET_SCAN_H
@@ -0,0 +1,175 @@
+// healthBarScanTest.cc - Checks the health bar scanner and tracker in healthBarScan.h.
+//
+// Build and run (no Node needed):
+//   g++ -std=c++17 -O2 -I.. healthBarScanTest.cc -o healthBarScanTest && ./healthBarScanTest
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "healthBarScan.h"
+
+using namespace health_bars;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+struct Image {
+    uint32_t width, height;
+    std::vector<uint32_t> pixels;  // BGRA, alpha 0xFF
+    const uint8_t* Data() const { return reinterpret_cast<const uint8_t*>(pixels.data()); }
+};
+
+static void DrawBar(Image& image, uint32_t left, uint32_t top, uint32_t fill, uint32_t filledColumns = BAR_INNER_WIDTH) {
+    for (uint32_t dy = 0; dy < BAR_HEIGHT; ++dy) {
+        for (uint32_t dx = 0; dx < BAR_WIDTH; ++dx) {
+            bool border = dy == 0 || dy == BAR_HEIGHT - 1 || dx == 0 || dx == BAR_WIDTH - 1;
+            uint32_t c = border || dx > filledColumns ? 0 : fill;
+            image.pixels[(top + dy) * image.width + left + dx] = c | 0xFF000000;
+        }
+    }
+}
+
+// Bars starting in `starts`, as the standalone scanners walk them.
+static void Scan(const Image& image, const Rect& starts, std::vector<FoundHealthBar>& out) {
+    BarScanner scanner(starts.x, starts.width + BAR_WIDTH);
+    uint32_t y1 = std::min(starts.y + starts.height, image.height - (BAR_HEIGHT - 1));
+    for (uint32_t r = starts.y; r < y1 + BAR_HEIGHT - 1; ++r) {
+        scanner.AddRow(image.Data(), image.width * 4, r);
+        if (r >= starts.y + BAR_HEIGHT - 1) scanner.FindBars(image.Data(), image.width * 4, r - (BAR_HEIGHT - 1), out);
+    }
+}
+
+static std::vector<FoundHealthBar> FullScan(const Image& image, const Rect& area) {
+    std::vector<FoundHealthBar> found;
+    Scan(image, {area.x, area.y, area.width - BAR_WIDTH, area.height}, found);
+    return ClusterBars(found);
+}
+
+static std::vector<std::tuple<int, int, int, int>> Key(const std::vector<FoundHealthBar>& bars) {
+    std::vector<std::tuple<int, int, int, int>> key;
+    for (const FoundHealthBar& b : bars) key.emplace_back(b.x, b.y, b.healthClass, b.hpPercent);
+    std::sort(key.begin(), key.end());
+    return key;
+}
+
+static void TestScan() {
+    printf("scan\n");
+    Image image{200, 40, std::vector<uint32_t>(200 * 40, 0xFF123456)};
+    DrawBar(image, 10, 5, 0x00C000);
+    DrawBar(image, 100, 20, 0xC00000, 14);
+    std::vector<FoundHealthBar> bars = FullScan(image, {0, 0, 200, 40});
+    std::sort(bars.begin(), bars.end(), [](const FoundHealthBar& a, const FoundHealthBar& b) { return a.x < b.x; });
+    CHECK(bars.size() == 2);
+    if (bars.size() != 2) return;
+    CHECK(bars[0].x == 25 && bars[0].y == 7);
+    CHECK(bars[0].healthClass == HEALTH_FULL && bars[0].hpPercent == 100);
+    CHECK(bars[1].x == 115 && bars[1].y == 22);
+    CHECK(bars[1].healthClass == HEALTH_LOW && bars[1].hpPercent == 48);
+}
+
+// Bars wander a few pixels per frame. Scanning only DirtyStarts of the
+// changed tiles and reusing CleanBars must give what a full scan gives, and
+// every bar must keep its id.
+static void TestTracker() {
+    printf("tracker\n");
+    std::mt19937 rng(7);
+    const uint32_t W = 400, H = 300, TILE = 16;
+    const uint32_t colors[] = {0x00C000, 0xC00000, 0x60C060, 0xC0C0C0, 0};
+    int mismatches = 0, idChanges = 0, incremental = 0;
+    for (int run = 0; run < 20; ++run) {
+        Image background{W, H, std::vector<uint32_t>(W * H)};
+        for (uint32_t& p : background.pixels) p = (rng() & 0xFFFFFF) | 0xFF000000;
+        struct Bar { int x, y; uint32_t color; uint32_t id; };
+        std::vector<Bar> bars;
+        for (int i = 0; i < 6; ++i) bars.push_back({(i % 3) * 120 + 10, (i / 3) * 130 + 20, colors[rng() % 5], 0});
+        const Rect area{5, 5, W - 10, H - 10};
+        BarTracker tracker;
+        Image previous;
+        for (int frame = 0; frame < 20; ++frame) {
+            Image image = background;
+            for (Bar& b : bars) {
+                if (frame > 0 && rng() % 3 == 0) {
+                    b.x = std::clamp(b.x + static_cast<int>(rng() % 9) - 4, 6, static_cast<int>(W) - 45);
+                    b.y = std::clamp(b.y + static_cast<int>(rng() % 9) - 4, 6, static_cast<int>(H) - 12);
+                }
+                DrawBar(image, b.x, b.y, b.color);
+            }
+            std::vector<FoundHealthBar> found;
+            if (frame > 0 && tracker.HasHistory(W, H, area)) {
+                std::vector<Rect> dirty;
+                for (uint32_t ty = 0; ty < H; ty += TILE) {
+                    for (uint32_t tx = 0; tx < W; tx += TILE) {
+                        bool changed = false;
+                        for (uint32_t y = ty; y < std::min(H, ty + TILE) && !changed; ++y)
+                            for (uint32_t x = tx; x < std::min(W, tx + TILE) && !changed; ++x)
+                                changed = image.pixels[y * W + x] != previous.pixels[y * W + x];
+                        if (changed) dirty.push_back({tx, ty, std::min(TILE, W - tx), std::min(TILE, H - ty)});
+                    }
+                }
+                found = tracker.CleanBars(dirty);
+                std::vector<FoundHealthBar> rescanned;
+                Rect starts;
+                for (const Rect& d : dirty) {
+                    if (DirtyStarts(d, area, starts)) Scan(image, starts, rescanned);
+                }
+                std::vector<FoundHealthBar> merged = ClusterBars(rescanned);
+                found.insert(found.end(), merged.begin(), merged.end());
+                ++incremental;
+            } else {
+                found = FullScan(image, area);
+            }
+            tracker.Update(found, W, H, area);
+            if (Key(found) != Key(FullScan(image, area))) ++mismatches;
+            for (Bar& b : bars) {
+                for (const FoundHealthBar& f : found) {
+                    if (f.x != b.x + 15 || f.y != b.y + 2) continue;
+                    if (b.id && b.id != f.id) ++idChanges;
+                    b.id = f.id;
+                }
+            }
+            previous = image;
+        }
+    }
+    printf("  incremental frames %d\n", incremental);
+    CHECK(incremental > 0);
+    CHECK(mismatches == 0);
+    CHECK(idChanges == 0);
+
+    // ForgetHistory keeps ids but forces the next frame to a full scan.
+    BarTracker tracker;
+    std::vector<FoundHealthBar> first = {{50, 50, HEALTH_FULL, 100}};
+    tracker.Update(first, 100, 100, {0, 0, 100, 100});
+    CHECK(tracker.HasHistory(100, 100, {0, 0, 100, 100}));
+    CHECK(!tracker.HasHistory(100, 100, {0, 0, 90, 100}));
+    tracker.ForgetHistory();
+    CHECK(!tracker.HasHistory(100, 100, {0, 0, 100, 100}));
+    std::vector<FoundHealthBar> second = {{53, 49, HEALTH_FULL, 100}};
+    tracker.Update(second, 100, 100, {0, 0, 100, 100});
+    CHECK(second[0].id == first[0].id);
+}
+
+static void TestRecords() {
+    printf("records\n");
+    std::vector<FoundHealthBar> bars = {{10, 20, HEALTH_LOW, 48, 7}, {-3, 5, HEALTH_OBSTRUCTED, 0, 0}};
+    std::vector<int32_t> out(RECORD_FIELDS * 2, -1);
+    WriteRecords(bars, out.data(), 2);
+    CHECK((out == std::vector<int32_t>{10, 20, 48, HEALTH_LOW, 7, -3, 5, 0, HEALTH_OBSTRUCTED, 0}));
+    // Only as many records as fit are written.
+    std::vector<int32_t> small(RECORD_FIELDS + 1, -1);
+    WriteRecords(bars, small.data(), 1);
+    CHECK(small[0] == 10 && small[RECORD_FIELDS - 1] == 7 && small[RECORD_FIELDS] == -1);
+}
+
+int main() {
+    TestScan();
+    TestTracker();
+    TestRecords();
+    printf(failures ? "FAILED (%d)\n" : "OK\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+// pixelKernelsTest.cc - Checks every SIMD level in pixelKernels.h against the
+// scalar kernels. Levels the CPU lacks are skipped.
+//
+// Build and run (no Node needed):
+//   g++ -std=c++17 -O2 -I.. pixelKernelsTest.cc -o pixelKernelsTest && ./pixelKernelsTest
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "pixelKernels.h"
+
+using namespace pixel_kernels;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+// Widths around every vector step, so each tail length is covered.
+static const uint32_t COUNTS[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 127, 130, 1000};
+
+static std::mt19937 rng(11);
+
+// Random pixels drawn mostly from a small set, so matches and equal runs occur.
+static std::vector<uint32_t> MakeRow(uint32_t count, const std::vector<uint32_t>& common) {
+    std::vector<uint32_t> row(count);
+    for (auto& p : row) p = rng() % 3 ? common[rng() % common.size()] | (rng() % 2 ? 0xFF000000 : 0) : rng();
+    return row;
+}
+
+static const uint8_t* Bytes(const std::vector<uint32_t>& row) { return reinterpret_cast<const uint8_t*>(row.data()); }
+
+static std::vector<uint64_t> Bits(uint32_t count) { return std::vector<uint64_t>((count + 63) / 64 + 1, ~0ull); }
+
+static void TestLevel(const Kernels& scalar, const Kernels& k) {
+    printf("%s\n", SimdLevelName(k.level));
+    std::vector<uint32_t> common = {0x123456, 0x00FF00, 0xABCDEF, 0x000000, 0xFFFFFF, 0x808080};
+    std::vector<uint32_t> filter(1 << 7);
+    for (auto& w : filter) w = rng();
+    for (uint32_t count : COUNTS) {
+        for (int round = 0; round < 20; ++round) {
+            std::vector<uint32_t> row = MakeRow(count, common), other = row;
+            for (auto& p : other) if (rng() % 4 == 0) p ^= 1u << (rng() % 32);
+            uint32_t words = (count + 63) / 64;
+
+            std::vector<uint64_t> a = Bits(count), b = Bits(count);
+            scalar.matchColors(Bytes(row), count, common.data(), 4, 0x00FFFFFF, a.data());
+            k.matchColors(Bytes(row), count, common.data(), 4, 0x00FFFFFF, b.data());
+            CHECK(a == b);
+
+            a = Bits(count), b = Bits(count);
+            scalar.nearColor(Bytes(row), count, 0x00808080, 0xFF202020, a.data());
+            k.nearColor(Bytes(row), count, 0x00808080, 0xFF202020, b.data());
+            CHECK(a == b);
+
+            a = Bits(count), b = Bits(count);
+            scalar.hashFilter(Bytes(row), count, filter.data(), 12, 0x9E3779B1u, a.data());
+            k.hashFilter(Bytes(row), count, filter.data(), 12, 0x9E3779B1u, b.data());
+            CHECK(a == b);
+
+            a = Bits(count), b = Bits(count);
+            scalar.diffPixels(Bytes(row), count, Bytes(other), a.data());
+            k.diffPixels(Bytes(row), count, Bytes(other), b.data());
+            CHECK(a == b);
+            // Words past the row are left alone.
+            CHECK(b[words] == ~0ull);
+
+            // Repeated keys: the first one wins at every level.
+            std::vector<uint32_t> keys = {0xABCDEF, 0x00FF00, 0x123456, 0x00FF00, 0xFFFFFF};
+            std::vector<uint8_t> pa(count + 1, 0xEE), pb(count + 1, 0xEE);
+            scalar.mapPalette(Bytes(row), count, keys.data(), static_cast<uint32_t>(keys.size()), 0xFF, pa.data());
+            k.mapPalette(Bytes(row), count, keys.data(), static_cast<uint32_t>(keys.size()), 0xFF, pb.data());
+            CHECK(pa == pb);
+            CHECK(pb[count] == 0xEE);
+
+            uint32_t la[8], lb[8];
+            const uint8_t* previous = round % 3 == 0 ? nullptr : round % 3 == 1 ? Bytes(row) : Bytes(other);
+            bool ca = scalar.hashLanes(Bytes(row), count, previous, 0x01000193u, la);
+            bool cb = k.hashLanes(Bytes(row), count, previous, 0x01000193u, lb);
+            CHECK(ca == cb);
+            CHECK(std::equal(la, la + 8, lb));
+        }
+    }
+}
+
+static void TestScalar() {
+    printf("scalar\n");
+    const Kernels scalar = detail::Select(SimdLevel::Scalar);
+    std::vector<uint32_t> row = {0xFF123456, 0x00ABCDEF, 0xFF000000, 0xFF123456};
+    std::vector<uint32_t> keys = {0x123456, 0xABCDEF, 0x123456};
+    uint8_t out[4];
+    scalar.mapPalette(Bytes(row), 4, keys.data(), 3, 9, out);
+    CHECK(out[0] == 0 && out[1] == 1 && out[2] == 9 && out[3] == 0);
+
+    std::vector<uint32_t> other = row;
+    other[2] = 0xFF000001;
+    uint64_t bits = ~0ull;
+    scalar.diffPixels(Bytes(row), 4, Bytes(other), &bits);
+    CHECK(bits == 4);
+
+    uint32_t lanes[8];
+    CHECK(!scalar.hashLanes(Bytes(row), 4, nullptr, 3, lanes));
+    CHECK(lanes[0] == 0xFF123456u * 3 && lanes[3] == 0xFF123456u * 3 && lanes[4] == 0);
+    CHECK(!scalar.hashLanes(Bytes(row), 4, Bytes(row), 3, lanes));
+    CHECK(scalar.hashLanes(Bytes(row), 4, Bytes(other), 3, lanes));
+}
+
+int main() {
+    TestScalar();
+    const Kernels scalar = detail::Select(SimdLevel::Scalar);
+    SimdLevel best = DetectSimdLevel();
+    for (int l = static_cast<int>(SimdLevel::Sse42); l <= static_cast<int>(best); ++l) {
+        TestLevel(scalar, detail::Select(static_cast<SimdLevel>(l)));
+    }
+    printf(failures ? "FAILED (%d)\n" : "OK\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+// threadPool.h - Persistent work-stealing pool shared by the vision modules.
+//
+// One pool per addon per process, created on first use: one worker per core,
+// started once and then parked on a condition variable between jobs. Workers
+// are not pinned: every addon has its own pool, and pinned pools would stack
+// worker i of each addon on the same core while the scheduler balances
+// unpinned ones.
+// Every JS worker thread calling into the addon submits to the same pool, so
+// concurrent detector calls share the cores instead of each spawning
+// hardware_concurrency() fresh threads.
+//
+// ParallelFor splits a range into chunks dealt round-robin onto per-worker
+// deques. Workers drain their own deque from the front and steal from the back
+// of the others'; the calling thread helps until its job is finished, so a call
+// never waits on a busy pool and nested calls cannot deadlock.
+
+#ifndef VISION_THREAD_POOL_H
+#define VISION_THREAD_POOL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vision_pool {
+
+class ThreadPool {
+public:
+    // Chunk callback: fn(begin, end, slot). slot is in [0, Slots()) and unique
+    // among the chunks of one job running at the same time, so it can index
+    // per-thread scratch (results, TLS-like buffers) without locking.
+    using ChunkFn = std::function<void(uint32_t, uint32_t, unsigned)>;
+
+    static ThreadPool& Instance() {
+        // Never destroyed: joining at exit would race the addon being unloaded.
+        static ThreadPool* pool = new ThreadPool();
+        return *pool;
+    }
+
+    unsigned Slots() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Runs fn over [begin, end) in chunks of about `grain` items (never less
+    // than grain / 2 unless the whole range is smaller) and returns when all
+    // of them are done.
+    void ParallelFor(uint32_t begin, uint32_t end, uint32_t grain, const ChunkFn& fn) {
+        if (end <= begin) return;
+        uint32_t count = end - begin;
+        grain = std::max(grain, 1u);
+        uint32_t chunks = (count + grain - 1) / grain;
+        if (chunks <= 1 || workers.empty()) { fn(begin, end, CallerSlot()); return; }
+
+        Job job;
+        job.fn = &fn;
+        job.remaining.store(chunks, std::memory_order_relaxed);
+        unsigned first = next_queue.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < chunks; ++i) {
+            uint32_t b = begin + static_cast<uint32_t>(static_cast<uint64_t>(count) * i / chunks);
+            uint32_t e = begin + static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / chunks);
+            WorkerQueue& queue = *queues[(first + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({&job, b, e});
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            pending.fetch_add(chunks, std::memory_order_release);
+        }
+        sleep_cv.notify_all();
+
+        // Help with this job's chunks, then wait for the ones still running.
+        Task task;
+        while (job.remaining.load(std::memory_order_acquire) > 0 && StealFor(&job, task)) Run(task, CallerSlot());
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done_cv.wait(lock, [&job] { return job.remaining.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    struct Job {
+        const ChunkFn* fn = nullptr;
+        std::atomic<uint32_t> remaining{0};
+        std::mutex mutex; std::condition_variable done_cv;
+    };
+    struct Task { Job* job; uint32_t begin, end; };
+    struct WorkerQueue { std::mutex mutex; std::deque<Task> tasks; };
+
+    ThreadPool() {
+        unsigned cores = std::thread::hardware_concurrency();
+        if (cores == 0) cores = 4;
+        // The calling thread is the last participant; leave it a core.
+        unsigned count = cores > 1 ? cores - 1 : 0;
+        for (unsigned i = 0; i < std::max(count, 1u); ++i) queues.emplace_back(new WorkerQueue());
+        for (unsigned i = 0; i < count; ++i) workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+
+    // Callers (JS or libuv threads) all share the last slot; see CallerSlot.
+    unsigned CallerSlot() const { return static_cast<unsigned>(workers.size()); }
+
+    static void Run(const Task& task, unsigned slot) {
+        (*task.job->fn)(task.begin, task.end, slot);
+        // Under the job's mutex: the job lives on the caller's stack and may be
+        // gone as soon as its waiter sees remaining == 0.
+        std::lock_guard<std::mutex> lock(task.job->mutex);
+        if (task.job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) task.job->done_cv.notify_all();
+    }
+
+    bool PopFront(WorkerQueue& queue, Task& task) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        task = queue.tasks.front(); queue.tasks.pop_front();
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    // Takes a task from the back of any queue; with job set, only that job's.
+    bool StealFor(Job* job, Task& task) {
+        for (auto& queue_ptr : queues) {
+            WorkerQueue& queue = *queue_ptr;
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it) {
+                if (job && it->job != job) continue;
+                task = *it; queue.tasks.erase(std::next(it).base());
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(unsigned index) {
+        Task task;
+        for (;;) {
+            if (PopFront(*queues[index], task) || StealFor(nullptr, task)) { Run(task, index); continue; }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_cv.wait(lock, [this] { return pending.load(std::memory_order_acquire) > 0; });
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<unsigned> next_queue{0};
+    std::atomic<int64_t> pending{0};  // Queued, not yet taken
+    std::mutex sleep_mutex; std::condition_variable sleep_cv;
+};
+
+} // namespace vision_pool
+
+#endif // VISION_THREAD_POOL_H
@@ -1,311 +1,246 @@
 // findHealthBars.cc – EXTREME PERFORMANCE EDITION (FULL BORDER VALIDATION + NEW COLOR)
 #include <napi.h>
 #include <vector>
-#include <thread>
 #include <cstdint>
 #include <algorithm>
 #include <cmath>
-#include <immintrin.h>
 #include <array>
-#include <mutex>
-
-inline bool IsKnownBarColor(uint32_t c) {
-    switch(c) {
-        case 0:          // 0x00000000 (Black - for empty bars)
-        case 49152:      // 0x0000C000
-        case 12582912:   // 0x00C00000
-        case 6340704:    // 0x0060C060
-        case 12632064:   // 0x00C0C000
-        case 12595248:   // 0x00C03030
-        case 6291456:    // 0x00600000
-        // --- NEW COLOR ADDED ---
-        case 12632256:   // 0x00C0C0C0 (Gray [192, 192, 192])
-            return true;
-        default:
-            return false;
-    }
-}
+#include "healthBarScan.h"
+#include "threadPool.h"
+
+using health_bars::FoundHealthBar;
+
+using health_bars::RECORD_FIELDS;
 
-struct FoundHealthBar {
-    int x, y;
-    std::string healthTag;
+// { output: 'records' } returns an Int32Array of RECORD_FIELDS-int records
+// (x, y, hpPercent, healthClass, id) instead of one object per bar.
+// healthClass is a health_bars::HealthClass (0 Full .. 5 Obstructed); id is 0
+// from findHealthBars. { output: someInt32Array } writes the records into
+// that array instead, as many as fit, and returns the number of bars found;
+// a count above length / RECORD_FIELDS means the array was too small.
+
+struct OutputOptions {
+    bool records = false;
+    bool into = false;   // Records go into the caller's Int32Array
 };
 
 struct WorkerData {
     const uint8_t* bgraData;
     uint32_t width, height, stride;
     uint32_t searchX, searchY, searchW, searchH;
-    std::vector<FoundHealthBar>* globalResults;
-    std::mutex* resultsMutex;
 };
 
-inline bool IsBlack(const uint8_t* p) {
-    return p[0] == 0 && p[1] == 0 && p[2] == 0;
-}
+// Bars starting on rows [searchY, searchY + searchH); a bar reads the three
+// rows below its top. Each row's black pixels are matched once.
+void HealthBarWorker(const WorkerData& data, std::vector<FoundHealthBar>& out) {
+    health_bars::BarScanner scanner(data.searchX, data.searchW);
 
-inline bool ValidateRightBorder(const WorkerData& data, uint32_t x, uint32_t y) {
-    const uint32_t right_x = x + 30;
-    if (right_x >= data.width) return false;
+    uint32_t startY = data.searchY;
+    uint32_t endY = data.searchY + data.searchH;
 
-    const uint8_t* p0 = data.bgraData + (y * data.stride) + (right_x * 4);
-    const uint8_t* p1 = data.bgraData + ((y + 1) * data.stride) + (right_x * 4);
-    const uint8_t* p2 = data.bgraData + ((y + 2) * data.stride) + (right_x * 4);
-    const uint8_t* p3 = data.bgraData + ((y + 3) * data.stride) + (right_x * 4);
+    for (uint32_t y = startY; y < endY; ++y) {
+        // Check if we have enough rows remaining for a 4-pixel-tall health bar
+        // Need y, y+1, y+2, y+3 all to be valid
+        if (y + 3 >= data.height) break;
+
+        for (uint32_t r = (y == startY ? y : y + 3); r <= y + 3; ++r) {
+            scanner.AddRow(data.bgraData, data.stride, r);
+        }
+        scanner.FindBars(data.bgraData, data.stride, y, out);
+    }
+}
 
-    return IsBlack(p0) && IsBlack(p1) && IsBlack(p2) && IsBlack(p3);
+// Scans bars starting in columns [x, x + w - BAR_WIDTH) and rows [y, y + h)
+// on the shared pool and appends them, unclustered, to results.
+void ScanBars(const uint8_t* bgraData, uint32_t width, uint32_t height,
+              uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+              std::vector<FoundHealthBar>& results) {
+    vision_pool::ThreadPool& pool = vision_pool::ThreadPool::Instance();
+    // One buffer per pool slot; chunks running at the same time never share a
+    // slot, so nothing is locked.
+    std::vector<std::vector<FoundHealthBar>> slotResults(pool.Slots());
+
+    // Chunks of 8 rows are never split below 4, the height of a bar. Idle
+    // threads steal chunks, so a row band dense with bars does not hold up
+    // the rest.
+    pool.ParallelFor(y, y + h, 8, [&](uint32_t startRow, uint32_t endRow, unsigned slot) {
+        HealthBarWorker(WorkerData{
+            bgraData, width, height, width * 4,
+            x, startRow, w, endRow - startRow
+        }, slotResults[slot]);
+    });
+
+    for (const auto& found : slotResults) results.insert(results.end(), found.begin(), found.end());
 }
 
-// Helper for horizontal border validation to avoid code duplication
-inline bool ValidateHorizontalBorder(const uint8_t* p) {
-    const __m256i zero = _mm256_setzero_si256();
-    const __m256i bgr_mask = _mm256_set1_epi32(0x00FFFFFF);
+// Validates the frame buffer and clips the search area to it. Returns false
+// with a pending JS exception on bad input; area.width / height are 0 when
+// the area is off the frame.
+bool ParseFrameAndArea(Napi::Env env, const Napi::Value& bufferValue, const Napi::Value& areaValue,
+                       const uint8_t*& bgraData, uint32_t& width, uint32_t& height, health_bars::Rect& area) {
+    Napi::Buffer<uint8_t> buffer = bufferValue.As<Napi::Buffer<uint8_t>>();
+    const uint8_t* bufferData = buffer.Data();
+    size_t bufferLength = buffer.Length();
 
-    // Check 29 pixels = 3*8 + 5
-    // Chunk 1 (pixels 1-8 of the inner border)
-    __m256i chunk0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
-    chunk0 = _mm256_and_si256(chunk0, bgr_mask);
-    if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk0, zero))) != 0xFF) {
+    if (bufferLength < 8) {
+        Napi::Error::New(env, "Buffer too small for header").ThrowAsJavaScriptException();
         return false;
     }
 
-    // Chunk 2 (pixels 9-16)
-    __m256i chunk1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
-    chunk1 = _mm256_and_si256(chunk1, bgr_mask);
-    if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk1, zero))) != 0xFF) {
-        return false;
-    }
+    width  = *reinterpret_cast<const uint32_t*>(bufferData);
+    height = *reinterpret_cast<const uint32_t*>(bufferData + 4);
+    bgraData = bufferData + 8;
+    size_t dataLength = bufferLength - 8;
 
-    // Chunk 3 (pixels 17-24)
-    __m256i chunk2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64));
-    chunk2 = _mm256_and_si256(chunk2, bgr_mask);
-    if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk2, zero))) != 0xFF) {
+    if (dataLength < width * height * 4) {
+        Napi::Error::New(env, "Buffer does not contain full image data").ThrowAsJavaScriptException();
         return false;
     }
 
-    // Handle the remaining 5 pixels (25-29) with a scalar loop
-    const uint8_t* remainder_p = p + 96;
-    for (int i = 0; i < 5; ++i) {
-        if (!IsBlack(remainder_p + i * 4)) {
-            return false;
-        }
+    Napi::Object areaObj = areaValue.As<Napi::Object>();
+    area.x = areaObj.Get("x").As<Napi::Number>().Uint32Value();
+    area.y = areaObj.Get("y").As<Napi::Number>().Uint32Value();
+    area.width = areaObj.Get("width").As<Napi::Number>().Uint32Value();
+    area.height = areaObj.Get("height").As<Napi::Number>().Uint32Value();
+
+    if (area.x >= width || area.y >= height) {
+        area.width = area.height = 0;
+        return true;
     }
+    area.width = std::min(area.width, width - area.x);
+    area.height = std::min(area.height, height - area.y);
     return true;
 }
 
-inline bool ValidateTopBorder(const WorkerData& data, uint32_t x, uint32_t y) {
-    const uint8_t* p = data.bgraData + (y * data.stride) + ((x + 1) * 4);
-    return ValidateHorizontalBorder(p);
+// Reads options.output. On failure a JS exception is pending.
+bool ParseOutputOption(Napi::Env env, const Napi::CallbackInfo& info, size_t index,
+                       OutputOptions& output, Napi::Int32Array& intoArray) {
+    output = OutputOptions();
+    if (info.Length() <= index || !info[index].IsObject()) return true;
+    Napi::Object options = info[index].As<Napi::Object>();
+    if (!options.Has("output")) return true;
+    Napi::Value value = options.Get("output");
+    if (value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_int32_array) {
+        output.records = output.into = true;
+        intoArray = value.As<Napi::Int32Array>();
+        return true;
+    }
+    if (!value.IsString() || (value.As<Napi::String>().Utf8Value() != "records" && value.As<Napi::String>().Utf8Value() != "objects")) {
+        Napi::TypeError::New(env, "options.output must be 'objects', 'records' or an Int32Array").ThrowAsJavaScriptException();
+        return false;
+    }
+    output.records = value.As<Napi::String>().Utf8Value() == "records";
+    return true;
 }
 
-inline bool ValidateBottomBorder(const WorkerData& data, uint32_t x, uint32_t y) {
-    const uint8_t* p = data.bgraData + ((y + 3) * data.stride) + ((x + 1) * 4);
-    return ValidateHorizontalBorder(p);
+Napi::Value EncodeBars(Napi::Env env, const std::vector<FoundHealthBar>& bars,
+                       const OutputOptions& output, Napi::Int32Array intoArray) {
+    if (output.into) {
+        health_bars::WriteRecords(bars, intoArray.Data(), intoArray.ElementLength() / RECORD_FIELDS);
+        return Napi::Number::New(env, static_cast<double>(bars.size()));
+    }
+    if (output.records) {
+        Napi::Int32Array out = Napi::Int32Array::New(env, bars.size() * RECORD_FIELDS);
+        health_bars::WriteRecords(bars, out.Data(), bars.size());
+        return out;
+    }
+    Napi::Array out = Napi::Array::New(env, bars.size());
+    for (size_t i = 0; i < bars.size(); ++i) {
+        Napi::Object obj = Napi::Object::New(env);
+        obj.Set("x", bars[i].x);
+        obj.Set("y", bars[i].y);
+        obj.Set("healthTag", Napi::String::New(env, health_bars::HealthTagName(bars[i].healthClass)));
+        obj.Set("hpPercent", bars[i].hpPercent);
+        if (bars[i].id != 0) obj.Set("id", bars[i].id);
+        out[i] = obj;
+    }
+    return out;
 }
 
-inline std::string GetHealthTagFromColor(uint32_t color) {
-    if (color == 0x600000 || color == 0) return "Critical";
-    if (color == 0xC00000 || color == 0xC03030) return "Low";
-    if (color == 0xC0C000) return "Medium";
-    if (color == 0x60C060) return "High";
-    if (color == 0x00C000) return "Full";
-    // --- NEW TAG ADDED ---
-    if (color == 0xC0C0C0) return "Obstructed";
-    return "Full";
+// The clustered bars of a whole search area; empty if the area cannot hold one.
+std::vector<FoundHealthBar> FindBarsInArea(const uint8_t* bgraData, uint32_t width, uint32_t height,
+                                           const health_bars::Rect& area) {
+    if (area.width < 32 || area.height < 4) return {};
+    std::vector<FoundHealthBar> found;
+    ScanBars(bgraData, width, height, area.x, area.y, area.width, area.height, found);
+    return health_bars::ClusterBars(found);
 }
 
-thread_local static std::vector<FoundHealthBar> tls_results;
-
-void HealthBarWorker(WorkerData data) {
-    tls_results.clear();
-
-    const __m256i zero = _mm256_setzero_si256();
-    const __m256i bgr_mask = _mm256_set1_epi32(0x00FFFFFF);
-
-    uint32_t startY = data.searchY;
-    uint32_t endY = data.searchY + data.searchH;
-
-    for (uint32_t y = startY; y < endY; ++y) {
-        if ((y & 7) == 0) {
-            size_t prefetchY = std::min(y + 32, data.height - 1);
-            _mm_prefetch((const char*)(data.bgraData + (prefetchY * data.stride)), _MM_HINT_T0);
-        }
-
-        // Check if we have enough rows remaining for a 4-pixel-tall health bar
-        // Need y, y+1, y+2, y+3 all to be valid
-        if (y + 3 >= data.height) break;
-
-        const uint8_t* row0 = data.bgraData + (y * data.stride);
-        const uint8_t* row1 = data.bgraData + ((y + 1) * data.stride);
-        const uint8_t* row2 = data.bgraData + ((y + 2) * data.stride);
-        const uint8_t* row3 = data.bgraData + ((y + 3) * data.stride);
-
-        uint32_t x = data.searchX;
-        const uint32_t endX = data.searchX + data.searchW - 31;
-
-        for (; x + 8 <= endX; x += 8) {
-            __m256i chunk0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 4));
-            __m256i chunk1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 4));
-            __m256i chunk2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2 + x * 4));
-            __m256i chunk3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row3 + x * 4));
-
-            chunk0 = _mm256_and_si256(chunk0, bgr_mask);
-            chunk1 = _mm256_and_si256(chunk1, bgr_mask);
-            chunk2 = _mm256_and_si256(chunk2, bgr_mask);
-            chunk3 = _mm256_and_si256(chunk3, bgr_mask);
-
-            __m256i cmp0 = _mm256_cmpeq_epi32(chunk0, zero);
-            __m256i cmp1 = _mm256_cmpeq_epi32(chunk1, zero);
-            __m256i cmp2 = _mm256_cmpeq_epi32(chunk2, zero);
-            __m256i cmp3 = _mm256_cmpeq_epi32(chunk3, zero);
-
-            __m256i vertical_match = _mm256_and_si256(_mm256_and_si256(cmp0, cmp1), _mm256_and_si256(cmp2, cmp3));
-            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(vertical_match));
-
-            if (mask == 0) continue;
-
-            for (int j = 0; j < 8; ++j) {
-                if (mask & (1 << j)) {
-                    uint32_t current_x = x + j;
-
-                    if (!ValidateRightBorder(data, current_x, y)) continue;
-                    if (!ValidateTopBorder(data, current_x, y)) continue;
-                    if (!ValidateBottomBorder(data, current_x, y)) continue;
-
-                    const uint8_t* innerPixelPtr = row1 + (current_x + 1) * 4;
-                    uint32_t innerColor = (static_cast<uint32_t>(innerPixelPtr[2]) << 16) |
-                                          (static_cast<uint32_t>(innerPixelPtr[1]) << 8) |
-                                          innerPixelPtr[0];
-
-                    if (!IsKnownBarColor(innerColor)) continue;
-
-                    int centerX = static_cast<int>(current_x + 15);
-                    int centerY = static_cast<int>(y + 2);
-                    std::string healthTag = GetHealthTagFromColor(innerColor);
-
-                    tls_results.push_back({ centerX, centerY, healthTag });
-                }
-            }
-        }
-
-        for (; x < endX; ++x) {
-            if (!IsBlack(row0 + x * 4)) continue;
-            if (!IsBlack(row1 + x * 4)) continue;
-            if (!IsBlack(row2 + x * 4)) continue;
-            if (!IsBlack(row3 + x * 4)) continue;
-
-            if (!ValidateRightBorder(data, x, y)) continue;
-            if (!ValidateTopBorder(data, x, y)) continue;
-            if (!ValidateBottomBorder(data, x, y)) continue;
-
-            const uint8_t* innerPixelPtr = row1 + (x + 1) * 4;
-            uint32_t innerColor = (static_cast<uint32_t>(innerPixelPtr[2]) << 16) |
-                                  (static_cast<uint32_t>(innerPixelPtr[1]) << 8) |
-                                  innerPixelPtr[0];
-
-            if (!IsKnownBarColor(innerColor)) continue;
-
-            int centerX = static_cast<int>(x + 15);
-            int centerY = static_cast<int>(y + 2);
-            std::string healthTag = GetHealthTagFromColor(innerColor);
+// findHealthBars(buffer, searchArea, [options]) -> [{ x, y, healthTag, hpPercent }]
+Napi::Value FindHealthBars(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
-            tls_results.push_back({ centerX, centerY, healthTag });
-        }
+    if (info.Length() < 2 || !info[0].IsBuffer() || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Expected (Buffer, Object searchArea)").ThrowAsJavaScriptException();
+        return env.Null();
     }
 
-    if (!tls_results.empty()) {
-        std::lock_guard<std::mutex> lock(*data.resultsMutex);
-        data.globalResults->insert(data.globalResults->end(), tls_results.begin(), tls_results.end());
-    }
+    const uint8_t* bgraData;
+    uint32_t width, height;
+    health_bars::Rect area;
+    OutputOptions output;
+    Napi::Int32Array intoArray;
+    if (!ParseFrameAndArea(env, info[0], info[1], bgraData, width, height, area)) return env.Null();
+    if (!ParseOutputOption(env, info, 2, output, intoArray)) return env.Null();
+
+    return EncodeBars(env, FindBarsInArea(bgraData, width, height, area), output, intoArray);
 }
 
-std::vector<FoundHealthBar> ClusterBars(std::vector<FoundHealthBar>& results) {
-    if (results.empty()) return {};
-
-    const int CELL_WIDTH = 32;
-    const int CELL_HEIGHT = 4;
-
-    int minX = results[0].x, maxX = results[0].x;
-    int minY = results[0].y, maxY = results[0].y;
-    for (const auto& r : results) {
-        minX = std::min(minX, r.x);
-        maxX = std::max(maxX, r.x);
-        minY = std::min(minY, r.y);
-        maxY = std::max(maxY, r.y);
+// ---------- Async ----------
+// Runs FindBarsInArea on the libuv pool (which hands the rows to the shared
+// vision pool), so the calling JS thread keeps running during the scan.
+class FindHealthBarsWorker : public Napi::AsyncWorker {
+public:
+    FindHealthBarsWorker(Napi::Promise::Deferred deferred, const Napi::Buffer<uint8_t>& buffer,
+                         const health_bars::Rect& area, const OutputOptions& output, Napi::Int32Array intoArray)
+        : Napi::AsyncWorker(deferred.Env()), area(area), output(output), deferred(deferred) {
+        // The buffer was validated by the caller.
+        bufferRef = Napi::ObjectReference::New(buffer, 1);
+        if (output.into) intoRef = Napi::ObjectReference::New(intoArray, 1);
+        bgraData = buffer.Data() + 8;
+        width = *reinterpret_cast<const uint32_t*>(buffer.Data());
+        height = *reinterpret_cast<const uint32_t*>(buffer.Data() + 4);
     }
 
-    int gridW = (maxX - minX) / CELL_WIDTH + 1;
-    int gridH = (maxY - minY) / CELL_HEIGHT + 1;
-
-    std::vector<std::vector<std::vector<size_t>>> grid(
-        gridH, std::vector<std::vector<size_t>>(gridW)
-    );
-
-    for (size_t i = 0; i < results.size(); ++i) {
-        int cellX = (results[i].x - minX) / CELL_WIDTH;
-        int cellY = (results[i].y - minY) / CELL_HEIGHT;
-        if (cellX < 0) cellX = 0;
-        if (cellY < 0) cellY = 0;
-        if (cellX >= gridW) cellX = gridW - 1;
-        if (cellY >= gridH) cellY = gridH - 1;
-        grid[cellY][cellX].push_back(i);
+protected:
+    void Execute() override {
+        bars = FindBarsInArea(bgraData, width, height, area);
     }
 
-    std::vector<bool> visited(results.size(), false);
-    std::vector<FoundHealthBar> mergedResults;
-
-    for (size_t i = 0; i < results.size(); ++i) {
-        if (visited[i]) continue;
-
-        std::vector<size_t> cluster;
-        cluster.push_back(i);
-        visited[i] = true;
-
-        size_t head = 0;
-        while (head < cluster.size()) {
-            size_t current_idx = cluster[head++];
-            const auto& current = results[current_idx];
-
-            int cellX = (current.x - minX) / CELL_WIDTH;
-            int cellY = (current.y - minY) / CELL_HEIGHT;
-
-            for (int dy = -1; dy <= 1; ++dy) {
-                for (int dx = -1; dx <= 1; ++dx) {
-                    int nx = cellX + dx;
-                    int ny = cellY + dy;
-                    if (nx < 0 || ny < 0 || nx >= gridW || ny >= gridH) continue;
-
-                    for (size_t j : grid[ny][nx]) {
-                        if (visited[j]) continue;
-                        const int barWidth = 31;
-                        const int barHeight = 4;
-                        bool x_touch = std::abs(current.x - results[j].x) <= barWidth;
-                        bool y_touch = std::abs(current.y - results[j].y) <= barHeight;
-                        if (x_touch && y_touch) {
-                            visited[j] = true;
-                            cluster.push_back(j);
-                        }
-                    }
-                }
-            }
-        }
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Int32Array intoArray;
+        if (output.into) intoArray = intoRef.Value().As<Napi::Int32Array>();
+        Napi::Value result = EncodeBars(env, bars, output, intoArray);
+        Release();
+        deferred.Resolve(result);
+    }
 
-        double sumX = 0, sumY = 0;
-        for (size_t idx : cluster) {
-            sumX += results[idx].x;
-            sumY += results[idx].y;
-        }
+    void OnError(const Napi::Error& e) override {
+        Release();
+        deferred.Reject(e.Value());
+    }
 
-        mergedResults.push_back({
-            static_cast<int>(std::round(sumX / cluster.size())),
-            static_cast<int>(std::round(sumY / cluster.size())),
-            results[cluster[0]].healthTag
-        });
+private:
+    void Release() {
+        bufferRef.Unref();
+        if (output.into) intoRef.Unref();
     }
 
-    return mergedResults;
-}
+    Napi::ObjectReference bufferRef, intoRef;
+    const uint8_t* bgraData;
+    uint32_t width, height;
+    health_bars::Rect area;
+    OutputOptions output;
+    Napi::Promise::Deferred deferred;
+    std::vector<FoundHealthBar> bars;
+};
 
-Napi::Value FindHealthBars(const Napi::CallbackInfo& info) {
+// findHealthBarsAsync(buffer, searchArea, [options]) -> Promise of what
+// findHealthBars returns. The buffer (and an output Int32Array) must not be
+// written to until the promise settles.
+Napi::Value FindHealthBarsAsync(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     if (info.Length() < 2 || !info[0].IsBuffer() || !info[1].IsObject()) {
@@ -313,81 +248,139 @@ Napi::Value FindHealthBars(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
-    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
-    const uint8_t* bufferData = buffer.Data();
-    size_t bufferLength = buffer.Length();
+    const uint8_t* bgraData;
+    uint32_t width, height;
+    health_bars::Rect area;
+    OutputOptions output;
+    Napi::Int32Array intoArray;
+    if (!ParseFrameAndArea(env, info[0], info[1], bgraData, width, height, area)) return env.Null();
+    if (!ParseOutputOption(env, info, 2, output, intoArray)) return env.Null();
+
+    auto deferred = Napi::Promise::Deferred::New(env);
+    auto worker = new FindHealthBarsWorker(deferred, info[0].As<Napi::Buffer<uint8_t>>(), area, output, intoArray);
+    worker->Queue();
+    return deferred.Promise();
+}
 
-    if (bufferLength < 8) {
-        Napi::Error::New(env, "Buffer too small for header").ThrowAsJavaScriptException();
-        return env.Null();
+// ---------- Tracking ----------
+using health_bars::TrackerHandle;
+
+static const napi_type_tag TRACKER_TYPE_TAG = { health_bars::TRACKER_TYPE_TAG_LOWER, health_bars::TRACKER_TYPE_TAG_UPPER };
+
+// The tracker behind a createHealthBarTracker handle (from this addon or
+// frameAnalyzer), or nullptr for any other value.
+static TrackerHandle* UnwrapTracker(const Napi::Value& value) {
+    if (!value.IsExternal()) return nullptr;
+    Napi::External<TrackerHandle> external = value.As<Napi::External<TrackerHandle>>();
+    return external.CheckTypeTag(&TRACKER_TYPE_TAG) ? external.Data() : nullptr;
+}
+
+// createHealthBarTracker([{ maxMotion }]) -> tracker
+// maxMotion: how far (pixels, per axis) a bar may move between two calls and
+// keep its id; defaults to one tile. The tracker also works as frameAnalyzer's
+// healthBars.tracker, and frameAnalyzer's trackers work here.
+Napi::Value CreateHealthBarTracker(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t maxMotion = health_bars::BarTracker::DEFAULT_MAX_MOTION;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("maxMotion")) {
+            if (!options.Get("maxMotion").IsNumber()) {
+                Napi::TypeError::New(env, "maxMotion must be a number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            maxMotion = options.Get("maxMotion").As<Napi::Number>().Uint32Value();
+        }
     }
+    Napi::External<TrackerHandle> tracker = Napi::External<TrackerHandle>::New(env, new TrackerHandle(maxMotion),
+        [](Napi::Env, TrackerHandle* handle) { delete handle; });
+    tracker.TypeTag(&TRACKER_TYPE_TAG);
+    return tracker;
+}
 
-    uint32_t width  = *reinterpret_cast<const uint32_t*>(bufferData);
-    uint32_t height = *reinterpret_cast<const uint32_t*>(bufferData + 4);
-    const uint8_t* bgraData = bufferData + 8;
-    size_t dataLength = bufferLength - 8;
-    uint32_t stride = width * 4;
+// trackHealthBars(tracker, buffer, searchArea, [dirtyRects], [options])
+//     -> [{ x, y, healthTag, hpPercent, id }]
+//
+// Like findHealthBars, plus a stable id per bar. dirtyRects must cover every
+// pixel that changed since this tracker's previous call; then bars away from
+// them are reused and only the dirty rects (grown by a bar's size) are
+// scanned. Without dirtyRects, or when the frame size or search area changed,
+// the whole area is scanned.
+Napi::Value TrackHealthBars(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
-    if (dataLength < width * height * 4) {
-        Napi::Error::New(env, "Buffer does not contain full image data").ThrowAsJavaScriptException();
+    if (info.Length() < 3 || !info[1].IsBuffer() || !info[2].IsObject()) {
+        Napi::TypeError::New(env, "Expected (tracker, Buffer, Object searchArea, [Array dirtyRects])").ThrowAsJavaScriptException();
         return env.Null();
     }
-
-    Napi::Object area = info[1].As<Napi::Object>();
-    uint32_t x = area.Get("x").As<Napi::Number>().Uint32Value();
-    uint32_t y = area.Get("y").As<Napi::Number>().Uint32Value();
-    uint32_t w = area.Get("width").As<Napi::Number>().Uint32Value();
-    uint32_t h = area.Get("height").As<Napi::Number>().Uint32Value();
-
-    if (x >= width || y >= height) return Napi::Array::New(env, 0);
-    w = std::min(w, width - x);
-    h = std::min(h, height - y);
-    if (w < 32 || h < 4) return Napi::Array::New(env, 0);
-
-    std::vector<FoundHealthBar> globalResults;
-    std::mutex globalResultsMutex;
-
-    unsigned numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) numThreads = 4;
-    numThreads = std::min(numThreads, h / 4);
-    if (numThreads == 0) numThreads = 1;
-
-    std::vector<std::thread> threads;
-    for (unsigned i = 0; i < numThreads; ++i) {
-        uint32_t startRow = y + (i * h) / numThreads;
-        uint32_t endRow = y + ((i + 1) * h) / numThreads;
-        uint32_t chunkHeight = endRow - startRow;
-
-        if (chunkHeight < 4) continue;
-
-        threads.emplace_back(HealthBarWorker, WorkerData{
-            bgraData, width, height, stride,
-            x, startRow, w, chunkHeight,
-            &globalResults,
-            &globalResultsMutex
-        });
+    TrackerHandle* handle = UnwrapTracker(info[0]);
+    if (!handle) {
+        Napi::TypeError::New(env, "tracker must come from createHealthBarTracker").ThrowAsJavaScriptException();
+        return env.Null();
     }
+    health_bars::BarTracker& tracker = handle->tracker;
 
-    for (auto& t : threads) {
-        if (t.joinable()) t.join();
+    const uint8_t* bgraData;
+    uint32_t width, height;
+    health_bars::Rect area;
+    OutputOptions output;
+    Napi::Int32Array intoArray;
+    if (!ParseFrameAndArea(env, info[1], info[2], bgraData, width, height, area)) return env.Null();
+    if (!ParseOutputOption(env, info, 4, output, intoArray)) return env.Null();
+
+    bool haveDirtyRects = info.Length() > 3 && info[3].IsArray();
+    std::vector<health_bars::Rect> dirtyRects;
+    if (haveDirtyRects) {
+        Napi::Array jsRects = info[3].As<Napi::Array>();
+        dirtyRects.reserve(jsRects.Length());
+        for (uint32_t i = 0; i < jsRects.Length(); ++i) {
+            Napi::Value v = jsRects.Get(i);
+            if (!v.IsObject()) continue;
+            Napi::Object r = v.As<Napi::Object>();
+            int64_t rx = r.Get("x").As<Napi::Number>().Int64Value();
+            int64_t ry = r.Get("y").As<Napi::Number>().Int64Value();
+            int64_t rx1 = std::min<int64_t>(rx + r.Get("width").As<Napi::Number>().Int64Value(), width);
+            int64_t ry1 = std::min<int64_t>(ry + r.Get("height").As<Napi::Number>().Int64Value(), height);
+            rx = std::max<int64_t>(rx, 0);
+            ry = std::max<int64_t>(ry, 0);
+            if (rx >= rx1 || ry >= ry1) continue;
+            dirtyRects.push_back({ static_cast<uint32_t>(rx), static_cast<uint32_t>(ry),
+                                   static_cast<uint32_t>(rx1 - rx), static_cast<uint32_t>(ry1 - ry) });
+        }
     }
 
-    std::vector<FoundHealthBar> mergedResults = ClusterBars(globalResults);
-
-    Napi::Array out = Napi::Array::New(env, mergedResults.size());
-    for (size_t i = 0; i < mergedResults.size(); ++i) {
-        Napi::Object obj = Napi::Object::New(env);
-        obj.Set("x", mergedResults[i].x);
-        obj.Set("y", mergedResults[i].y);
-        obj.Set("healthTag", Napi::String::New(env, mergedResults[i].healthTag));
-        out[i] = obj;
+    // A frameAnalyzer scan still in flight on this tracker will not become its
+    // history, and until it lands the history is not the caller's last frame.
+    ++handle->calls;
+    bool incremental = haveDirtyRects && handle->inFlight == 0 && tracker.HasHistory(width, height, area);
+
+    std::vector<FoundHealthBar> bars;
+    if (area.width >= 32 && area.height >= 4) {
+        std::vector<FoundHealthBar> found;
+        if (incremental) {
+            bars = tracker.CleanBars(dirtyRects);
+            health_bars::Rect starts;
+            for (const health_bars::Rect& dirty : dirtyRects) {
+                if (!health_bars::DirtyStarts(dirty, area, starts)) continue;
+                ScanBars(bgraData, width, height, starts.x, starts.y,
+                         starts.width + health_bars::BAR_WIDTH, starts.height, found);
+            }
+        } else {
+            ScanBars(bgraData, width, height, area.x, area.y, area.width, area.height, found);
+        }
+        std::vector<FoundHealthBar> merged = health_bars::ClusterBars(found);
+        bars.insert(bars.end(), merged.begin(), merged.end());
     }
 
-    return out;
+    tracker.Update(bars, width, height, area);
+    return EncodeBars(env, bars, output, intoArray);
 }
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("findHealthBars", Napi::Function::New(env, FindHealthBars));
+    exports.Set("findHealthBarsAsync", Napi::Function::New(env, FindHealthBarsAsync));
+    exports.Set("createHealthBarTracker", Napi::Function::New(env, CreateHealthBarTracker));
+    exports.Set("trackHealthBars", Napi::Function::New(env, TrackHealthBars));
     return exports;
 }
 
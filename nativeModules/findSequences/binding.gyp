@@ -4,7 +4,8 @@
       "target_name": "findSequences",
       "sources": [ "./src/findSequences.cc" ],
       "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")"
+        "<!@(node -p \"require('node-addon-api').include\")",
+        "../common"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
@@ -21,10 +22,8 @@
           "cflags_cc": [
             "-std=c++17",
             "-O3",
-            "-march=native",
-            "-mtune=native",
-            "-mavx2",
-            "-mfma",
+            "-march=x86-64",
+            "-mtune=generic",
             "-funroll-loops",
             "-funroll-all-loops",
             "-fpeel-loops",
@@ -5,16 +5,31 @@
 #include <cstring>  // OPTIMIZED: For strcmp
 #include <set>
 #include <cstdint>
-#include <thread>
 #include <cmath>
 #include <algorithm>
 #include <unordered_map>
 #include <atomic>
+#include <memory>
+#include <mutex>
 
-#include <immintrin.h>
+#include "sequenceConfig.h"
+#include "sequenceMatcher.h"
+#include "threadPool.h"
+
+using sequence_config::ParseTargetSequences;
+using sequence_config::ParseTolerance;
+using sequence_config::SequenceDefinition;
+using sequence_matcher::ColorWithin;
+using sequence_matcher::CompiledSequence;
+using sequence_matcher::SequenceMatcher;
 
 // ---------- Constants ----------
-const uint32_t ANY_COLOR_HASH = 0xFFFFFFFF;
+// Compiled matchers kept for reuse; callers cycle through a handful of task sets.
+const size_t MATCHER_CACHE_SIZE = 8;
+// Work items target an equal share of the scanned pixels: CHUNKS_PER_THREAD
+// per pool thread, so stealing can even out, but never below MIN_CHUNK_PIXELS.
+const unsigned CHUNKS_PER_THREAD = 4;
+const uint64_t MIN_CHUNK_PIXELS = 16384;
 
 // ---------- Structures ----------
 struct SearchArea {
@@ -24,15 +39,8 @@ struct SearchArea {
 
 struct PixelCheck {
     uint32_t x, y;
-    std::string id;
-};
-
-struct SequenceDefinition {
-    std::string name;
-    std::vector<uint32_t> sequenceHashes;
-    const char* direction = "horizontal";  // OPTIMIZED: Use const char* for literals
-    int offsetX = 0, offsetY = 0;
-    const char* variant = "primary";       // OPTIMIZED: Use const char* for literals
+    uint32_t index;  // Into SearchPlan::pixelCheckIds
+    uint8_t tolerance = 0;  // Max per-channel difference; 0 is exact
 };
 
 struct FirstCandidate {
@@ -51,10 +59,11 @@ struct FoundCoords {
     }
 };
 
-using FirstCandidateMap = std::unordered_map<std::string, std::pair<FirstCandidate, FirstCandidate>>;
+// Indexed by result slot: each task's targets occupy [resultBase, resultBase + targetNames.size()).
+using FirstCandidateMap = std::vector<std::pair<FirstCandidate, FirstCandidate>>;
 // PHASE 2 OPTIMIZED: Use vector instead of set to avoid tree rebalancing allocations
-using AllCandidateMap   = std::unordered_map<std::string, std::pair<std::vector<FoundCoords>, std::vector<FoundCoords>>>;
-using PixelCheckResultMap = std::unordered_map<std::string, bool>;
+using AllCandidateMap   = std::vector<std::pair<std::vector<FoundCoords>, std::vector<FoundCoords>>>;
+using PixelCheckResultMap = std::vector<uint8_t>;  // Hit flag per pixel check index
 
 // NEW: A map of a row (y-coordinate) to the checks on that row.
 // The inner map is color -> vector of checks for that color.
@@ -62,11 +71,61 @@ using RowBasedPixelChecks = std::unordered_map<uint32_t, std::unordered_map<uint
 
 struct SearchTask {
     std::string taskName;
-    std::unordered_map<uint32_t, std::vector<SequenceDefinition>> firstColorLookup;
-    std::unordered_map<uint32_t, std::vector<PixelCheck>> pixelChecks;
+    std::vector<SequenceDefinition> sequences;
     std::vector<std::string> targetNames;
     SearchArea searchArea;
-    std::string occurrenceMode = "first";
+    bool firstOccurrence = true;  // occurrence: "first" (default) or "all"
+    uint32_t resultBase = 0;
+    uint32_t pixelCheckBegin = 0, pixelCheckEnd = 0;  // Range in SearchPlan::pixelCheckIds
+    uint32_t reach = 0;  // Longest sequence - 1: how far past a start pixel a match reads
+};
+
+// A task's sequence results from the plan's last run, reused by runPlan while
+// no dirty rect touches the task's area.
+struct TaskResultCache {
+    bool valid = false;
+    SearchArea area;
+    uint32_t frameWidth = 0, frameHeight = 0;
+    FirstCandidateMap first;  // Per target, like the task's result slots
+    AllCandidateMap all;
+};
+
+// Everything parsed and preprocessed from a searchTasks object. Immutable once
+// built apart from the result cache and its run counters, so
+// compileSearchPlan() handles are shared by concurrent runs.
+struct SearchPlan {
+    std::vector<SearchTask> tasks;
+    uint32_t totalResultSlots = 0;
+    std::shared_ptr<const SequenceMatcher> matcher;
+    RowBasedPixelChecks rowBasedChecks;
+    std::vector<std::pair<uint32_t, uint32_t>> pixelCheckRows;  // (y, checks), sorted by y
+    std::vector<std::string> pixelCheckIds;
+    std::vector<std::pair<uint32_t, uint32_t>> pixelCheckPoints;  // (x, y) per pixelCheckIds entry
+    mutable std::mutex cacheMutex;
+    mutable std::vector<TaskResultCache> resultCache;  // Per task
+    mutable uint64_t runs = 0;      // runPlan calls queued so far
+    mutable uint32_t inFlight = 0;  // runPlan calls not yet finished
+};
+
+// runPlan(..., { output: 'records' }) resolves to an Int32Array of
+// RECORD_FIELDS-int records (nameIndex, x, y, variant). nameIndex indexes
+// getPlanNames(): result slots first, then pixel checks.
+const uint32_t RECORD_FIELDS = 4;
+enum RecordVariant : int32_t { VARIANT_PRIMARY = 0, VARIANT_BACKUP = 1, VARIANT_PIXEL_CHECK = 2 };
+
+// Rows [y0, y1) scan the same x spans: the merged search areas of the tasks
+// with sequences that cover them.
+struct RowBand {
+    uint32_t y0, y1;
+    std::vector<std::pair<uint32_t, uint32_t>> spans;
+};
+
+// The rows one run actually visits, cut into work items of similar pixel
+// cost. Item i covers rows[itemBegin[i] .. itemBegin[i + 1]).
+struct RowSchedule {
+    std::vector<std::pair<uint32_t, uint32_t>> rows;  // [y0, y1), ascending
+    std::vector<uint32_t> itemBegin;
+    uint32_t Items() const { return itemBegin.empty() ? 0 : static_cast<uint32_t>(itemBegin.size() - 1); }
 };
 
 struct WorkerData {
@@ -74,15 +133,17 @@ struct WorkerData {
     uint32_t bufferWidth, bufferHeight, stride;
     size_t bgraDataLength;
     const std::vector<SearchTask>& tasks;
+    const std::vector<SearchArea>& areas;  // This run's search area per task
     FirstCandidateMap* localFirstResults;
     AllCandidateMap* localAllResults;
     PixelCheckResultMap* localPixelCheckResults; // MODIFIED: Now per-thread
-    std::atomic<uint32_t>* next_row;
     const RowBasedPixelChecks* rowBasedChecks; // NEW: Pointer to pre-processed checks
+    const SequenceMatcher* matcher;
+    const std::vector<RowBand>* bands;
 };
 
-// ---------- Parsing utilities (Unchanged) ----------
-// ... (HexToUint32, ParseColorSequence, ParseTargetSequences are identical)
+// ---------- Parsing utilities ----------
+// Sequence configs are parsed by sequenceConfig.h.
 uint32_t HexToUint32(const std::string& hex) {
     if (hex.length() > 1 && hex[0] == '#') {
         return std::stoul(hex.substr(1), nullptr, 16);
@@ -90,391 +151,411 @@ uint32_t HexToUint32(const std::string& hex) {
     return 0;
 }
 
-bool ParseColorSequence(Napi::Env env, const Napi::Array& jsSeq, std::vector<uint32_t>& out) {
-    uint32_t len = jsSeq.Length();
-    out.clear();
-    out.reserve(len);  // OPTIMIZED: Reserve before clear for better memory reuse
-    for (uint32_t i = 0; i < len; ++i) {
-        Napi::Value v = jsSeq.Get(i);
-        if (v.IsString() && v.As<Napi::String>().Utf8Value() == "any") {
-            out.push_back(ANY_COLOR_HASH);
-            continue;
+// ---------- Compiled matcher cache ----------
+// FNV-1a over everything the matcher depends on: task order, result slots and
+// the sequences themselves (search areas are applied at scan time).
+uint64_t SequenceFingerprint(const std::vector<SearchTask>& tasks) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto mix = [&hash](uint64_t value) { hash = (hash ^ value) * 0x100000001B3ULL; };
+    for (const SearchTask& task : tasks) {
+        mix(task.sequences.size()); mix(task.resultBase);
+        for (const SequenceDefinition& def : task.sequences) {
+            mix(def.targetIndex); mix(def.horizontal); mix(def.primary); mix(def.tolerance);
+            mix(static_cast<uint32_t>(def.offsetX)); mix(static_cast<uint32_t>(def.offsetY));
+            mix(def.sequenceHashes.size());
+            for (uint32_t color : def.sequenceHashes) mix(color);
         }
-        if (!v.IsArray()) return false;
-        Napi::Array arr = v.As<Napi::Array>();
-        if (arr.Length() != 3) return false;
-        uint32_t r = arr.Get(0u).As<Napi::Number>().Uint32Value();
-        uint32_t g = arr.Get(1u).As<Napi::Number>().Uint32Value();
-        uint32_t b = arr.Get(2u).As<Napi::Number>().Uint32Value();
-        out.push_back((r << 16) | (g << 8) | b);
     }
-    return true;
+    return hash;
 }
 
-bool ParseTargetSequences(Napi::Env env,
-                          const Napi::Object& jsSequences,
-                          std::unordered_map<uint32_t, std::vector<SequenceDefinition>>& firstColorLookup,
-                          std::vector<std::string>& targetNames) {
-    Napi::Array names = jsSequences.GetPropertyNames();
-    uint32_t n = names.Length();
-    firstColorLookup.clear();
-    firstColorLookup.reserve(n);  // OPTIMIZED: Pre-allocate hash map
-    targetNames.clear();
-    targetNames.reserve(n);
-    for (uint32_t i = 0; i < n; ++i) {
-        Napi::Value keyVal = names.Get(i);
-        if (!keyVal.IsString()) continue;
-        std::string name = keyVal.As<Napi::String>().Utf8Value();
-        targetNames.emplace_back(name);
-        Napi::Object cfg = jsSequences.Get(keyVal).As<Napi::Object>();
-        SequenceDefinition def;
-        def.name = name;
-        // OPTIMIZED: Store string literals as const char* to avoid allocation
-        std::string dirStr = cfg.Has("direction") ? cfg.Get("direction").As<Napi::String>().Utf8Value() : "horizontal";
-        def.direction = dirStr == "vertical" ? "vertical" : "horizontal";
-        if (cfg.Has("offset")) {
-            Napi::Object off = cfg.Get("offset").As<Napi::Object>();
-            def.offsetX = off.Has("x") ? off.Get("x").As<Napi::Number>().Int32Value() : 0;
-            def.offsetY = off.Has("y") ? off.Get("y").As<Napi::Number>().Int32Value() : 0;
-        }
-        if (cfg.Has("sequence")) {
-            def.variant = "primary";  // const char* literal, no allocation
-            if (!ParseColorSequence(env, cfg.Get("sequence").As<Napi::Array>(), def.sequenceHashes)) return false;
-            if (!def.sequenceHashes.empty() && def.sequenceHashes[0] != ANY_COLOR_HASH)
-                firstColorLookup[def.sequenceHashes[0]].push_back(def);
+std::shared_ptr<const SequenceMatcher> GetSequenceMatcher(const std::vector<SearchTask>& tasks) {
+    static std::mutex cacheMutex;
+    static std::vector<std::pair<uint64_t, std::shared_ptr<const SequenceMatcher>>> cache;  // Most recent first
+    uint64_t fingerprint = SequenceFingerprint(tasks);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (size_t i = 0; i < cache.size(); ++i) {
+            if (cache[i].first != fingerprint) continue;
+            std::rotate(cache.begin(), cache.begin() + i, cache.begin() + i + 1);
+            return cache.front().second;
         }
-        if (cfg.Has("backupSequence")) {
-            SequenceDefinition back = def;
-            back.variant = "backup";
-            if (!ParseColorSequence(env, cfg.Get("backupSequence").As<Napi::Array>(), back.sequenceHashes)) return false;
-            if (!back.sequenceHashes.empty() && back.sequenceHashes[0] != ANY_COLOR_HASH)
-                firstColorLookup[back.sequenceHashes[0]].push_back(back);
+    }
+    auto matcher = std::make_shared<SequenceMatcher>();
+    for (uint32_t t = 0; t < tasks.size(); ++t) {
+        for (const SequenceDefinition& def : tasks[t].sequences) {
+            matcher->Add({t, tasks[t].resultBase + def.targetIndex, def.horizontal, def.primary, def.offsetX, def.offsetY, 0, 0, def.tolerance}, def.sequenceHashes);
         }
     }
-    return true;
+    matcher->Build();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.insert(cache.begin(), {fingerprint, matcher});
+    if (cache.size() > MATCHER_CACHE_SIZE) cache.pop_back();
+    return matcher;
 }
 
 
-// ---------- Verification Function (Unchanged) ----------
-void VerifyAndRecordMatch(const WorkerData& data, const SequenceDefinition& seqDef, const SearchTask& task, uint32_t x, uint32_t y) {
-    // ... (This function is identical to the original)
-    const size_t seqLen = seqDef.sequenceHashes.size();
-    if (seqLen == 0) return;
-    bool match = true;
-
-    // OPTIMIZED: Use strcmp for const char* comparison
-    bool isHorizontal = (std::strcmp(seqDef.direction, "horizontal") == 0);
-    if (isHorizontal) {
-        if (x + seqLen > data.bufferWidth) return;
-        for (size_t j = 1; j < seqLen; ++j) {
-            uint32_t expectedColor = seqDef.sequenceHashes[j];
-            if (expectedColor == ANY_COLOR_HASH) continue;
-            size_t nextPixelOffset = (y * data.stride) + ((x + j) * 4);
-            if (nextPixelOffset + 2 >= data.bgraDataLength) { match = false; break; }
-            uint32_t actualColor = (static_cast<uint32_t>(data.bgraData[nextPixelOffset + 2]) << 16) | (static_cast<uint32_t>(data.bgraData[nextPixelOffset + 1]) << 8) | (static_cast<uint32_t>(data.bgraData[nextPixelOffset]));
-            if (actualColor != expectedColor) { match = false; break; }
-        }
-    } else { // Vertical
-        if (y + seqLen > data.bufferHeight) return;
-        for (size_t j = 1; j < seqLen; ++j) {
-            uint32_t expectedColor = seqDef.sequenceHashes[j];
-            if (expectedColor == ANY_COLOR_HASH) continue;
-            size_t nextPixelOffset = ((y + j) * data.stride) + (x * 4);
-            if (nextPixelOffset + 2 >= data.bgraDataLength) { match = false; break; }
-            uint32_t actualColor = (static_cast<uint32_t>(data.bgraData[nextPixelOffset + 2]) << 16) | (static_cast<uint32_t>(data.bgraData[nextPixelOffset + 1]) << 8) | (static_cast<uint32_t>(data.bgraData[nextPixelOffset]));
-            if (actualColor != expectedColor) { match = false; break; }
-        }
-    }
+// ---------- Verification Function ----------
+void VerifyAndRecordMatch(const WorkerData& data, const CompiledSequence& seq, uint32_t x, uint32_t y) {
+    if (!data.matcher->Matches(data.bgraData, data.bufferWidth, data.bufferHeight, data.stride, seq, x, y)) return;
 
-    if (match) {
-        size_t currentPixelIndex = y * data.bufferWidth + x;
-        int foundX = static_cast<int>(x) + seqDef.offsetX;
-        int foundY = static_cast<int>(y) + seqDef.offsetY;
-        
-        // OPTIMIZED: Use strcmp for const char* comparison
-        bool isFirstMode = (std::strcmp(task.occurrenceMode.c_str(), "first") == 0);
-        bool isPrimary = (std::strcmp(seqDef.variant, "primary") == 0);
-        
-        if (isFirstMode) {
-            auto& candidatePair = (*data.localFirstResults)[seqDef.name];
-            if (isPrimary) {
-                if (candidatePair.first.pixelIndex == static_cast<size_t>(-1) || currentPixelIndex < candidatePair.first.pixelIndex) {
-                    candidatePair.first = {foundX, foundY, currentPixelIndex};
-                }
-            } else {
-                if (candidatePair.first.pixelIndex == static_cast<size_t>(-1)) {
-                    if (candidatePair.second.pixelIndex == static_cast<size_t>(-1) || currentPixelIndex < candidatePair.second.pixelIndex) {
-                        candidatePair.second = {foundX, foundY, currentPixelIndex};
-                    }
-                }
+    size_t currentPixelIndex = static_cast<size_t>(y) * data.bufferWidth + x;
+    int foundX = static_cast<int>(x) + seq.offsetX;
+    int foundY = static_cast<int>(y) + seq.offsetY;
+    if (data.tasks[seq.task].firstOccurrence) {
+        auto& candidatePair = (*data.localFirstResults)[seq.slot];
+        if (seq.primary) {
+            if (candidatePair.first.pixelIndex == static_cast<size_t>(-1) || currentPixelIndex < candidatePair.first.pixelIndex) {
+                candidatePair.first = {foundX, foundY, currentPixelIndex};
             }
         } else {
-            // PHASE 2 OPTIMIZED: push_back instead of insert for vector
-            auto& candidatePair = (*data.localAllResults)[seqDef.name];
-            if (isPrimary) candidatePair.first.push_back({foundX, foundY});
-            else candidatePair.second.push_back({foundX, foundY});
+            if (candidatePair.first.pixelIndex == static_cast<size_t>(-1)) {
+                if (candidatePair.second.pixelIndex == static_cast<size_t>(-1) || currentPixelIndex < candidatePair.second.pixelIndex) {
+                    candidatePair.second = {foundX, foundY, currentPixelIndex};
+                }
+            }
         }
+    } else {
+        // PHASE 2 OPTIMIZED: push_back instead of insert for vector
+        auto& candidatePair = (*data.localAllResults)[seq.slot];
+        if (seq.primary) candidatePair.first.push_back({foundX, foundY});
+        else candidatePair.second.push_back({foundX, foundY});
     }
 }
 
 // REMOVED: FindSequencesWorker is now part of UnifiedSearchWorker
 // void FindSequencesWorker(const WorkerData& d) { ... }
 
-// NEW: The unified worker that handles both pixel and sequence checks in one pass.
-void UnifiedSearchWorker(const WorkerData& d) {
-    const uint32_t chunk = 16;
-    while (true) {
-        uint32_t startY = d.next_row->fetch_add(chunk);
-        if (startY >= d.bufferHeight) break;
-        uint32_t endY = std::min(startY + chunk, d.bufferHeight);
-
-        for (uint32_t y = startY; y < endY; ++y) {
-            // --- 1. Perform Pixel Checks for this row ---
-            auto row_it = d.rowBasedChecks->find(y);
-            if (row_it != d.rowBasedChecks->end()) {
-                for (const auto& [colorHash, checks] : row_it->second) {
-                    for (const auto& check : checks) {
-                        // Bounds already checked during pre-processing
-                        size_t offset = (check.y * d.stride) + (check.x * 4);
-                        uint32_t actualColor = (static_cast<uint32_t>(d.bgraData[offset + 2]) << 16) |
-                                               (static_cast<uint32_t>(d.bgraData[offset + 1]) << 8) |
-                                               (static_cast<uint32_t>(d.bgraData[offset]));
-                        if (actualColor == colorHash) {
-                            (*d.localPixelCheckResults)[check.id] = true;
-                        }
+// The unified worker that handles both pixel and sequence checks in one pass,
+// over rows [startY, endY) (one range of a work item).
+void UnifiedSearchWorker(const WorkerData& d, uint32_t startY, uint32_t endY) {
+    for (uint32_t y = startY; y < endY; ++y) {
+        // --- 1. Perform Pixel Checks for this row ---
+        auto row_it = d.rowBasedChecks->find(y);
+        if (row_it != d.rowBasedChecks->end()) {
+            for (const auto& [colorHash, checks] : row_it->second) {
+                for (const auto& check : checks) {
+                    if (check.x >= d.bufferWidth) continue;
+                    size_t offset = (check.y * d.stride) + (check.x * 4);
+                    uint32_t actualColor = (static_cast<uint32_t>(d.bgraData[offset + 2]) << 16) |
+                                           (static_cast<uint32_t>(d.bgraData[offset + 1]) << 8) |
+                                           (static_cast<uint32_t>(d.bgraData[offset]));
+                    if (actualColor == colorHash || (check.tolerance && ColorWithin(actualColor, colorHash, check.tolerance))) {
+                        (*d.localPixelCheckResults)[check.index] = 1;
                     }
                 }
             }
+        }
 
-            // --- 2. Perform Sequence Searches for this row ---
-            const uint8_t* row = d.bgraData + y * d.stride;
-            for (const SearchTask& task : d.tasks) {
-                if (task.firstColorLookup.empty()) continue;
-
-                // Check if the current row is within the task's vertical search area
-                if (y < task.searchArea.y || y >= (task.searchArea.y + task.searchArea.height)) continue;
-
-                uint32_t startX = task.searchArea.x;
-                uint32_t endX   = task.searchArea.x + task.searchArea.width;
-
-                // AVX2 accelerated part
-                uint32_t x = startX;
-                for (; x + 8 <= endX; x += 8) {
-                    __m256i chunkVec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x * 4));
-                    for (const auto& [color, seqs] : task.firstColorLookup) {
-                        uint32_t r = (color >> 16) & 0xFF;
-                        uint32_t g = (color >> 8)  & 0xFF;
-                        uint32_t b =  color        & 0xFF;
-                        uint32_t target_bgra = (0xFF << 24) | (r << 16) | (g << 8) | b;
-                        __m256i target = _mm256_set1_epi32(target_bgra);
-                        __m256i cmp    = _mm256_cmpeq_epi32(chunkVec, target);
-                        int mask       = _mm256_movemask_ps(_mm256_castsi256_ps(cmp));
-                        if (mask) {
-                            for (int j = 0; j < 8; ++j) {
-                                if (mask & (1 << j)) {
-                                    for (const SequenceDefinition& seq : seqs) {
-                                        VerifyAndRecordMatch(d, seq, task, x + j, y);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                // Remainder part
-                for (; x < endX; ++x) {
-                    const uint8_t* pixel = row + x * 4;
-                    uint32_t r = pixel[2], g = pixel[1], b = pixel[0];
-                    uint32_t currentColorHash = (r << 16) | (g << 8) | b;
-                    auto it = task.firstColorLookup.find(currentColorHash);
-                    if (it != task.firstColorLookup.end()) {
-                        for (const SequenceDefinition& seq : it->second) {
-                            VerifyAndRecordMatch(d, seq, task, x, y);
-                        }
+        // --- 2. Perform Sequence Searches for this row ---
+        // One pass over the row's spans finds candidates for every task;
+        // each is kept only inside its own task's search area.
+        auto band = std::upper_bound(d.bands->begin(), d.bands->end(), y, [](uint32_t row, const RowBand& b) { return row < b.y1; });
+        if (band == d.bands->end() || y < band->y0) continue;
+        const uint8_t* row = d.bgraData + y * d.stride;
+        for (const auto& [startX, endX] : band->spans) {
+            d.matcher->ScanRow(row, startX, endX, [&](const CompiledSequence& seq, uint32_t x) {
+                const SearchArea& area = d.areas[seq.task];
+                if (!area.active || x < area.x || x >= area.x + area.width || y < area.y || y >= area.y + area.height) return;
+                VerifyAndRecordMatch(d, seq, x, y);
+            });
+        }
+    }
+}
+
+// Splits the frame's rows into bands with identical merged x spans. Areas are
+// clipped to the frame.
+std::vector<RowBand> BuildRowBands(const std::vector<SearchTask>& tasks, const std::vector<SearchArea>& areas, uint32_t bufferWidth, uint32_t bufferHeight) {
+    std::vector<uint32_t> edges;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        const SearchArea& a = areas[t];
+        if (tasks[t].sequences.empty() || !a.active || a.x >= bufferWidth || a.y >= bufferHeight) continue;
+        edges.push_back(a.y);
+        edges.push_back(std::min(a.y + a.height, bufferHeight));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    std::vector<RowBand> bands;
+    for (size_t i = 0; i + 1 < edges.size(); ++i) {
+        RowBand band{edges[i], edges[i + 1], {}};
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            const SearchArea& a = areas[t];
+            if (tasks[t].sequences.empty() || !a.active || a.x >= bufferWidth || a.y > band.y0 || a.y + a.height < band.y1) continue;
+            band.spans.push_back({a.x, std::min(a.x + a.width, bufferWidth)});
+        }
+        if (band.spans.empty()) continue;
+        std::sort(band.spans.begin(), band.spans.end());
+        size_t merged = 0;
+        for (size_t j = 1; j < band.spans.size(); ++j) {
+            if (band.spans[j].first <= band.spans[merged].second) band.spans[merged].second = std::max(band.spans[merged].second, band.spans[j].second);
+            else band.spans[++merged] = band.spans[j];
+        }
+        band.spans.resize(merged + 1);
+        bands.push_back(std::move(band));
+    }
+    return bands;
+}
+
+// Schedules the band rows plus the rows holding pixel checks outside every
+// band; rows neither search nor check anything are never dispatched. Costs
+// are pixels: the band's span widths per row, or the row's check count.
+RowSchedule BuildRowSchedule(const std::vector<RowBand>& bands, const std::vector<std::pair<uint32_t, uint32_t>>& pixelCheckRows, uint32_t bufferHeight, unsigned threads) {
+    struct Run { uint32_t y0, y1; uint64_t rowCost; };
+    std::vector<Run> runs;
+    uint64_t total = 0;
+    auto band = bands.begin();
+    auto check = pixelCheckRows.begin();
+    while (band != bands.end() || check != pixelCheckRows.end()) {
+        if (check != pixelCheckRows.end() && check->first >= bufferHeight) check = pixelCheckRows.end();
+        if (check == pixelCheckRows.end() || (band != bands.end() && band->y0 <= check->first)) {
+            if (band == bands.end()) break;
+            uint64_t rowCost = 0;
+            for (const auto& [x0, x1] : band->spans) rowCost += x1 - x0;
+            runs.push_back({band->y0, band->y1, rowCost});
+            total += rowCost * (band->y1 - band->y0);
+            // Checks inside the band run with its rows.
+            while (check != pixelCheckRows.end() && check->first < band->y1) ++check;
+            ++band;
+        } else {
+            runs.push_back({check->first, check->first + 1, check->second});
+            total += check->second;
+            ++check;
+        }
+    }
+
+    RowSchedule schedule;
+    const uint64_t target = std::max<uint64_t>(total / (static_cast<uint64_t>(threads) * CHUNKS_PER_THREAD), MIN_CHUNK_PIXELS);
+    uint64_t cost = 0;
+    schedule.itemBegin.push_back(0);
+    for (const Run& run : runs) {
+        for (uint32_t y = run.y0; y < run.y1;) {
+            uint64_t wanted = (target - cost + run.rowCost - 1) / std::max<uint64_t>(run.rowCost, 1);
+            uint32_t take = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(wanted, 1), run.y1 - y));
+            bool extend = !schedule.rows.empty() && schedule.rows.size() > schedule.itemBegin.back() && schedule.rows.back().second == y;
+            if (extend) schedule.rows.back().second = y + take;
+            else schedule.rows.push_back({y, y + take});
+            cost += run.rowCost * take;
+            y += take;
+            if (cost >= target) {
+                schedule.itemBegin.push_back(static_cast<uint32_t>(schedule.rows.size()));
+                cost = 0;
+            }
+        }
+    }
+    if (schedule.rows.size() > schedule.itemBegin.back()) schedule.itemBegin.push_back(static_cast<uint32_t>(schedule.rows.size()));
+    return schedule;
+}
+
+
+// ---------- Search plans ----------
+bool ParseSearchArea(Napi::Env env, const Napi::Value& value, SearchArea& area) {
+    if (!value.IsObject()) {
+        Napi::TypeError::New(env, "searchArea must be an object { x, y, width, height }").ThrowAsJavaScriptException();
+        return false;
+    }
+    Napi::Object areaObj = value.As<Napi::Object>();
+    area.x = areaObj.Get("x").As<Napi::Number>().Uint32Value();
+    area.y = areaObj.Get("y").As<Napi::Number>().Uint32Value();
+    area.width = areaObj.Get("width").As<Napi::Number>().Uint32Value();
+    area.height = areaObj.Get("height").As<Napi::Number>().Uint32Value();
+    area.active = true;
+    return true;
+}
+
+// Parses a searchTasks object into a plan. On failure a JS exception is
+// pending and nullptr is returned.
+std::shared_ptr<SearchPlan> CompileSearchPlan(Napi::Env env, const Napi::Object& jsSearchTasks) {
+    auto plan = std::make_shared<SearchPlan>();
+    Napi::Array names = jsSearchTasks.GetPropertyNames();
+    uint32_t n = names.Length();
+    plan->tasks.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        Napi::Value keyVal = names.Get(i);
+        if (!keyVal.IsString()) continue;
+        std::string taskName = keyVal.As<Napi::String>().Utf8Value();
+        Napi::Object cfg = jsSearchTasks.Get(keyVal).As<Napi::Object>();
+        SearchTask task;
+        task.taskName = taskName;
+
+        // Parse sequence searches
+        if (cfg.Has("sequences")) {
+            if (!ParseTargetSequences(env, cfg.Get("sequences").As<Napi::Object>(), task.sequences, task.targetNames)) {
+                Napi::Error::New(env, "Failed to parse target sequences for task: " + taskName).ThrowAsJavaScriptException();
+                return nullptr;
+            }
+            task.firstOccurrence = cfg.Get("occurrence").As<Napi::String>().Utf8Value() == "first";
+            task.resultBase = plan->totalResultSlots;
+            plan->totalResultSlots += static_cast<uint32_t>(task.targetNames.size());
+            for (const SequenceDefinition& def : task.sequences) task.reach = std::max(task.reach, static_cast<uint32_t>(def.sequenceHashes.size()) - 1);
+        }
+
+        // Parse pixel checks straight into the row-based lookup
+        task.pixelCheckBegin = static_cast<uint32_t>(plan->pixelCheckIds.size());
+        if (cfg.Has("pixelChecks")) {
+            Napi::Object checksObj = cfg.Get("pixelChecks").As<Napi::Object>();
+            Napi::Array colorKeys = checksObj.GetPropertyNames();
+            for (uint32_t j = 0; j < colorKeys.Length(); ++j) {
+                std::string colorHex = colorKeys.Get(j).As<Napi::String>().Utf8Value();
+                uint32_t colorHash = HexToUint32(colorHex) & 0xFFFFFF;
+
+                Napi::Array points = checksObj.Get(colorKeys.Get(j)).As<Napi::Array>();
+                for (uint32_t k = 0; k < points.Length(); ++k) {
+                    Napi::Object point = points.Get(k).As<Napi::Object>();
+                    PixelCheck check{
+                        point.Get("x").As<Napi::Number>().Uint32Value(),
+                        point.Get("y").As<Napi::Number>().Uint32Value(),
+                        static_cast<uint32_t>(plan->pixelCheckIds.size())
+                    };
+                    if (point.Has("tolerance") && !ParseTolerance(env, point.Get("tolerance"), check.tolerance)) {
+                        Napi::RangeError::New(env, "pixelChecks tolerance must be a number from 0 to 255 in task: " + taskName).ThrowAsJavaScriptException();
+                        return nullptr;
                     }
+                    plan->pixelCheckIds.push_back(point.Get("id").As<Napi::String>().Utf8Value());
+                    plan->pixelCheckPoints.push_back({check.x, check.y});
+                    plan->rowBasedChecks[check.y][colorHash].push_back(check);
                 }
             }
         }
+        task.pixelCheckEnd = static_cast<uint32_t>(plan->pixelCheckIds.size());
+
+        if (!ParseSearchArea(env, cfg.Get("searchArea"), task.searchArea)) return nullptr;
+        plan->tasks.emplace_back(std::move(task));
+    }
+    for (const auto& [y, colors] : plan->rowBasedChecks) {
+        uint32_t checks = 0;
+        for (const auto& entry : colors) checks += static_cast<uint32_t>(entry.second.size());
+        plan->pixelCheckRows.push_back({y, checks});
+    }
+    std::sort(plan->pixelCheckRows.begin(), plan->pixelCheckRows.end());
+    plan->resultCache.resize(plan->tasks.size());
+    plan->matcher = GetSequenceMatcher(plan->tasks);
+    return plan;
+}
+
+// Checks the frame header; on failure a JS exception is pending.
+bool ValidateFrameBuffer(Napi::Env env, const Napi::Buffer<uint8_t>& imageBuffer) {
+    if (imageBuffer.Length() < 8) {
+        Napi::Error::New(env, "Buffer too small for header").ThrowAsJavaScriptException();
+        return false;
+    }
+    uint32_t width = *reinterpret_cast<uint32_t*>(imageBuffer.Data());
+    uint32_t height = *reinterpret_cast<uint32_t*>(imageBuffer.Data() + 4);
+    if (imageBuffer.Length() < static_cast<size_t>(width) * height * 4 + 8) {
+        Napi::Error::New(env, "Buffer length does not match dimensions in header").ThrowAsJavaScriptException();
+        return false;
     }
+    return true;
 }
 
+// Per-call options of runPlan().
+struct RunOptions {
+    bool records = false;      // output: 'records'
+    bool incremental = false;  // dirtyRects given: reuse results of untouched tasks
+    std::vector<SearchArea> dirtyRects;
+    uint64_t run = 0;          // This call's SearchPlan::runs number; 0 outside runPlan
+    bool overlapped = false;   // Queued while another run of the plan was in flight
+};
+
+// Whether a match starting in the task's area could read a pixel in a rect.
+bool TouchesDirtyRect(const SearchArea& area, uint32_t reach, const std::vector<SearchArea>& rects) {
+    uint64_t x1 = static_cast<uint64_t>(area.x) + area.width + reach;
+    uint64_t y1 = static_cast<uint64_t>(area.y) + area.height + reach;
+    for (const SearchArea& r : rects) {
+        if (r.x < x1 && static_cast<uint64_t>(r.x) + r.width > area.x && r.y < y1 && static_cast<uint64_t>(r.y) + r.height > area.y) return true;
+    }
+    return false;
+}
 
 // ---------- Async Worker Class ----------
 class SearchWorker : public Napi::AsyncWorker {
 public:
-    SearchWorker(Napi::Promise::Deferred deferred, const Napi::Buffer<uint8_t>& imageBuffer, const Napi::Object& jsSearchTasks, bool isBatch)
-        : Napi::AsyncWorker(deferred.Env()), deferred(deferred), isBatchCall(isBatch) {
-        // ... (Constructor parsing logic is identical to the original)
+    SearchWorker(Napi::Promise::Deferred deferred, const Napi::Buffer<uint8_t>& imageBuffer, std::shared_ptr<const SearchPlan> plan, std::vector<SearchArea> areas, bool isBatch, RunOptions options)
+        : Napi::AsyncWorker(deferred.Env()), plan(std::move(plan)), areas(std::move(areas)), isBatchCall(isBatch), options(std::move(options)), deferred(deferred) {
+        // The buffer was validated by the caller.
         bufferRef = Napi::ObjectReference::New(imageBuffer, 1);
-
         uint8_t* bufferData = imageBuffer.Data();
-        if (imageBuffer.Length() < 8) {
-            Napi::Error::New(Env(), "Buffer too small for header").ThrowAsJavaScriptException();
-            return;
-        }
         bufferWidth = *reinterpret_cast<uint32_t*>(bufferData);
         bufferHeight = *reinterpret_cast<uint32_t*>(bufferData + 4);
         bgraData = bufferData + 8;
         bgraDataLength = static_cast<size_t>(bufferWidth) * bufferHeight * 4;
         stride = bufferWidth * 4;
-
-        if (imageBuffer.Length() < bgraDataLength + 8) {
-            Napi::Error::New(Env(), "Buffer length does not match dimensions in header").ThrowAsJavaScriptException();
-            return;
-        }
-
-        Napi::Array names = jsSearchTasks.GetPropertyNames();
-        uint32_t n = names.Length();
-        tasks.reserve(n);
-        for (uint32_t i = 0; i < n; ++i) {
-            Napi::Value keyVal = names.Get(i);
-            if (!keyVal.IsString()) continue;
-            std::string taskName = keyVal.As<Napi::String>().Utf8Value();
-            Napi::Object cfg = jsSearchTasks.Get(keyVal).As<Napi::Object>();
-            SearchTask task;
-            task.taskName = taskName;
-
-            // Parse sequence searches
-            if (cfg.Has("sequences")) {
-                if (!ParseTargetSequences(Env(), cfg.Get("sequences").As<Napi::Object>(), task.firstColorLookup, task.targetNames)) {
-                    Napi::Error::New(Env(), "Failed to parse target sequences for task: " + taskName).ThrowAsJavaScriptException();
-                    return;
-                }
-                task.occurrenceMode = cfg.Get("occurrence").As<Napi::String>().Utf8Value();
-            }
-
-            // Parse pixel checks
-            if (cfg.Has("pixelChecks")) {
-                Napi::Object checksObj = cfg.Get("pixelChecks").As<Napi::Object>();
-                Napi::Array colorKeys = checksObj.GetPropertyNames();
-                for (uint32_t j = 0; j < colorKeys.Length(); ++j) {
-                    std::string colorHex = colorKeys.Get(j).As<Napi::String>().Utf8Value();
-                    uint32_t colorHash = HexToUint32(colorHex);
-                    uint32_t r = (colorHash >> 16) & 0xFF;
-                    uint32_t g = (colorHash >> 8) & 0xFF;
-                    uint32_t b = colorHash & 0xFF;
-                    colorHash = (r << 16) | (g << 8) | b; // Ensure RGB order
-
-                    Napi::Array points = checksObj.Get(colorKeys.Get(j)).As<Napi::Array>();
-                    std::vector<PixelCheck> checkList;
-                    checkList.reserve(points.Length());
-                    for (uint32_t k = 0; k < points.Length(); ++k) {
-                        Napi::Object point = points.Get(k).As<Napi::Object>();
-                        checkList.push_back({
-                            point.Get("x").As<Napi::Number>().Uint32Value(),
-                            point.Get("y").As<Napi::Number>().Uint32Value(),
-                            point.Get("id").As<Napi::String>().Utf8Value()
-                        });
-                    }
-                    task.pixelChecks[colorHash] = checkList;
-                }
-            }
-
-            Napi::Object areaObj = cfg.Get("searchArea").As<Napi::Object>();
-            task.searchArea.x = areaObj.Get("x").As<Napi::Number>().Uint32Value();
-            task.searchArea.y = areaObj.Get("y").As<Napi::Number>().Uint32Value();
-            task.searchArea.width = areaObj.Get("width").As<Napi::Number>().Uint32Value();
-            task.searchArea.height = areaObj.Get("height").As<Napi::Number>().Uint32Value();
-            task.searchArea.active = true;
-            tasks.emplace_back(std::move(task));
-        }
     }
 
     ~SearchWorker() {}
 
 protected:
-    // REMOVED: This is now integrated into the unified worker.
-    // void PerformPixelChecks() { ... }
-
     void Execute() override {
-        // --- Pre-process pixel checks for fast row-based lookup ---
-        RowBasedPixelChecks rowBasedChecks;
-        rowBasedChecks.reserve(bufferHeight / 8);  // OPTIMIZED: Pre-allocate based on typical row usage
-        std::unordered_map<std::string, std::string> pixelCheckIdToTaskName;
-        
-        // OPTIMIZED: Pre-calculate total pixel checks to reserve space
-        size_t totalPixelChecks = 0;
-        for (const auto& task : tasks) {
-            for (const auto& [colorHash, checks] : task.pixelChecks) {
-                totalPixelChecks += checks.size();
+        const std::vector<SearchTask>& tasks = plan->tasks;
+        const uint32_t totalResultSlots = plan->totalResultSlots;
+        const size_t totalPixelChecks = plan->pixelCheckIds.size();
+
+        // --- Skip tasks no dirty rect reaches; their cached results stand ---
+        std::vector<TaskResultCache> reused(tasks.size());
+        if (options.incremental) {
+            std::lock_guard<std::mutex> lock(plan->cacheMutex);
+            for (size_t t = 0; t < tasks.size(); ++t) {
+                const TaskResultCache& cache = plan->resultCache[t];
+                const SearchArea& area = areas[t];
+                if (tasks[t].sequences.empty() || !cache.valid || cache.frameWidth != bufferWidth || cache.frameHeight != bufferHeight) continue;
+                if (cache.area.x != area.x || cache.area.y != area.y || cache.area.width != area.width || cache.area.height != area.height) continue;
+                if (TouchesDirtyRect(area, tasks[t].reach, options.dirtyRects)) continue;
+                reused[t] = cache;
+                areas[t].active = false;
             }
         }
-        pixelCheckIdToTaskName.reserve(totalPixelChecks);
 
-        for (const auto& task : tasks) {
-            if (task.pixelChecks.empty()) continue;
-            for (const auto& [colorHash, checks] : task.pixelChecks) {
-                for (const auto& check : checks) {
-                    if (check.x >= bufferWidth || check.y >= bufferHeight) continue;
-                    // Store the check in the row-based map
-                    rowBasedChecks[check.y][colorHash].push_back(check);
-                    // Map the check ID back to its task name for result aggregation
-                    pixelCheckIdToTaskName[check.id] = task.taskName;
-                }
-            }
-        }
+        // --- Perform unified search on the shared thread pool ---
+        vision_pool::ThreadPool& pool = vision_pool::ThreadPool::Instance();
+        unsigned numThreads = pool.Slots();
 
-        // --- Perform unified search using threading ---
-        unsigned numThreads = std::min((unsigned)std::thread::hardware_concurrency(), bufferHeight);
-        if (!numThreads) numThreads = 1;
+        std::vector<FirstCandidateMap> threadFirstResults(numThreads, FirstCandidateMap(totalResultSlots));
+        std::vector<AllCandidateMap> threadAllResults(numThreads, AllCandidateMap(totalResultSlots));
+        std::vector<PixelCheckResultMap> threadPixelCheckResults(numThreads, PixelCheckResultMap(totalPixelChecks, 0));
 
-        std::vector<FirstCandidateMap> threadFirstResults(numThreads);
-        std::vector<AllCandidateMap> threadAllResults(numThreads);
-        std::vector<PixelCheckResultMap> threadPixelCheckResults(numThreads); // NEW: Per-thread results
+        std::vector<RowBand> bands = BuildRowBands(tasks, areas, bufferWidth, bufferHeight);
+        const RowSchedule schedule = BuildRowSchedule(bands, plan->pixelCheckRows, bufferHeight, numThreads);
 
-        // OPTIMIZED: Calculate unique names and reserve space
-        std::set<std::string> uniqueNames;
-        size_t totalTargetNames = 0;
-        for (const auto& t : tasks) {
-            totalTargetNames += t.targetNames.size();
-            uniqueNames.insert(t.targetNames.begin(), t.targetNames.end());
-        }
-        
-        for (unsigned i = 0; i < numThreads; ++i) {
-            threadFirstResults[i].reserve(uniqueNames.size());
-            threadAllResults[i].reserve(uniqueNames.size());
-            threadPixelCheckResults[i].reserve(totalPixelChecks / numThreads);  // OPTIMIZED: Pre-allocate pixel check results
-        }
-
-        std::atomic<uint32_t> nextRow(0);
-        std::vector<std::thread> threads;
+        std::vector<WorkerData> workerData;
+        workerData.reserve(numThreads);
         for (unsigned i = 0; i < numThreads; ++i) {
-            threads.emplace_back(UnifiedSearchWorker, WorkerData{
+            workerData.push_back(WorkerData{
                 bgraData, bufferWidth, bufferHeight, stride, bgraDataLength,
-                tasks, &threadFirstResults[i], &threadAllResults[i],
-                &threadPixelCheckResults[i], // NEW
-                &nextRow, &rowBasedChecks    // NEW
+                tasks, areas, &threadFirstResults[i], &threadAllResults[i],
+                &threadPixelCheckResults[i],
+                &plan->rowBasedChecks,
+                plan->matcher.get(), &bands
             });
         }
-        for (auto& t : threads) t.join();
+        pool.ParallelFor(0, schedule.Items(), 1, [&workerData, &schedule](uint32_t first, uint32_t last, unsigned slot) {
+            for (uint32_t i = schedule.itemBegin[first]; i < schedule.itemBegin[last]; ++i) {
+                UnifiedSearchWorker(workerData[slot], schedule.rows[i].first, schedule.rows[i].second);
+            }
+        });
 
         // --- Merge results from all threads ---
-        // OPTIMIZED: Pre-allocate merged result maps
-        mergedFirstResults.reserve(uniqueNames.size());
-        mergedAllResults.reserve(uniqueNames.size());
-        
-        // Merge sequence results (unchanged)
+        mergedFirstResults.assign(totalResultSlots, {});
+        mergedAllResults.assign(totalResultSlots, {});
+
         for (const auto& localMap : threadFirstResults) {
-            for (const auto& [name, pair] : localMap) {
-                if (mergedFirstResults.find(name) == mergedFirstResults.end()) {
-                    mergedFirstResults[name] = pair;
-                    continue;
-                }
-                auto& best = mergedFirstResults.at(name);
+            for (uint32_t slot = 0; slot < totalResultSlots; ++slot) {
+                const auto& pair = localMap[slot];
+                auto& best = mergedFirstResults[slot];
                 if (pair.first.pixelIndex != static_cast<size_t>(-1) && (best.first.pixelIndex == static_cast<size_t>(-1) || pair.first.pixelIndex < best.first.pixelIndex)) best.first = pair.first;
                 if (best.first.pixelIndex == static_cast<size_t>(-1) && pair.second.pixelIndex != static_cast<size_t>(-1) && (best.second.pixelIndex == static_cast<size_t>(-1) || pair.second.pixelIndex < best.second.pixelIndex)) best.second = pair.second;
             }
         }
         // PHASE 2 OPTIMIZED: Merge vectors and sort/unique at end instead of set insert
         for (const auto& localMap : threadAllResults) {
-            for (const auto& [name, pair] : localMap) {
-                auto& merged = mergedAllResults[name];
+            for (uint32_t slot = 0; slot < totalResultSlots; ++slot) {
+                const auto& pair = localMap[slot];
+                auto& merged = mergedAllResults[slot];
                 merged.first.insert(merged.first.end(), pair.first.begin(), pair.first.end());
                 merged.second.insert(merged.second.end(), pair.second.begin(), pair.second.end());
             }
         }
         
         // PHASE 2 OPTIMIZED: Sort and remove duplicates once at end
-        for (auto& [name, pair] : mergedAllResults) {
+        for (auto& pair : mergedAllResults) {
             auto& [pri, bak] = pair;
             if (!pri.empty()) {
                 std::sort(pri.begin(), pri.end());
@@ -486,39 +567,65 @@ protected:
             }
         }
 
-        // MODIFIED: Merge pixel check results
-        for (const auto& localMap : threadPixelCheckResults) {
-            for (const auto& [id, found] : localMap) {
-                if (found) {
-                    auto it = pixelCheckIdToTaskName.find(id);
-                    if (it != pixelCheckIdToTaskName.end()) {
-                        const std::string& taskName = it->second;
-                        mergedPixelCheckResults[taskName][id] = true;
-                    }
+        // --- Fill skipped tasks from the cache, refresh it with the rest ---
+        // dirtyRects are relative to the plan's previous run, which is only
+        // well defined while runs do not overlap. A run that overlapped
+        // another one drops the cache, so the next run searches everything.
+        {
+            std::lock_guard<std::mutex> lock(plan->cacheMutex);
+            bool keepCache = true;
+            if (options.run) {
+                --plan->inFlight;
+                keepCache = !options.overlapped && plan->runs == options.run;
+            }
+            for (size_t t = 0; t < tasks.size(); ++t) {
+                const SearchTask& task = tasks[t];
+                if (task.sequences.empty()) continue;
+                auto first = mergedFirstResults.begin() + task.resultBase;
+                auto all = mergedAllResults.begin() + task.resultBase;
+                const size_t n = task.targetNames.size();
+                TaskResultCache& cache = plan->resultCache[t];
+                if (reused[t].valid) {
+                    std::copy(reused[t].first.begin(), reused[t].first.end(), first);
+                    std::copy(reused[t].all.begin(), reused[t].all.end(), all);
+                    if (!keepCache) cache.valid = false;
+                    continue;
                 }
+                cache.valid = keepCache;
+                if (!keepCache) continue;
+                cache.area = areas[t];
+                cache.frameWidth = bufferWidth; cache.frameHeight = bufferHeight;
+                cache.first.assign(first, first + n);
+                cache.all.assign(all, all + n);
             }
         }
+
+        mergedPixelCheckResults.assign(totalPixelChecks, 0);
+        for (const auto& localHits : threadPixelCheckResults) {
+            for (size_t i = 0; i < totalPixelChecks; ++i) mergedPixelCheckResults[i] |= localHits[i];
+        }
     }
 
     void OnOK() override {
-        // ... (This function is identical to the original)
         Napi::Env env = Env();
         Napi::HandleScope scope(env);
+        if (options.records) {
+            Napi::Int32Array records = EncodeRecords(env);
+            bufferRef.Unref();
+            deferred.Resolve(records);
+            return;
+        }
 
         Napi::Object finalResults = Napi::Object::New(env);
-        for (const SearchTask& task : tasks) {
+        for (const SearchTask& task : plan->tasks) {
             Napi::Object taskResult = Napi::Object::New(env);
 
             // Add sequence search results
-            if (!task.firstColorLookup.empty()) {
-                if (task.occurrenceMode == "first") {
-                    for (const std::string& name : task.targetNames) {
-                        auto it = mergedFirstResults.find(name);
-                        if (it == mergedFirstResults.end()) {
-                            taskResult.Set(name, env.Null());
-                            continue;
-                        }
-                        const auto& pair = it->second;
+            if (!task.targetNames.empty()) {
+                if (task.firstOccurrence) {
+                    for (uint32_t t = 0; t < task.targetNames.size(); ++t) {
+                        const std::string& name = task.targetNames[t];
+                        const auto& pair = mergedFirstResults[task.resultBase + t];
                         if (pair.first.pixelIndex != static_cast<size_t>(-1)) {
                             Napi::Object c = Napi::Object::New(env); c.Set("x", pair.first.x); c.Set("y", pair.first.y);
                             taskResult.Set(name, c);
@@ -530,13 +637,9 @@ protected:
                         }
                     }
                 } else { // "all"
-                    for (const std::string& name : task.targetNames) {
-                        auto it = mergedAllResults.find(name);
-                        if (it == mergedAllResults.end()) {
-                            taskResult.Set(name, Napi::Array::New(env, 0));
-                            continue;
-                        }
-                        const auto& [pri, bak] = it->second;
+                    for (uint32_t t = 0; t < task.targetNames.size(); ++t) {
+                        const std::string& name = task.targetNames[t];
+                        const auto& [pri, bak] = mergedAllResults[task.resultBase + t];
                         const auto& resultSet = !pri.empty() ? pri : bak;
                         Napi::Array arr = Napi::Array::New(env, resultSet.size());
                         size_t idx = 0;
@@ -550,13 +653,8 @@ protected:
             }
 
             // Add pixel check results
-            auto pixelCheckIt = mergedPixelCheckResults.find(task.taskName);
-            if (pixelCheckIt != mergedPixelCheckResults.end()) {
-                for (const auto& [id, found] : pixelCheckIt->second) {
-                    if (found) {
-                        taskResult.Set(id, Napi::Boolean::New(env, true));
-                    }
-                }
+            for (uint32_t i = task.pixelCheckBegin; i < task.pixelCheckEnd; ++i) {
+                if (mergedPixelCheckResults[i]) taskResult.Set(plan->pixelCheckIds[i], Napi::Boolean::New(env, true));
             }
 
             finalResults.Set(task.taskName, taskResult);
@@ -581,21 +679,80 @@ protected:
     }
 
 private:
+    // The merged results as flat records, in getPlanNames() order.
+    Napi::Int32Array EncodeRecords(Napi::Env env) const {
+        size_t count = 0;
+        for (const SearchTask& task : plan->tasks) {
+            for (uint32_t t = 0; t < task.targetNames.size(); ++t) {
+                uint32_t slot = task.resultBase + t;
+                if (task.firstOccurrence) {
+                    const auto& pair = mergedFirstResults[slot];
+                    count += pair.first.pixelIndex != static_cast<size_t>(-1) || pair.second.pixelIndex != static_cast<size_t>(-1);
+                } else {
+                    const auto& [pri, bak] = mergedAllResults[slot];
+                    count += !pri.empty() ? pri.size() : bak.size();
+                }
+            }
+        }
+        for (uint8_t hit : mergedPixelCheckResults) count += hit;
+
+        Napi::Int32Array records = Napi::Int32Array::New(env, count * RECORD_FIELDS);
+        int32_t* out = records.Data();
+        auto put = [&out](uint32_t nameIndex, int32_t x, int32_t y, RecordVariant variant) {
+            out[0] = static_cast<int32_t>(nameIndex); out[1] = x; out[2] = y; out[3] = variant;
+            out += RECORD_FIELDS;
+        };
+        for (const SearchTask& task : plan->tasks) {
+            for (uint32_t t = 0; t < task.targetNames.size(); ++t) {
+                uint32_t slot = task.resultBase + t;
+                if (task.firstOccurrence) {
+                    const auto& pair = mergedFirstResults[slot];
+                    if (pair.first.pixelIndex != static_cast<size_t>(-1)) put(slot, pair.first.x, pair.first.y, VARIANT_PRIMARY);
+                    else if (pair.second.pixelIndex != static_cast<size_t>(-1)) put(slot, pair.second.x, pair.second.y, VARIANT_BACKUP);
+                } else {
+                    const auto& [pri, bak] = mergedAllResults[slot];
+                    for (const FoundCoords& fc : !pri.empty() ? pri : bak) put(slot, fc.x, fc.y, !pri.empty() ? VARIANT_PRIMARY : VARIANT_BACKUP);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < mergedPixelCheckResults.size(); ++i) {
+            if (!mergedPixelCheckResults[i]) continue;
+            const auto& [x, y] = plan->pixelCheckPoints[i];
+            put(plan->totalResultSlots + i, static_cast<int32_t>(x), static_cast<int32_t>(y), VARIANT_PIXEL_CHECK);
+        }
+        return records;
+    }
+
     Napi::ObjectReference bufferRef;
     uint8_t* bgraData;
     uint32_t bufferWidth, bufferHeight, stride;
     size_t bgraDataLength;
-    std::vector<SearchTask> tasks;
+    std::shared_ptr<const SearchPlan> plan;
+    std::vector<SearchArea> areas;
     bool isBatchCall;
+    RunOptions options;
     Napi::Promise::Deferred deferred;
     FirstCandidateMap mergedFirstResults;
     AllCandidateMap mergedAllResults;
-    std::unordered_map<std::string, PixelCheckResultMap> mergedPixelCheckResults;
+    PixelCheckResultMap mergedPixelCheckResults;
 };
 
+std::vector<SearchArea> PlanSearchAreas(const SearchPlan& plan) {
+    std::vector<SearchArea> areas;
+    areas.reserve(plan.tasks.size());
+    for (const SearchTask& task : plan.tasks) areas.push_back(task.searchArea);
+    return areas;
+}
 
-// ---------- Public Async Wrappers & Module Registration (Unchanged) ----------
-// ... (FindSequencesAsyncBatch, FindSequencesAsync, and Init are identical)
+Napi::Value QueueSearch(Napi::Env env, const Napi::Buffer<uint8_t>& imageBuffer, std::shared_ptr<const SearchPlan> plan, std::vector<SearchArea> areas, bool isBatch, RunOptions options = {}) {
+    auto deferred = Napi::Promise::Deferred::New(env);
+    auto worker = new SearchWorker(deferred, imageBuffer, std::move(plan), std::move(areas), isBatch, std::move(options));
+    worker->Queue();
+    return deferred.Promise();
+}
+
+
+// ---------- Public Async Wrappers & Module Registration ----------
 Napi::Value FindSequencesAsyncBatch(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     if (info.Length() < 2 || !info[0].IsBuffer() || !info[1].IsObject()) {
@@ -603,10 +760,12 @@ Napi::Value FindSequencesAsyncBatch(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
-    auto deferred = Napi::Promise::Deferred::New(env);
-    auto worker = new SearchWorker(deferred, info[0].As<Napi::Buffer<uint8_t>>(), info[1].As<Napi::Object>(), true);
-    worker->Queue();
-    return deferred.Promise();
+    Napi::Buffer<uint8_t> imageBuffer = info[0].As<Napi::Buffer<uint8_t>>();
+    if (!ValidateFrameBuffer(env, imageBuffer)) return env.Null();
+    std::shared_ptr<SearchPlan> plan = CompileSearchPlan(env, info[1].As<Napi::Object>());
+    if (!plan) return env.Null();
+    std::vector<SearchArea> areas = PlanSearchAreas(*plan);
+    return QueueSearch(env, imageBuffer, std::move(plan), std::move(areas), true);
 }
 
 Napi::Value FindSequencesAsync(const Napi::CallbackInfo& info) {
@@ -616,6 +775,8 @@ Napi::Value FindSequencesAsync(const Napi::CallbackInfo& info) {
         return env.Null();
     }
 
+    Napi::Buffer<uint8_t> imageBuffer = info[0].As<Napi::Buffer<uint8_t>>();
+    if (!ValidateFrameBuffer(env, imageBuffer)) return env.Null();
     Napi::Object searchTasks = Napi::Object::New(env);
     Napi::Object singleTask = Napi::Object::New(env);
     singleTask.Set("sequences", info[1]);
@@ -624,7 +785,7 @@ Napi::Value FindSequencesAsync(const Napi::CallbackInfo& info) {
     if (info.Length() > 2 && info[2].IsObject()) {
         searchArea = info[2].As<Napi::Object>();
     } else {
-        uint8_t* bufferData = info[0].As<Napi::Buffer<uint8_t>>().Data();
+        uint8_t* bufferData = imageBuffer.Data();
         uint32_t w = *reinterpret_cast<uint32_t*>(bufferData);
         uint32_t h = *reinterpret_cast<uint32_t*>(bufferData + 4);
         searchArea.Set("x", 0); searchArea.Set("y", 0);
@@ -633,16 +794,148 @@ Napi::Value FindSequencesAsync(const Napi::CallbackInfo& info) {
     singleTask.Set("searchArea", searchArea);
     searchTasks.Set("defaultTask", singleTask);
 
-    auto deferred = Napi::Promise::Deferred::New(env);
-    auto worker = new SearchWorker(deferred, info[0].As<Napi::Buffer<uint8_t>>(), searchTasks, false);
-    worker->Queue();
-    return deferred.Promise();
+    std::shared_ptr<SearchPlan> plan = CompileSearchPlan(env, searchTasks);
+    if (!plan) return env.Null();
+    std::vector<SearchArea> areas = PlanSearchAreas(*plan);
+    return QueueSearch(env, imageBuffer, std::move(plan), std::move(areas), false);
+}
+
+using SearchPlanHandle = std::shared_ptr<const SearchPlan>;
+
+// Tags compileSearchPlan's Externals: JS can pass any External (a health bar
+// tracker, say), so handles are checked before they are cast.
+static const napi_type_tag SEARCH_PLAN_TYPE_TAG = { 0x3f7b2e91c05d68a4ULL, 0x92c64a1d7e83b0f5ULL };
+
+// The plan behind a compileSearchPlan handle, or nullptr for any other value.
+static const SearchPlanHandle* UnwrapPlan(const Napi::Value& value) {
+    if (!value.IsExternal()) return nullptr;
+    Napi::External<SearchPlanHandle> external = value.As<Napi::External<SearchPlanHandle>>();
+    return external.CheckTypeTag(&SEARCH_PLAN_TYPE_TAG) ? external.Data() : nullptr;
+}
+
+// compileSearchPlan(searchTasks): parses and preprocesses a searchTasks object
+// (same shape as for findSequencesNativeBatch) once. Returns an opaque handle
+// for runPlan().
+Napi::Value CompileSearchPlanNative(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Expected (Object searchTasks)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    std::shared_ptr<SearchPlan> plan = CompileSearchPlan(env, info[0].As<Napi::Object>());
+    if (!plan) return env.Null();
+    Napi::External<SearchPlanHandle> handle = Napi::External<SearchPlanHandle>::New(env, new SearchPlanHandle(std::move(plan)),
+        [](Napi::Env, SearchPlanHandle* handle) { delete handle; });
+    handle.TypeTag(&SEARCH_PLAN_TYPE_TAG);
+    return handle;
+}
+
+// getPlanNames(handle): the name table for runPlan's record output, fetched
+// once per plan. Entry i is { task, name } for record nameIndex i; name is the
+// target name for sequence results and the check id for pixel checks.
+Napi::Value GetPlanNames(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    const SearchPlanHandle* handle = info.Length() < 1 ? nullptr : UnwrapPlan(info[0]);
+    if (!handle) {
+        Napi::TypeError::New(env, "Expected (plan handle from compileSearchPlan)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    const SearchPlan& plan = **handle;
+    Napi::Array names = Napi::Array::New(env, plan.totalResultSlots + plan.pixelCheckIds.size());
+    for (const SearchTask& task : plan.tasks) {
+        Napi::String taskName = Napi::String::New(env, task.taskName);
+        auto set = [&](uint32_t index, const std::string& name) {
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("task", taskName); entry.Set("name", name);
+            names[index] = entry;
+        };
+        for (uint32_t t = 0; t < task.targetNames.size(); ++t) set(task.resultBase + t, task.targetNames[t]);
+        for (uint32_t i = task.pixelCheckBegin; i < task.pixelCheckEnd; ++i) set(plan.totalResultSlots + i, plan.pixelCheckIds[i]);
+    }
+    return names;
+}
+
+// runPlan(handle, buffer, [options]): findSequencesNativeBatch with a compiled
+// plan. options.searchArea replaces every task's search area for this run;
+// options.searchAreas ({ taskName: area }) replaces individual ones.
+// options.output = 'records' resolves to an Int32Array of (nameIndex, x, y,
+// variant) records instead of nested objects; variant is 0 for a sequence,
+// 1 for its backupSequence and 2 for a matched pixel check.
+// options.dirtyRects ([{ x, y, width, height }]) lists what changed since this
+// plan's previous run: tasks whose area (grown by their longest sequence) no
+// rect touches return that run's results without being searched. Pixel checks
+// are always evaluated. Runs of one plan should not overlap; a run queued
+// while another is in flight searches everything, and once they overlapped
+// neither keeps its results for the next run.
+Napi::Value RunPlan(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[1].IsBuffer()) {
+        Napi::TypeError::New(env, "Expected (plan handle, Buffer, [Object options])").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    const SearchPlanHandle* handle = UnwrapPlan(info[0]);
+    if (!handle) {
+        Napi::TypeError::New(env, "plan handle must come from compileSearchPlan").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    SearchPlanHandle plan = *handle;
+    Napi::Buffer<uint8_t> imageBuffer = info[1].As<Napi::Buffer<uint8_t>>();
+    if (!ValidateFrameBuffer(env, imageBuffer)) return env.Null();
+
+    std::vector<SearchArea> areas = PlanSearchAreas(*plan);
+    RunOptions runOptions;
+    if (info.Length() > 2 && info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("searchArea")) {
+            SearchArea area;
+            if (!ParseSearchArea(env, options.Get("searchArea"), area)) return env.Null();
+            std::fill(areas.begin(), areas.end(), area);
+        }
+        if (options.Has("searchAreas")) {
+            Napi::Object overrides = options.Get("searchAreas").As<Napi::Object>();
+            for (size_t t = 0; t < plan->tasks.size(); ++t) {
+                if (!overrides.Has(plan->tasks[t].taskName)) continue;
+                if (!ParseSearchArea(env, overrides.Get(plan->tasks[t].taskName), areas[t])) return env.Null();
+            }
+        }
+        if (options.Has("output")) {
+            Napi::Value output = options.Get("output");
+            if (!output.IsString() || (output.As<Napi::String>().Utf8Value() != "records" && output.As<Napi::String>().Utf8Value() != "objects")) {
+                Napi::TypeError::New(env, "options.output must be 'objects' or 'records'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            runOptions.records = output.As<Napi::String>().Utf8Value() == "records";
+        }
+        if (options.Has("dirtyRects")) {
+            Napi::Value rects = options.Get("dirtyRects");
+            if (!rects.IsArray()) {
+                Napi::TypeError::New(env, "options.dirtyRects must be an array of { x, y, width, height }").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            Napi::Array rectArray = rects.As<Napi::Array>();
+            runOptions.dirtyRects.resize(rectArray.Length());
+            for (uint32_t i = 0; i < rectArray.Length(); ++i) {
+                if (!ParseSearchArea(env, rectArray.Get(i), runOptions.dirtyRects[i])) return env.Null();
+            }
+            runOptions.incremental = true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(plan->cacheMutex);
+        runOptions.run = ++plan->runs;
+        runOptions.overlapped = plan->inFlight++ > 0;
+        if (runOptions.overlapped) runOptions.incremental = false;
+    }
+    return QueueSearch(env, imageBuffer, std::move(plan), std::move(areas), true, std::move(runOptions));
 }
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("findSequencesNative", Napi::Function::New(env, FindSequencesAsync));
     exports.Set("findSequencesNativeBatch", Napi::Function::New(env, FindSequencesAsyncBatch));
+    exports.Set("compileSearchPlan", Napi::Function::New(env, CompileSearchPlanNative));
+    exports.Set("getPlanNames", Napi::Function::New(env, GetPlanNames));
+    exports.Set("runPlan", Napi::Function::New(env, RunPlan));
     return exports;
 }
 
-NODE_API_MODULE(findSequences, Init)
\ No newline at end of file
+NODE_API_MODULE(findSequences, Init)
@@ -5,7 +5,8 @@
       "sources": [ "./src/findTarget.cc" ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
-        "node_modules/node-addon-api"
+        "node_modules/node-addon-api",
+        "../common"
       ],
       "dependencies": [
         "<!(node -p \"require('node-addon-api').gyp\")"
@@ -22,10 +23,8 @@
           "cflags_cc": [
             "-std=c++17",
             "-O3",
-            "-march=native",
-            "-mtune=native",
-            "-mavx2",
-            "-mfma",
+            "-march=x86-64",
+            "-mtune=generic",
             "-funroll-loops",
             "-funroll-all-loops",
             "-fpeel-loops",
@@ -1,6 +1,7 @@
-// fontOcr.cc — AVX2-accelerated color prescan + trigger-map matching (BGRA input).
+// fontOcr.cc — SIMD color prescan + trigger-map matching (BGRA input).
 // - Keeps your working findText path
-// - Fixes recognizeText by reverting to trigger-map logic but accelerates the hot-pixel scan with AVX2
+// - Fixes recognizeText by reverting to trigger-map logic but accelerates the hot-pixel scan
+//   with the pixelKernels.h color match (widest ISA the CPU has, picked at runtime)
 // - Uses packed 32-bit loads and avoids per-pixel tuple loops for color checks
 
 #include <napi.h>
@@ -19,7 +20,8 @@
 #include <sstream>
 #include <unordered_set>
 #include <set>
-#include <immintrin.h>
+
+#include "pixelKernels.h"
 
 #include "ocr_structs.h"
 #include "font_atlas_data.h"
@@ -37,7 +39,7 @@ static inline uint32_t PackBGRA(uint8_t r, uint8_t g, uint8_t b) {
 // --- Fast color set built from valid font colors (in packed ARGB/BGRA) ---
 struct ColorSet {
     std::unordered_set<uint32_t> S;
-    std::vector<__m256i> v; // AVX2 broadcast constants for prescan
+    std::vector<uint32_t> v; // Packed colors for the prescan kernel
 
     void build(const std::vector<std::tuple<uint8_t,uint8_t,uint8_t>>& colors) {
         S.clear(); v.clear();
@@ -47,7 +49,7 @@ struct ColorSet {
             uint8_t r = std::get<0>(t), g = std::get<1>(t), b = std::get<2>(t);
             uint32_t packed = PackBGRA(r,g,b);
             S.insert(packed);
-            v.push_back(_mm256_set1_epi32((int)packed));
+            v.push_back(packed);
         }
     }
     inline bool has(uint32_t packed) const {
@@ -116,12 +118,12 @@ Napi::Value RecognizeText(const Napi::CallbackInfo& info);
 Napi::Value FindText(const Napi::CallbackInfo& info);
 
 // =====================================================================================
-// AVX2-accelerated RecognizeText implementation (fixes earlier non-working version)
-// - AVX2 prescan to locate candidate pixels with any valid font color
+// Prescan-accelerated RecognizeText implementation (fixes earlier non-working version)
+// - Vector prescan to locate candidate pixels with any valid font color
 // - Trigger-map verification against templates using fast packed 32-bit compares
 // =====================================================================================
 
-static std::vector<FoundChar> RecognizeText_PrescanAVX2(
+static std::vector<FoundChar> RecognizeText_Prescan(
     const uint8_t* __restrict screen_data, uint32_t screen_width, uint32_t screen_height,
     uint32_t roi_x, uint32_t roi_y, uint32_t roi_w, uint32_t roi_h,
     const std::vector<std::tuple<uint8_t,uint8_t,uint8_t>>& valid_colors,
@@ -132,7 +134,7 @@ static std::vector<FoundChar> RecognizeText_PrescanAVX2(
         return allowed_chars.empty() || (allowed_chars.find(c) != std::string::npos);
     };
 
-    // Build packed valid color set + AVX constants
+    // Build packed valid color set for the prescan
     ColorSet colorSet;
     colorSet.build(valid_colors);
 
@@ -144,115 +146,38 @@ static std::vector<FoundChar> RecognizeText_PrescanAVX2(
 
     const size_t strideBytes = (size_t)screen_width * 4u;
 
-    // Scan each row in ROI: AVX2 compare 8 pixels (8 * 4 bytes = 32B) per load
+    const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+    std::vector<uint64_t> hot((roi_w + 63) / 64);
+
+    // Scan each row in ROI: one kernel call marks every pixel with a valid color
     for (uint32_t dy = 0; dy < roi_h; ++dy) {
         const uint32_t y = roi_y + dy;
         const uint8_t* rowPtr = screen_data + (size_t)y * strideBytes + (size_t)roi_x * 4u;
 
-        uint32_t dx = 0;
+        kernels.matchColors(rowPtr, roi_w, colorSet.v.data(), (uint32_t)colorSet.v.size(), 0xFFFFFFFFu, hot.data());
+        pixel_kernels::ForEachBit(hot.data(), roi_w, [&](uint32_t local_x) {
+            if (consumed[dy * roi_w + local_x]) return;
 
-        // Vector body (process 8 pixels at a time)
-        for (; dx + 8 <= roi_w; dx += 8) {
-            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowPtr + (size_t)dx * 4u));
-
-            // Compare against all valid colors, OR masks together
-            __m256i acc = _mm256_setzero_si256();
-            for (const __m256i& colVec : colorSet.v) {
-                __m256i m = _mm256_cmpeq_epi32(chunk, colVec);
-                acc = _mm256_or_si256(acc, m);
-            }
-
-            int bitmask = _mm256_movemask_ps(_mm256_castsi256_ps(acc)); // one bit per 32-bit lane
-            while (bitmask) {
-                int lane = __builtin_ctz((unsigned)bitmask);
-                bitmask &= bitmask - 1;
-
-                uint32_t x = roi_x + dx + (uint32_t)lane;
-                uint32_t local_x = dx + (uint32_t)lane;
-                if (consumed[dy * roi_w + local_x]) continue;
-
-                // Reference color for this hot pixel (we use it for foreground equality)
-                uint32_t refPacked = *reinterpret_cast<const uint32_t*>(
-                    screen_data + (size_t)y * strideBytes + (size_t)x * 4u);
-
-                // Try all trigger offsets; compute potential top-left and test templates
-                std::vector<FoundChar> candidates;
-                for (const auto& kv : triggerMap) {
-                    const Point& off = kv.first;
-                    int potential_cx = int(local_x) - off.first;
-                    int potential_cy = int(dy) - off.second;
-                    if (potential_cx < 0 || potential_cy < 0) continue;
-
-                    // Bounds check inside ROI (glyph must fully fit)
-                    for (const CharTemplate* tplPtr : kv.second) {
-                        const CharTemplate& tpl = *tplPtr;
-                        if (!allowed(tpl.character)) continue;
-
-                        if ((uint32_t)potential_cx + tpl.width  > roi_w) continue;
-                        if ((uint32_t)potential_cy + tpl.height > roi_h) continue;
-
-                        // Absolute coords of top-left (match origin)
-                        uint32_t mx = roi_x + (uint32_t)potential_cx;
-                        uint32_t my = roi_y + (uint32_t)potential_cy;
-
-                        if (FinalMatchTestFast(screen_data, screen_width, mx, my, tpl, refPacked, colorSet)) {
-                            candidates.emplace_back(tpl.character,
-                                                    (uint32_t)mx, (uint32_t)my,
-                                                    tpl.width, tpl.height, tpl.offset,
-                                                    (uint8_t)((refPacked >> 16) & 0xFF),
-                                                    (uint8_t)((refPacked >> 8) & 0xFF),
-                                                    (uint8_t)(refPacked & 0xFF));
-                        }
-                    }
-                }
-
-                if (!candidates.empty()) {
-                    // Prefer the largest area (as in your original)
-                    auto best_it = std::max_element(
-                        candidates.begin(), candidates.end(),
-                        [](const FoundChar& a, const FoundChar& b) {
-                            return (a.width * a.height) < (b.width * b.height);
-                        }
-                    );
-                    const FoundChar& best = *best_it;
-                    final_chars.push_back(best);
-
-                    // Mark consumed region in local ROI space
-                    uint32_t lx = best.x - roi_x, ly = best.y - roi_y;
-                    for (uint32_t yy = 0; yy < best.height; ++yy) {
-                        uint32_t base = (ly + yy) * roi_w + lx;
-                        for (uint32_t xx = 0; xx < best.width; ++xx) {
-                            consumed[base + xx] = 1;
-                        }
-                    }
-                }
-            }
-        }
-
-        // Tail scalar loop
-        for (; dx < roi_w; ++dx) {
-            if (consumed[dy * roi_w + dx]) continue;
-
-            const uint8_t* pixPtr = rowPtr + (size_t)dx * 4u;
-            uint32_t packed = *reinterpret_cast<const uint32_t*>(pixPtr);
-            if (!colorSet.has(packed)) continue;
-
-            uint32_t x = roi_x + dx;
-            uint32_t refPacked = packed;
+            // Reference color for this hot pixel (we use it for foreground equality)
+            uint32_t refPacked = *reinterpret_cast<const uint32_t*>(rowPtr + (size_t)local_x * 4u);
 
+            // Try all trigger offsets; compute potential top-left and test templates
             std::vector<FoundChar> candidates;
             for (const auto& kv : triggerMap) {
                 const Point& off = kv.first;
-                int potential_cx = int(dx) - off.first;
+                int potential_cx = int(local_x) - off.first;
                 int potential_cy = int(dy) - off.second;
                 if (potential_cx < 0 || potential_cy < 0) continue;
 
+                // Bounds check inside ROI (glyph must fully fit)
                 for (const CharTemplate* tplPtr : kv.second) {
                     const CharTemplate& tpl = *tplPtr;
                     if (!allowed(tpl.character)) continue;
+
                     if ((uint32_t)potential_cx + tpl.width  > roi_w) continue;
                     if ((uint32_t)potential_cy + tpl.height > roi_h) continue;
 
+                    // Absolute coords of top-left (match origin)
                     uint32_t mx = roi_x + (uint32_t)potential_cx;
                     uint32_t my = roi_y + (uint32_t)potential_cy;
 
@@ -268,6 +193,7 @@ static std::vector<FoundChar> RecognizeText_PrescanAVX2(
             }
 
             if (!candidates.empty()) {
+                // Prefer the largest area (as in your original)
                 const FoundChar& best = *std::max_element(
                     candidates.begin(), candidates.end(),
                     [](const FoundChar& a, const FoundChar& b) {
@@ -275,6 +201,8 @@ static std::vector<FoundChar> RecognizeText_PrescanAVX2(
                     }
                 );
                 final_chars.push_back(best);
+
+                // Mark consumed region in local ROI space
                 uint32_t lx = best.x - roi_x, ly = best.y - roi_y;
                 for (uint32_t yy = 0; yy < best.height; ++yy) {
                     uint32_t base = (ly + yy) * roi_w + lx;
@@ -283,7 +211,7 @@ static std::vector<FoundChar> RecognizeText_PrescanAVX2(
                     }
                 }
             }
-        }
+        });
     }
 
     return final_chars;
@@ -334,7 +262,7 @@ Napi::Value RecognizeText(const Napi::CallbackInfo& info) {
         valid_colors.emplace_back(r,g,b);
     }
 
-    std::vector<FoundChar> final_chars = RecognizeText_PrescanAVX2(
+    std::vector<FoundChar> final_chars = RecognizeText_Prescan(
         screen_data, screen_width, screen_height,
         roi_x, roi_y, safe_w, safe_h,
         valid_colors, allowed_chars
@@ -532,10 +460,10 @@ Napi::Value FindText(const Napi::CallbackInfo& info) {
     std::sort(words_to_find.begin(), words_to_find.end(),
               [](const std::string& a, const std::string& b){ return a.length() > b.length(); });
 
-    std::vector<__m256i> avx_valid_colors;
-    avx_valid_colors.reserve(valid_colors.size());
+    std::vector<uint32_t> packed_valid_colors;
+    packed_valid_colors.reserve(valid_colors.size());
     for (const auto& c : valid_colors) {
-        avx_valid_colors.push_back(_mm256_set1_epi32((int)PackBGRA(std::get<0>(c), std::get<1>(c), std::get<2>(c))));
+        packed_valid_colors.push_back(PackBGRA(std::get<0>(c), std::get<1>(c), std::get<2>(c)));
     }
 
     std::vector<FoundWord> final_words;
@@ -544,18 +472,18 @@ Napi::Value FindText(const Napi::CallbackInfo& info) {
     const uint32_t CELL_SIZE = 16;
     std::set<std::pair<uint32_t,uint32_t>> hot_cells;
 
-    // Pass 1: AVX2 prescan to mark hot cells
+    // Pass 1: vector prescan to mark hot cells
+    const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+    std::vector<uint64_t> hot((roi_w + 63) / 64);
     for (uint32_t y = 0; y < roi_h; ++y) {
         const uint8_t* row_ptr = screen_data + ((roi_y + y) * screen_width + roi_x) * 4u;
-        for (uint32_t x = 0; x + 8 <= roi_w; x += 8) {
-            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_ptr + (size_t)x * 4u));
-            __m256i acc = _mm256_setzero_si256();
-            for (const auto& col : avx_valid_colors)
-                acc = _mm256_or_si256(acc, _mm256_cmpeq_epi32(chunk, col));
-            if (_mm256_testz_si256(acc, acc) == 0) {
-                hot_cells.insert({x / CELL_SIZE, y / CELL_SIZE});
-            }
-        }
+        kernels.matchColors(row_ptr, roi_w, packed_valid_colors.data(), (uint32_t)packed_valid_colors.size(), 0xFFFFFFFFu, hot.data());
+        uint32_t last_cell = UINT32_MAX;
+        pixel_kernels::ForEachBit(hot.data(), roi_w, [&](uint32_t x) {
+            if (x / CELL_SIZE == last_cell) return;
+            last_cell = x / CELL_SIZE;
+            hot_cells.insert({last_cell, y / CELL_SIZE});
+        });
     }
 
     // Pass 2: targeted scan of hot cells (scalar verification for words)
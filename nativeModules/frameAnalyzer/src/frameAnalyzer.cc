@@ -0,0 +1,676 @@
+// frameAnalyzer.cc – Runs several vision detectors over a frame in one tiled pass.
+//
+// creatureMonitor used to call findHealthBars, findTarget, findSequences and
+// the OCR prescan one after another on the same game-world frame, each one
+// streaming the whole region through memory again. analyzeFrame takes every
+// detector's configuration in one call and walks the frame once:
+//
+//   - The union of the detectors' rows is cut into TILE_ROWS-row tiles,
+//     handed to the shared thread pool.
+//   - Inside a tile every row is loaded once and fed to each detector whose
+//     area covers it while it is still in L1: health bar black-pixel bitmaps,
+//     target border pixels, sequence first colours, OCR font-colour pixels.
+//   - Per-slot results are merged at the end, and the serial steps (bar
+//     clustering, target rect inference) run on the merged sets.
+//   - With a bar tracker and the dirty rects since its previous frame,
+//     health bars leave the tiled pass: the tracker's untouched bars are
+//     reused and only bar positions near the dirty rects are scanned.
+//
+// The detectors are the same code the standalone addons use (common/), so
+// results match what findHealthBars, findTarget and findSequencesNative
+// return for the same frame and areas.
+
+#include <napi.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <optional>
+
+#include "healthBarScan.h"
+#include "pixelKernels.h"
+#include "sequenceConfig.h"
+#include "sequenceMatcher.h"
+#include "targetScan.h"
+#include "threadPool.h"
+
+using health_bars::FoundHealthBar;
+using sequence_matcher::CompiledSequence;
+using sequence_matcher::SequenceMatcher;
+using target_scan::Point;
+
+// ---------- Constants ----------
+// Rows per tile: a 1000-pixel game-world row is 4 KB, so a tile stays in L2
+// and the row being worked on in L1.
+const uint32_t TILE_ROWS = 16;
+// The OCR prescan reports font-colour pixels per OCR_CELL_SIZE square cell.
+const uint32_t OCR_CELL_SIZE = 8;
+// Tiles start on OCR cell rows, so no two tiles write the same cell.
+static_assert(TILE_ROWS % OCR_CELL_SIZE == 0, "tiles must cover whole OCR cell rows");
+// Work items: about CHUNKS_PER_THREAD runs of tiles per pool thread.
+const unsigned CHUNKS_PER_THREAD = 4;
+// Dirty bar starts covering more than this share of the health bar area are
+// scanned by the tiled pass instead.
+const double MAX_DIRTY_BAR_SHARE = 0.5;
+
+// ---------- Structures ----------
+struct Area {
+    uint32_t x = 0, y = 0, width = 0, height = 0;
+    bool active = false;
+    bool HasRow(uint32_t r) const { return active && r >= y && r < y + height; }
+};
+
+struct Frame {
+    const uint8_t* bgraData;
+    uint32_t width, height, stride;
+};
+
+using health_bars::TrackerHandle;
+
+static const napi_type_tag TRACKER_TYPE_TAG = { health_bars::TRACKER_TYPE_TAG_LOWER, health_bars::TRACKER_TYPE_TAG_UPPER };
+
+// Everything parsed from the detectors object. Areas are clipped to the frame;
+// a detector whose area is empty (or too small for a bar) is inactive.
+struct Detectors {
+    Area healthBars, target, sequences, ocr;
+    bool hasHealthBars = false, hasTarget = false, hasSequences = false, hasOcr = false;  // Registered
+    TrackerHandle* barTracker = nullptr;  // healthBars.tracker, if given
+    uint32_t trackerCall = 0;             // This call's number on barTracker
+    bool barRecords = false;              // healthBars.output is 'records'
+    bool hasBarDirtyRects = false;        // healthBars.dirtyRects given
+    std::vector<health_bars::Rect> barDirtyRects;
+    // Incremental bar scan: the tracker's unchanged bars are reused and only
+    // barStarts are scanned, outside the tiled pass.
+    bool barsIncremental = false;
+    std::vector<FoundHealthBar> cleanBars;
+    std::vector<health_bars::Rect> barStarts;
+    SequenceMatcher matcher;
+    std::vector<std::string> sequenceNames;
+    std::vector<uint32_t> ocrColors;  // Packed BGRA with alpha 0xFF, as fontOcr matches them
+    uint32_t ocrColumns = 0, ocrRows = 0;
+};
+
+struct SequenceHit {
+    int x = 0, y = 0;
+    size_t pixelIndex = static_cast<size_t>(-1);  // Row-major start pixel; lowest wins
+};
+
+// One pool slot's results, merged after the pass.
+struct SlotResults {
+    std::vector<FoundHealthBar> bars;
+    std::vector<Point> targetPixels;
+    std::vector<std::pair<SequenceHit, SequenceHit>> sequences;  // (primary, backup) per name
+};
+
+// The merged results of a pass, ready to hand to JS.
+struct PassResults {
+    uint32_t frameWidth = 0, frameHeight = 0;
+    std::vector<FoundHealthBar> bars;           // Clustered
+    bool targetFound = false;
+    target_scan::TargetRect target = {0, 0, 0, 0};
+    std::vector<SequenceHit> sequences;         // First hit per name; pixelIndex -1 if none
+    std::vector<uint8_t> ocrCells;
+};
+
+// ---------- Parsing ----------
+bool ParseArea(Napi::Env env, const Napi::Object& detector, const char* name, const Frame& frame, Area& area) {
+    Napi::Value value = detector.Get("area");
+    if (!value.IsObject()) {
+        Napi::TypeError::New(env, std::string(name) + ".area must be an object { x, y, width, height }").ThrowAsJavaScriptException();
+        return false;
+    }
+    Napi::Object areaObj = value.As<Napi::Object>();
+    area.x = areaObj.Get("x").As<Napi::Number>().Uint32Value();
+    area.y = areaObj.Get("y").As<Napi::Number>().Uint32Value();
+    area.width = areaObj.Get("width").As<Napi::Number>().Uint32Value();
+    area.height = areaObj.Get("height").As<Napi::Number>().Uint32Value();
+    if (area.x >= frame.width || area.y >= frame.height) {
+        area.width = area.height = 0;
+        return true;
+    }
+    area.width = std::min(area.width, frame.width - area.x);
+    area.height = std::min(area.height, frame.height - area.y);
+    area.active = area.width > 0 && area.height > 0;
+    return true;
+}
+
+// Reads an array of { x, y, width, height }, clipped to the frame; rects off
+// the frame are dropped.
+bool ParseRects(Napi::Env env, const Napi::Value& value, const char* name, const Frame& frame, std::vector<health_bars::Rect>& out) {
+    if (!value.IsArray()) {
+        Napi::TypeError::New(env, std::string(name) + " must be an array of { x, y, width, height }").ThrowAsJavaScriptException();
+        return false;
+    }
+    Napi::Array jsRects = value.As<Napi::Array>();
+    out.reserve(jsRects.Length());
+    for (uint32_t i = 0; i < jsRects.Length(); ++i) {
+        Napi::Value v = jsRects.Get(i);
+        if (!v.IsObject()) continue;
+        Napi::Object r = v.As<Napi::Object>();
+        int64_t x0 = std::max<int64_t>(r.Get("x").As<Napi::Number>().Int64Value(), 0);
+        int64_t y0 = std::max<int64_t>(r.Get("y").As<Napi::Number>().Int64Value(), 0);
+        int64_t x1 = std::min<int64_t>(r.Get("x").As<Napi::Number>().Int64Value() + r.Get("width").As<Napi::Number>().Int64Value(), frame.width);
+        int64_t y1 = std::min<int64_t>(r.Get("y").As<Napi::Number>().Int64Value() + r.Get("height").As<Napi::Number>().Int64Value(), frame.height);
+        if (x0 >= x1 || y0 >= y1) continue;
+        out.push_back({ static_cast<uint32_t>(x0), static_cast<uint32_t>(y0),
+                        static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0) });
+    }
+    return true;
+}
+
+// Whether detector `key` is registered; if so, out is its config object.
+bool GetDetector(Napi::Env env, const Napi::Object& detectors, const char* key, Napi::Object& out) {
+    if (!detectors.Has(key) || detectors.Get(key).IsUndefined() || detectors.Get(key).IsNull()) return false;
+    if (!detectors.Get(key).IsObject()) {
+        Napi::TypeError::New(env, std::string(key) + " must be an object").ThrowAsJavaScriptException();
+        return false;
+    }
+    out = detectors.Get(key).As<Napi::Object>();
+    return true;
+}
+
+// Fills det from the JS detectors object. On failure a JS exception is pending.
+bool ParseDetectors(Napi::Env env, const Napi::Object& jsDetectors, const Frame& frame, Detectors& det) {
+    Napi::Object cfg;
+    if (GetDetector(env, jsDetectors, "healthBars", cfg)) {
+        if (!ParseArea(env, cfg, "healthBars", frame, det.healthBars)) return false;
+        // A bar is 31x4 and needs one pixel to its right, like findHealthBars.
+        if (det.healthBars.width < health_bars::BAR_WIDTH + 1 || det.healthBars.height < health_bars::BAR_HEIGHT) det.healthBars.active = false;
+        if (cfg.Has("tracker") && !cfg.Get("tracker").IsUndefined()) {
+            Napi::Value tracker = cfg.Get("tracker");
+            if (!tracker.IsExternal() || !tracker.As<Napi::External<TrackerHandle>>().CheckTypeTag(&TRACKER_TYPE_TAG)) {
+                Napi::TypeError::New(env, "healthBars.tracker must come from createHealthBarTracker").ThrowAsJavaScriptException();
+                return false;
+            }
+            det.barTracker = tracker.As<Napi::External<TrackerHandle>>().Data();
+        }
+        if (cfg.Has("output") && !cfg.Get("output").IsUndefined()) {
+            Napi::Value output = cfg.Get("output");
+            std::string mode = output.IsString() ? output.As<Napi::String>().Utf8Value() : "";
+            if (mode != "objects" && mode != "records") {
+                Napi::TypeError::New(env, "healthBars.output must be 'objects' or 'records'").ThrowAsJavaScriptException();
+                return false;
+            }
+            det.barRecords = mode == "records";
+        }
+        if (cfg.Has("dirtyRects") && !cfg.Get("dirtyRects").IsUndefined()) {
+            if (!ParseRects(env, cfg.Get("dirtyRects"), "healthBars.dirtyRects", frame, det.barDirtyRects)) return false;
+            det.hasBarDirtyRects = true;
+        }
+        det.hasHealthBars = true;
+    }
+    if (env.IsExceptionPending()) return false;
+
+    if (GetDetector(env, jsDetectors, "target", cfg)) {
+        if (!ParseArea(env, cfg, "target", frame, det.target)) return false;
+        det.hasTarget = true;
+    }
+    if (env.IsExceptionPending()) return false;
+
+    if (GetDetector(env, jsDetectors, "sequences", cfg)) {
+        if (!ParseArea(env, cfg, "sequences", frame, det.sequences)) return false;
+        if (!cfg.Get("sequences").IsObject()) {
+            Napi::TypeError::New(env, "sequences.sequences must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+        std::vector<sequence_config::SequenceDefinition> defs;
+        if (!sequence_config::ParseTargetSequences(env, cfg.Get("sequences").As<Napi::Object>(), defs, det.sequenceNames)) {
+            Napi::TypeError::New(env, "Invalid sequences configuration").ThrowAsJavaScriptException();
+            return false;
+        }
+        for (const auto& def : defs) {
+            det.matcher.Add({0, def.targetIndex, def.horizontal, def.primary, def.offsetX, def.offsetY, 0, 0, def.tolerance}, def.sequenceHashes);
+        }
+        det.matcher.Build();
+        if (det.matcher.Empty()) det.sequences.active = false;
+        det.hasSequences = true;
+    }
+    if (env.IsExceptionPending()) return false;
+
+    if (GetDetector(env, jsDetectors, "ocr", cfg)) {
+        if (!ParseArea(env, cfg, "ocr", frame, det.ocr)) return false;
+        if (!cfg.Get("colors").IsArray()) {
+            Napi::TypeError::New(env, "ocr.colors must be an array of [r, g, b]").ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Array colors = cfg.Get("colors").As<Napi::Array>();
+        for (uint32_t i = 0; i < colors.Length(); ++i) {
+            Napi::Value c = colors.Get(i);
+            if (!c.IsArray() || c.As<Napi::Array>().Length() != 3) {
+                Napi::TypeError::New(env, "ocr.colors must be an array of [r, g, b]").ThrowAsJavaScriptException();
+                return false;
+            }
+            Napi::Array rgb = c.As<Napi::Array>();
+            uint32_t r = rgb.Get(0u).As<Napi::Number>().Uint32Value() & 0xFF;
+            uint32_t g = rgb.Get(1u).As<Napi::Number>().Uint32Value() & 0xFF;
+            uint32_t b = rgb.Get(2u).As<Napi::Number>().Uint32Value() & 0xFF;
+            det.ocrColors.push_back((0xFFu << 24) | (r << 16) | (g << 8) | b);
+        }
+        if (det.ocrColors.empty()) det.ocr.active = false;
+        det.ocrColumns = (det.ocr.width + OCR_CELL_SIZE - 1) / OCR_CELL_SIZE;
+        det.ocrRows = (det.ocr.height + OCR_CELL_SIZE - 1) / OCR_CELL_SIZE;
+        det.hasOcr = true;
+    }
+    return !env.IsExceptionPending();
+}
+
+// Starts this call on the bar tracker, if any. Runs on the JS thread once the
+// detectors are parsed; every started call must end in FinishTrackerCall or
+// AbortTrackerCall. The bar scan goes incremental when the tracker holds the
+// previous frame of the same size and area and no other call on it is in
+// flight: then dirtyRects are exactly what changed since that frame.
+void StartTrackerCall(const Frame& frame, Detectors& det) {
+    TrackerHandle* handle = det.barTracker;
+    if (!handle) return;
+    det.trackerCall = ++handle->calls;
+    const Area& a = det.healthBars;
+    const health_bars::Rect area = {a.x, a.y, a.width, a.height};
+    bool idle = handle->inFlight++ == 0;
+    if (!idle || !det.hasBarDirtyRects || !a.active || !handle->tracker.HasHistory(frame.width, frame.height, area)) return;
+
+    std::vector<health_bars::Rect> starts;
+    uint64_t startCount = 0;
+    health_bars::Rect s;
+    for (const health_bars::Rect& dirty : det.barDirtyRects) {
+        if (!health_bars::DirtyStarts(dirty, area, s)) continue;
+        starts.push_back(s);
+        startCount += static_cast<uint64_t>(s.width) * s.height;
+    }
+    if (startCount > MAX_DIRTY_BAR_SHARE * a.width * a.height) return;
+    det.barsIncremental = true;
+    det.cleanBars = handle->tracker.CleanBars(det.barDirtyRects);
+    det.barStarts = std::move(starts);
+}
+
+// Ids the bars and, when this is the tracker's newest call, keeps them as its
+// previous frame. JS thread only.
+void FinishTrackerCall(const Detectors& det, uint32_t frameWidth, uint32_t frameHeight, std::vector<FoundHealthBar>& bars) {
+    TrackerHandle* handle = det.barTracker;
+    if (!handle) return;
+    --handle->inFlight;
+    const Area& a = det.healthBars;
+    handle->tracker.Update(bars, frameWidth, frameHeight, health_bars::Rect{a.x, a.y, a.width, a.height});
+    if (det.trackerCall != handle->calls) handle->tracker.ForgetHistory();
+}
+
+// A call failed: the caller's next dirtyRects start from a frame the tracker
+// never saw.
+void ForgetTrackerHistory(const Detectors& det) {
+    if (det.barTracker) det.barTracker->tracker.ForgetHistory();
+}
+void AbortTrackerCall(const Detectors& det) {
+    if (!det.barTracker) return;
+    --det.barTracker->inFlight;
+    ForgetTrackerHistory(det);
+}
+
+// ---------- The pass ----------
+// Visits rows [y0, y1) for every detector. Health bars starting on those rows
+// also read the three rows below, so the loop runs up to three rows past y1.
+void AnalyzeRows(const Frame& frame, const Detectors& det, uint32_t y0, uint32_t y1,
+                 SlotResults& out, std::vector<uint8_t>& ocrCells) {
+    const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+    const uint32_t maxSpan = std::max({det.target.active ? det.target.width : 0, det.ocr.active ? det.ocr.width : 0, 1u});
+    std::vector<uint64_t> hits((maxSpan + 63) / 64);
+
+    std::optional<health_bars::BarScanner> bars;
+    uint32_t barY0 = 0, barY1 = 0;  // Bar top rows handled here
+    if (det.healthBars.active && !det.barsIncremental && frame.height >= health_bars::BAR_HEIGHT) {
+        barY0 = std::max(y0, det.healthBars.y);
+        barY1 = std::min({y1, det.healthBars.y + det.healthBars.height, frame.height - (health_bars::BAR_HEIGHT - 1)});
+        if (barY0 < barY1) bars.emplace(det.healthBars.x, det.healthBars.width);
+    }
+    const uint32_t rowEnd = bars ? std::max(y1, barY1 + health_bars::BAR_HEIGHT - 1) : y1;
+
+    for (uint32_t r = y0; r < rowEnd; ++r) {
+        const uint8_t* row = frame.bgraData + static_cast<size_t>(r) * frame.stride;
+        if (r < y1) {
+            if (det.target.HasRow(r)) {
+                const Area& a = det.target;
+                kernels.matchColors(row + a.x * 4, a.width, target_scan::TARGET_COLORS, 2, 0x00FFFFFF, hits.data());
+                pixel_kernels::ForEachBit(hits.data(), a.width, [&](uint32_t i) { out.targetPixels.push_back({a.x + i, r}); });
+            }
+            if (det.sequences.HasRow(r)) {
+                const Area& a = det.sequences;
+                det.matcher.ScanRow(row, a.x, a.x + a.width, [&](const CompiledSequence& seq, uint32_t x) {
+                    if (!det.matcher.Matches(frame.bgraData, frame.width, frame.height, frame.stride, seq, x, r)) return;
+                    size_t pixelIndex = static_cast<size_t>(r) * frame.width + x;
+                    SequenceHit& hit = seq.primary ? out.sequences[seq.slot].first : out.sequences[seq.slot].second;
+                    if (pixelIndex < hit.pixelIndex) hit = {static_cast<int>(x) + seq.offsetX, static_cast<int>(r) + seq.offsetY, pixelIndex};
+                });
+            }
+            if (det.ocr.HasRow(r)) {
+                const Area& a = det.ocr;
+                uint8_t* cells = ocrCells.data() + ((r - a.y) / OCR_CELL_SIZE) * det.ocrColumns;
+                kernels.matchColors(row + a.x * 4, a.width, det.ocrColors.data(), static_cast<uint32_t>(det.ocrColors.size()), 0xFFFFFFFF, hits.data());
+                pixel_kernels::ForEachBit(hits.data(), a.width, [&](uint32_t i) { cells[i / OCR_CELL_SIZE] = 1; });
+            }
+        }
+        if (bars && r >= barY0 && r < barY1 + health_bars::BAR_HEIGHT - 1) {
+            bars->AddRow(frame.bgraData, frame.stride, r);
+            if (r >= barY0 + health_bars::BAR_HEIGHT - 1) bars->FindBars(frame.bgraData, frame.stride, r - (health_bars::BAR_HEIGHT - 1), out.bars);
+        }
+    }
+}
+
+// Appends the bars starting in `starts` (see health_bars::DirtyStarts).
+void ScanBarStarts(const Frame& frame, const health_bars::Rect& starts, std::vector<FoundHealthBar>& out) {
+    if (frame.height < health_bars::BAR_HEIGHT) return;
+    const uint32_t y1 = std::min(starts.y + starts.height, frame.height - (health_bars::BAR_HEIGHT - 1));
+    if (starts.y >= y1) return;
+    health_bars::BarScanner scanner(starts.x, starts.width + health_bars::BAR_WIDTH);
+    for (uint32_t r = starts.y; r < y1 + health_bars::BAR_HEIGHT - 1; ++r) {
+        scanner.AddRow(frame.bgraData, frame.stride, r);
+        if (r >= starts.y + health_bars::BAR_HEIGHT - 1) scanner.FindBars(frame.bgraData, frame.stride, r - (health_bars::BAR_HEIGHT - 1), out);
+    }
+}
+
+// Runs every active detector over the frame: one result set per pool slot,
+// plus the OCR cell grid.
+void RunTiles(const Frame& frame, const Detectors& det, std::vector<SlotResults>& slots, std::vector<uint8_t>& ocrCells) {
+    // Rows the pass starts on: the union of the active detectors' rows.
+    uint32_t unionY0 = UINT32_MAX, unionY1 = 0;
+    const Area* areas[] = {&det.healthBars, &det.target, &det.sequences, &det.ocr};
+    for (const Area* a : areas) {
+        if (!a->active || (a == &det.healthBars && det.barsIncremental)) continue;
+        unionY0 = std::min(unionY0, a->y);
+        unionY1 = std::max(unionY1, a->y + a->height);
+    }
+    // Tile t covers rows [unionY0 + t * TILE_ROWS - lead, + TILE_ROWS), clipped
+    // to the union; lead puts tile edges on OCR cell rows when OCR is active.
+    uint32_t lead = det.ocr.active ? (TILE_ROWS - (det.ocr.y - unionY0) % TILE_ROWS) % TILE_ROWS : 0;
+
+    vision_pool::ThreadPool& pool = vision_pool::ThreadPool::Instance();
+    slots.assign(pool.Slots(), SlotResults());
+    for (SlotResults& s : slots) s.sequences.resize(det.sequenceNames.size());
+    ocrCells.assign(static_cast<size_t>(det.ocrColumns) * det.ocrRows, 0);
+
+    if (unionY0 < unionY1) {
+        uint32_t tiles = (unionY1 - unionY0 + lead + TILE_ROWS - 1) / TILE_ROWS;
+        uint32_t grain = std::max(1u, tiles / (pool.Slots() * CHUNKS_PER_THREAD));
+        // A chunk is a run of adjacent tiles, walked as one row range so
+        // bar bitmaps carry over between its tiles.
+        pool.ParallelFor(0, tiles, grain, [&](uint32_t begin, uint32_t end, unsigned slot) {
+            uint32_t y0 = unionY0 + (begin * TILE_ROWS > lead ? begin * TILE_ROWS - lead : 0);
+            uint32_t y1 = std::min(unionY1, unionY0 + end * TILE_ROWS - lead);
+            if (y0 < y1) AnalyzeRows(frame, det, y0, y1, slots[slot], ocrCells);
+        });
+    }
+    if (det.barsIncremental && !det.barStarts.empty()) {
+        pool.ParallelFor(0, static_cast<uint32_t>(det.barStarts.size()), 1, [&](uint32_t begin, uint32_t end, unsigned slot) {
+            for (uint32_t i = begin; i < end; ++i) ScanBarStarts(frame, det.barStarts[i], slots[slot].bars);
+        });
+    }
+}
+
+// The pass and the serial steps on its merged results: bar clustering,
+// target rect inference, the first hit per sequence name. No JS involved, so
+// it runs off the JS thread for analyzeFrameAsync.
+void RunPass(const Frame& frame, const Detectors& det, PassResults& results) {
+    std::vector<SlotResults> slots;
+    RunTiles(frame, det, slots, results.ocrCells);
+    results.frameWidth = frame.width;
+    results.frameHeight = frame.height;
+
+    if (det.hasHealthBars) {
+        std::vector<FoundHealthBar> found;
+        for (SlotResults& s : slots) found.insert(found.end(), s.bars.begin(), s.bars.end());
+        results.bars = det.cleanBars;
+        std::vector<FoundHealthBar> merged = health_bars::ClusterBars(found);
+        results.bars.insert(results.bars.end(), merged.begin(), merged.end());
+    }
+
+    if (det.hasTarget) {
+        std::vector<Point> pixels;
+        for (SlotResults& s : slots) pixels.insert(pixels.end(), s.targetPixels.begin(), s.targetPixels.end());
+        const Area& a = det.target;
+        results.targetFound = !pixels.empty() &&
+            target_scan::InferTargetRect(pixels, frame.bgraData, frame.width, frame.height, frame.stride,
+                                         a.x, a.y, a.width, a.height, results.target);
+    }
+
+    if (det.hasSequences) {
+        results.sequences.resize(det.sequenceNames.size());
+        for (uint32_t t = 0; t < det.sequenceNames.size(); ++t) {
+            SequenceHit primary, backup;
+            for (const SlotResults& s : slots) {
+                if (s.sequences[t].first.pixelIndex < primary.pixelIndex) primary = s.sequences[t].first;
+                if (s.sequences[t].second.pixelIndex < backup.pixelIndex) backup = s.sequences[t].second;
+            }
+            results.sequences[t] = primary.pixelIndex != static_cast<size_t>(-1) ? primary : backup;
+        }
+    }
+}
+
+// ---------- NAPI ----------
+// Builds the JS result. Runs on the JS thread, so this is also where the bar
+// tracker (owned by JS) is updated.
+Napi::Object ResultsToJs(Napi::Env env, const Detectors& det, PassResults& results) {
+    Napi::Object result = Napi::Object::New(env);
+
+    if (det.hasHealthBars) {
+        std::vector<FoundHealthBar>& bars = results.bars;
+        FinishTrackerCall(det, results.frameWidth, results.frameHeight, bars);
+        if (det.barRecords) {
+            Napi::Int32Array records = Napi::Int32Array::New(env, bars.size() * health_bars::RECORD_FIELDS);
+            health_bars::WriteRecords(bars, records.Data(), bars.size());
+            result.Set("healthBars", records);
+        } else {
+            Napi::Array out = Napi::Array::New(env, bars.size());
+            for (size_t i = 0; i < bars.size(); ++i) {
+                Napi::Object obj = Napi::Object::New(env);
+                obj.Set("x", bars[i].x);
+                obj.Set("y", bars[i].y);
+                obj.Set("healthTag", Napi::String::New(env, health_bars::HealthTagName(bars[i].healthClass)));
+                obj.Set("hpPercent", bars[i].hpPercent);
+                if (bars[i].id != 0) obj.Set("id", bars[i].id);
+                out[i] = obj;
+            }
+            result.Set("healthBars", out);
+        }
+    }
+
+    if (det.hasTarget) {
+        if (results.targetFound) {
+            const target_scan::TargetRect& rect = results.target;
+            Napi::Object obj = Napi::Object::New(env);
+            obj.Set("x", rect.x);
+            obj.Set("y", rect.y);
+            obj.Set("width", rect.width);
+            obj.Set("height", rect.height);
+            result.Set("target", obj);
+        } else {
+            result.Set("target", env.Null());
+        }
+    }
+
+    if (det.hasSequences) {
+        Napi::Object out = Napi::Object::New(env);
+        for (uint32_t t = 0; t < det.sequenceNames.size(); ++t) {
+            const SequenceHit& hit = results.sequences[t];
+            if (hit.pixelIndex != static_cast<size_t>(-1)) {
+                Napi::Object c = Napi::Object::New(env); c.Set("x", hit.x); c.Set("y", hit.y);
+                out.Set(det.sequenceNames[t], c);
+            } else {
+                out.Set(det.sequenceNames[t], env.Null());
+            }
+        }
+        result.Set("sequences", out);
+    }
+
+    if (det.hasOcr) {
+        Napi::Object out = Napi::Object::New(env);
+        out.Set("x", det.ocr.x);
+        out.Set("y", det.ocr.y);
+        out.Set("cellSize", OCR_CELL_SIZE);
+        out.Set("columns", det.ocrColumns);
+        out.Set("rows", det.ocrRows);
+        Napi::Uint8Array cells = Napi::Uint8Array::New(env, results.ocrCells.size());
+        std::copy(results.ocrCells.begin(), results.ocrCells.end(), cells.Data());
+        out.Set("cells", cells);
+        result.Set("ocr", out);
+    }
+
+    return result;
+}
+
+// Validates (buffer, detectors) and reads the frame header. On failure a JS
+// exception is pending.
+bool ParseFrame(Napi::Env env, const Napi::CallbackInfo& info, Frame& frame) {
+    if (info.Length() < 2 || !info[0].IsBuffer() || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Expected (Buffer, Object detectors)").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+    if (buffer.Length() < 8) {
+        Napi::Error::New(env, "Buffer too small for header").ThrowAsJavaScriptException();
+        return false;
+    }
+    frame.width  = *reinterpret_cast<const uint32_t*>(buffer.Data());
+    frame.height = *reinterpret_cast<const uint32_t*>(buffer.Data() + 4);
+    frame.bgraData = buffer.Data() + 8;
+    frame.stride = frame.width * 4;
+    if (buffer.Length() - 8 < static_cast<size_t>(frame.width) * frame.height * 4) {
+        Napi::Error::New(env, "Buffer does not contain full image data").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+// analyzeFrame(buffer, detectors) -> results
+//
+// detectors (each optional; area is { x, y, width, height }):
+//   healthBars: { area, tracker?, dirtyRects?, output? }
+//               -> healthBars: [{ x, y, healthTag, hpPercent, id? }]
+//               (id: stable per-bar id, when given a createHealthBarTracker tracker)
+//               output 'records' returns an Int32Array of 5-int records
+//               (x, y, hpPercent, healthClass, id) instead, as findHealthBars
+//               does; healthClass is 0 Full .. 5 Obstructed, id 0 untracked.
+//               dirtyRects must cover every pixel that changed since the
+//               tracker's previous call; bars away from them are reused and
+//               only the rects, grown by a bar's size, are rescanned. Without
+//               them, with another call on the tracker still in flight, or
+//               when most of the area is dirty, the whole area is scanned.
+//   target:     { area }                 -> target: { x, y, width, height } | null
+//   sequences:  { area, sequences }      -> sequences: { name: { x, y } | null }
+//               (findSequencesNative configs; first occurrence)
+//   ocr:        { area, colors: [[r, g, b], ...] }
+//               -> ocr: { x, y, cellSize, columns, rows, cells: Uint8Array }
+//               cells[row * columns + column] is 1 where the cell has a pixel
+//               in one of the colours, i.e. where recognizeText could find text.
+// Only registered detectors appear in the result.
+Napi::Value AnalyzeFrame(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    Frame frame;
+    if (!ParseFrame(env, info, frame)) return env.Null();
+
+    Detectors det;
+    if (!ParseDetectors(env, info[1].As<Napi::Object>(), frame, det)) {
+        ForgetTrackerHistory(det);
+        return env.Null();
+    }
+    StartTrackerCall(frame, det);
+
+    PassResults results;
+    RunPass(frame, det, results);
+    return ResultsToJs(env, det, results);
+}
+
+// ---------- Async ----------
+// analyzeFrame on the libuv pool (which hands the tiles to the shared vision
+// pool), so the calling JS thread keeps running during the pass.
+class AnalyzeFrameWorker : public Napi::AsyncWorker {
+public:
+    AnalyzeFrameWorker(Napi::Promise::Deferred deferred, const Napi::Buffer<uint8_t>& buffer,
+                       const Napi::Object& jsDetectors, const Frame& frame, Detectors det)
+        : Napi::AsyncWorker(deferred.Env()), frame(frame), det(std::move(det)), deferred(deferred) {
+        // Keep the frame alive, and the detectors object with any tracker in it.
+        bufferRef = Napi::ObjectReference::New(buffer, 1);
+        detectorsRef = Napi::ObjectReference::New(jsDetectors, 1);
+    }
+
+protected:
+    void Execute() override {
+        RunPass(frame, det, results);
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+        Napi::Object result = ResultsToJs(env, det, results);
+        Release();
+        deferred.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& e) override {
+        AbortTrackerCall(det);
+        Release();
+        deferred.Reject(e.Value());
+    }
+
+private:
+    void Release() {
+        bufferRef.Unref();
+        detectorsRef.Unref();
+    }
+
+    Napi::ObjectReference bufferRef, detectorsRef;
+    Frame frame;
+    Detectors det;
+    Napi::Promise::Deferred deferred;
+    PassResults results;
+};
+
+// analyzeFrameAsync(buffer, detectors) -> Promise of what analyzeFrame
+// returns. The buffer must not be written to until the promise settles.
+Napi::Value AnalyzeFrameAsync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    Frame frame;
+    if (!ParseFrame(env, info, frame)) return env.Null();
+
+    Detectors det;
+    if (!ParseDetectors(env, info[1].As<Napi::Object>(), frame, det)) {
+        ForgetTrackerHistory(det);
+        return env.Null();
+    }
+    StartTrackerCall(frame, det);
+
+    auto deferred = Napi::Promise::Deferred::New(env);
+    auto worker = new AnalyzeFrameWorker(deferred, info[0].As<Napi::Buffer<uint8_t>>(), info[1].As<Napi::Object>(), frame, std::move(det));
+    worker->Queue();
+    return deferred.Promise();
+}
+
+// createHealthBarTracker([{ maxMotion }]) -> tracker for healthBars.tracker
+// maxMotion: how far (pixels, per axis) a bar may move between two frames and
+// keep its id; defaults to one tile.
+Napi::Value CreateHealthBarTracker(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t maxMotion = health_bars::BarTracker::DEFAULT_MAX_MOTION;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("maxMotion")) {
+            if (!options.Get("maxMotion").IsNumber()) {
+                Napi::TypeError::New(env, "maxMotion must be a number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            maxMotion = options.Get("maxMotion").As<Napi::Number>().Uint32Value();
+        }
+    }
+    Napi::External<TrackerHandle> tracker = Napi::External<TrackerHandle>::New(env, new TrackerHandle(maxMotion),
+        [](Napi::Env, TrackerHandle* handle) { delete handle; });
+    tracker.TypeTag(&TRACKER_TYPE_TAG);
+    return tracker;
+}
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    exports.Set("analyzeFrame", Napi::Function::New(env, AnalyzeFrame));
+    exports.Set("analyzeFrameAsync", Napi::Function::New(env, AnalyzeFrameAsync));
+    exports.Set("createHealthBarTracker", Napi::Function::New(env, CreateHealthBarTracker));
+    return exports;
+}
+
+NODE_API_MODULE(frameAnalyzer, Init)
@@ -0,0 +1,2 @@
+const frameAnalyzerNative = require('./build/Release/frameAnalyzer.node');
+module.exports = frameAnalyzerNative;
@@ -6,7 +6,8 @@
         "src/minimapMatcher.cc"
       ],
       "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")"
+        "<!@(node -p \"require('node-addon-api').include\")",
+        "../common"
       ],
 
 
@@ -22,7 +23,8 @@
             "-O3",            # Aggressive optimization level
             "-flto",          # Enable Link-Time Optimization
             "-fvisibility=hidden", # Improve load times and reduce binary size
-            "-march=native"   # IMPORTANT: See explanation below
+            "-march=x86-64",  # Baseline ISA; pixelKernels.h picks SIMD at runtime
+            "-mtune=generic"
           ],
           "ldflags": [
             "-flto"           # Linker flag for LTO
@@ -36,10 +38,7 @@
               "Optimization": 2,      # /O2 - Maximize speed
               "InlineFunctionExpansion": 2, # /Ob2 - Aggressive inlining
               "EnableIntrinsicFunctions": "true", # /Oi - Use fast intrinsic functions
-              "FavorSizeOrSpeed": 2, # /Ot - Favor speed over size
-              "AdditionalOptions": [
-                "/arch:AVX2"      # IMPORTANT: See explanation below
-              ]
+              "FavorSizeOrSpeed": 2 # /Ot - Favor speed over size
             },
             "VCLinkerTool": {
               "LinkTimeCodeGeneration": 1 # /LTCG - Enable Link-Time Optimization
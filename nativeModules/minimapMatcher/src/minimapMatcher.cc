@@ -2,8 +2,11 @@
 
 #include "minimapMatcher.h"
 #include "positionFinderWorker.h"
+#include <algorithm>
 #include <iostream>
 
+#include "pixelKernels.h"
+
 // --- Helper to convert Napi::Value to std::vector<uint8_t> ---
 std::vector<uint8_t> NapiBufferToVector(const Napi::Buffer<uint8_t>& buffer) {
     return std::vector<uint8_t>(buffer.Data(), buffer.Data() + buffer.Length());
@@ -21,6 +24,7 @@ Napi::Object MinimapMatcher::Init(Napi::Env env, Napi::Object exports) {
         InstanceAccessor("artificialLandmarkData", &MinimapMatcher::LandmarkDataGetter, &MinimapMatcher::ArtificialLandmarkDataSetter),
         InstanceAccessor("naturalLandmarkData", &MinimapMatcher::LandmarkDataGetter, &MinimapMatcher::NaturalLandmarkDataSetter),
         InstanceMethod("findPosition", &MinimapMatcher::FindPosition),
+        InstanceMethod("findPositionInFrame", &MinimapMatcher::FindPositionInFrame),
         InstanceMethod("cancelSearch", &MinimapMatcher::CancelSearch)
     });
 
@@ -40,6 +44,18 @@ MinimapMatcher::MinimapMatcher(const Napi::CallbackInfo& info) : Napi::ObjectWra
         EXCLUDED_COLORS_RGB.push_back(Napi::Persistent(excludedColorsArray.Get(i).As<Napi::Object>()));
     }
 
+    // Optional: palette used by findPositionInFrame to map BGRA pixels natively.
+    if (constants.Has("PALETTE_RGB")) {
+        Napi::Array paletteArray = constants.Get("PALETTE_RGB").As<Napi::Array>();
+        for (uint32_t i = 0; i < paletteArray.Length(); ++i) {
+            Napi::Object color = paletteArray.Get(i).As<Napi::Object>();
+            uint32_t r = color.Get("r").As<Napi::Number>().Uint32Value() & 0xFF;
+            uint32_t g = color.Get("g").As<Napi::Number>().Uint32Value() & 0xFF;
+            uint32_t b = color.Get("b").As<Napi::Number>().Uint32Value() & 0xFF;
+            paletteKeys.push_back((r << 16) | (g << 8) | b);
+        }
+    }
+
     this->liveNoiseIndices = {0, 10, 14};
     this->isLoaded = false;
     this->activeWorker = nullptr;
@@ -98,12 +114,19 @@ void MinimapMatcher::NaturalLandmarkDataSetter(const Napi::CallbackInfo& info, c
     }
 }
 
-// --- FindPosition & CancelSearch (No Changes) ---
-Napi::Value MinimapMatcher::FindPosition(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
+// --- FindPosition & CancelSearch ---
+// Cancels the search still in flight, if any, and starts this one.
+Napi::Value MinimapMatcher::QueueSearch(Napi::Env env, std::vector<uint8_t>&& unpackedMinimap, int minimapWidth, int minimapHeight, int targetZ) {
     if (this->activeWorker != nullptr) {
         this->activeWorker->Cancel();
     }
+    PositionFinderWorker* worker = new PositionFinderWorker(env, this, std::move(unpackedMinimap), minimapWidth, minimapHeight, targetZ);
+    worker->Queue();
+    return worker->GetPromise();
+}
+
+Napi::Value MinimapMatcher::FindPosition(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
     Napi::Buffer<uint8_t> unpackedMinimapBuffer = info[0].As<Napi::Buffer<uint8_t>>();
     int minimapWidth = info[1].As<Napi::Number>().Int32Value();
     int minimapHeight = info[2].As<Napi::Number>().Int32Value();
@@ -113,10 +136,57 @@ Napi::Value MinimapMatcher::FindPosition(const Napi::CallbackInfo& info) {
          deferred.Reject(Napi::Error::New(env, "Matcher not loaded").Value());
          return deferred.Promise();
     }
-    std::vector<uint8_t> unpackedMinimapVec = NapiBufferToVector(unpackedMinimapBuffer);
-    PositionFinderWorker* worker = new PositionFinderWorker(env, this, unpackedMinimapVec, minimapWidth, minimapHeight, targetZ);
-    worker->Queue();
-    return worker->GetPromise();
+    return QueueSearch(env, NapiBufferToVector(unpackedMinimapBuffer), minimapWidth, minimapHeight, targetZ);
+}
+
+// findPositionInFrame(frameBuffer, frameWidth, {x, y, width, height}, targetZ)
+// Takes the raw capture buffer (8-byte header + BGRA) and maps the minimap
+// region to palette indices natively, skipping the JS conversion and copy.
+Napi::Value MinimapMatcher::FindPositionInFrame(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (info.Length() < 4 || !info[0].IsBuffer() || !info[1].IsNumber() || !info[2].IsObject() || !info[3].IsNumber()) {
+        deferred.Reject(Napi::TypeError::New(env, "Expected (frameBuffer, frameWidth, region, targetZ)").Value());
+        return deferred.Promise();
+    }
+    if (!this->isLoaded) {
+        deferred.Reject(Napi::Error::New(env, "Matcher not loaded").Value());
+        return deferred.Promise();
+    }
+    if (this->paletteKeys.empty()) {
+        deferred.Reject(Napi::Error::New(env, "PALETTE_RGB was not provided to the constructor").Value());
+        return deferred.Promise();
+    }
+
+    Napi::Buffer<uint8_t> frameBuffer = info[0].As<Napi::Buffer<uint8_t>>();
+    int frameWidth = info[1].As<Napi::Number>().Int32Value();
+    Napi::Object region = info[2].As<Napi::Object>();
+    int regionX = region.Get("x").As<Napi::Number>().Int32Value();
+    int regionY = region.Get("y").As<Napi::Number>().Int32Value();
+    int regionWidth = region.Get("width").As<Napi::Number>().Int32Value();
+    int regionHeight = region.Get("height").As<Napi::Number>().Int32Value();
+    int targetZ = info[3].As<Napi::Number>().Int32Value();
+
+    if (frameWidth <= 0 || regionX < 0 || regionY < 0 || regionWidth <= 0 || regionHeight <= 0 || regionX + regionWidth > frameWidth) {
+        deferred.Reject(Napi::Error::New(env, "Invalid minimap region").Value());
+        return deferred.Promise();
+    }
+    const size_t stride = static_cast<size_t>(frameWidth) * 4;
+    const size_t lastByte = FRAME_HEADER_SIZE + (static_cast<size_t>(regionY) + regionHeight - 1) * stride + static_cast<size_t>(regionX + regionWidth) * 4;
+    if (lastByte > frameBuffer.Length()) {
+        deferred.Reject(Napi::Error::New(env, "Minimap region exceeds frame buffer").Value());
+        return deferred.Promise();
+    }
+
+    std::vector<uint8_t> unpackedMinimap(static_cast<size_t>(regionWidth) * regionHeight);
+    const uint8_t* regionStart = frameBuffer.Data() + FRAME_HEADER_SIZE + static_cast<size_t>(regionY) * stride + static_cast<size_t>(regionX) * 4;
+    // Indices are bytes, so only the first 256 keys can be reported.
+    const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+    const uint32_t paletteSize = static_cast<uint32_t>(std::min<size_t>(this->paletteKeys.size(), 256));
+    for (int y = 0; y < regionHeight; ++y) {
+        kernels.mapPalette(regionStart + y * stride, regionWidth, this->paletteKeys.data(), paletteSize, 0, unpackedMinimap.data() + static_cast<size_t>(y) * regionWidth);
+    }
+    return QueueSearch(env, std::move(unpackedMinimap), regionWidth, regionHeight, targetZ);
 }
 
 Napi::Value MinimapMatcher::CancelSearch(const Napi::CallbackInfo& info) {
@@ -131,13 +201,13 @@ Napi::Value MinimapMatcher::CancelSearch(const Napi::CallbackInfo& info) {
 PositionFinderWorker::PositionFinderWorker(
     Napi::Env env,
     MinimapMatcher* matcher,
-    const std::vector<uint8_t>& unpackedMinimap,
+    std::vector<uint8_t>&& unpackedMinimap,
     int minimapWidth,
     int minimapHeight,
     int targetZ
 ) : Napi::AsyncWorker(env),
     matcherInstance(matcher),
-    unpackedMinimap(unpackedMinimap),
+    unpackedMinimap(std::move(unpackedMinimap)),
     minimapWidth(minimapWidth),
     minimapHeight(minimapHeight),
     targetZ(targetZ),
@@ -158,6 +228,48 @@ void PositionFinderWorker::OnError(const Napi::Error& e) {
     deferred.Reject(e.Value());
 }
 
+// Detects the minimap zoom from where colour edges fall. At zoom S every
+// tile is an SxS block, so all edges between clean (non-noise) pixels land on
+// a single residue modulo S along each axis; that residue is the block phase.
+bool PositionFinderWorker::DetectZoom(int& zoomScale, int& phaseX, int& phaseY) const {
+    const int MIN_EDGES = 16;
+    const double MIN_EDGE_RATIO = 0.97;
+    const auto& noise = this->matcherInstance->liveNoiseIndices;
+    const uint8_t* plane = unpackedMinimap.data();
+
+    // Edge counts by coordinate modulo 4 (covers scales 4 and 2).
+    int edgesX[4] = {0, 0, 0, 0};
+    int edgesY[4] = {0, 0, 0, 0};
+    int totalX = 0, totalY = 0;
+    for (int y = 0; y < minimapHeight; ++y) {
+        const uint8_t* row = plane + y * minimapWidth;
+        for (int x = 0; x < minimapWidth; ++x) {
+            uint8_t c = row[x];
+            if (noise.count(c)) continue;
+            if (x > 0 && row[x - 1] != c && !noise.count(row[x - 1])) { edgesX[x & 3]++; totalX++; }
+            if (y > 0 && row[x - minimapWidth] != c && !noise.count(row[x - minimapWidth])) { edgesY[y & 3]++; totalY++; }
+        }
+    }
+    if (totalX < MIN_EDGES || totalY < MIN_EDGES) return false;
+
+    for (int scale : MinimapMatcher::ZOOM_SCALES) {
+        if (scale == 1) break;
+        int bestX = 0, bestY = 0, countX = 0, countY = 0;
+        for (int r = 0; r < scale; ++r) {
+            int cx = 0, cy = 0;
+            for (int m = r; m < 4; m += scale) { cx += edgesX[m]; cy += edgesY[m]; }
+            if (cx > countX) { countX = cx; bestX = r; }
+            if (cy > countY) { countY = cy; bestY = r; }
+        }
+        if (countX >= totalX * MIN_EDGE_RATIO && countY >= totalY * MIN_EDGE_RATIO) {
+            zoomScale = scale; phaseX = bestX; phaseY = bestY;
+            return true;
+        }
+    }
+    zoomScale = 1; phaseX = 0; phaseY = 0;
+    return true;
+}
+
 void PositionFinderWorker::Execute() {
     auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -174,70 +286,91 @@ void PositionFinderWorker::Execute() {
         return;
     }
 
+    // --- Zoom: reduce the frame to one pixel per tile so the 1:1 landmark index applies ---
+    int zoomScale = this->matcherInstance->lastZoomScale.load();
+    int phaseX = this->matcherInstance->lastZoomPhaseX.load();
+    int phaseY = this->matcherInstance->lastZoomPhaseY.load();
+    bool detected = DetectZoom(zoomScale, phaseX, phaseY);
+
+    if (zoomScale > 1) {
+        const int planeWidth = (minimapWidth - phaseX) / zoomScale;
+        const int planeHeight = (minimapHeight - phaseY) / zoomScale;
+        std::vector<uint8_t> tilePlane(static_cast<size_t>(planeWidth) * planeHeight);
+        for (int ty = 0; ty < planeHeight; ++ty) {
+            const uint8_t* srcRow = unpackedMinimap.data() + (phaseY + ty * zoomScale) * minimapWidth + phaseX;
+            uint8_t* dstRow = tilePlane.data() + ty * planeWidth;
+            for (int tx = 0; tx < planeWidth; ++tx) dstRow[tx] = srcRow[tx * zoomScale];
+        }
+        // The player sits at the centre pixel of the minimap; express it in tiles.
+        const int centerX = (minimapWidth / 2 - phaseX) / zoomScale;
+        const int centerY = (minimapHeight / 2 - phaseY) / zoomScale;
+        if (SearchLandmarks(tilePlane.data(), planeWidth, planeHeight, centerX, centerY,
+                            hasArtificial ? &artificial_it->second : nullptr, hasNatural ? &natural_it->second : nullptr)) {
+            if (detected) StoreZoom(zoomScale, phaseX, phaseY);
+            this->resultPosition.zoomScale = zoomScale;
+            FinishTiming(start_time);
+            return;
+        }
+        if (this->wasCancelled) return;
+        // Regular 2-pixel structure in a 1x frame can pass DetectZoom; a
+        // zoomed guess only stands if it finds a landmark, so re-check at 1x.
+    }
+
+    if (SearchLandmarks(unpackedMinimap.data(), minimapWidth, minimapHeight, minimapWidth / 2, minimapHeight / 2,
+                        hasArtificial ? &artificial_it->second : nullptr, hasNatural ? &natural_it->second : nullptr)) {
+        StoreZoom(1, 0, 0);
+        this->resultPosition.zoomScale = 1;
+        FinishTiming(start_time);
+        return;
+    }
+    if (this->wasCancelled) return;
+
+    // No match at any scale: keep a confident detection for low-edge frames.
+    if (detected && zoomScale > 1) StoreZoom(zoomScale, phaseX, phaseY);
+    this->resultPosition.zoomScale = zoomScale;
+    this->searchMethod = "fallback_no_match";
+    FinishTiming(start_time);
+}
+
+void PositionFinderWorker::StoreZoom(int zoomScale, int phaseX, int phaseY) {
+    this->matcherInstance->lastZoomScale = zoomScale;
+    this->matcherInstance->lastZoomPhaseX = phaseX;
+    this->matcherInstance->lastZoomPhaseY = phaseY;
+}
+
+void PositionFinderWorker::FinishTiming(std::chrono::high_resolution_clock::time_point start_time) {
+    auto end_time = std::chrono::high_resolution_clock::now();
+    this->durationMs = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000.0;
+}
+
+// Looks up every clean LANDMARK_SIZE window of a one-pixel-per-tile plane,
+// artificial landmarks first, natural ones only if none matched. On a hit,
+// fills resultPosition (the player is at (centerX, centerY) in the plane).
+bool PositionFinderWorker::SearchLandmarks(const uint8_t* plane, int planeWidth, int planeHeight, int centerX, int centerY,
+                                           const MinimapMatcher::LandmarkMap* artificial,
+                                           const MinimapMatcher::LandmarkMap* natural) {
     int halfLandmark = this->matcherInstance->LANDMARK_SIZE / 2;
     const int patternPixelCount = this->matcherInstance->LANDMARK_SIZE * this->matcherInstance->LANDMARK_SIZE;
     MinimapMatcher::LandmarkPattern probePattern(this->matcherInstance->LANDMARK_PATTERN_BYTES, '\0');
     char* probePatternData = probePattern.data();
 
-    // --- Phase 1: Search Artificial Landmarks ---
-    if (hasArtificial) {
-        this->searchMethod = "v3.0_artificial";
-        const auto& landmarkMap = artificial_it->second;
-        for (int y = halfLandmark; y < minimapHeight - halfLandmark; ++y) {
-            if (this->wasCancelled) { return; }
-            for (int x = halfLandmark; x < minimapWidth - halfLandmark; ++x) {
-                probePattern.assign(this->matcherInstance->LANDMARK_PATTERN_BYTES, '\0'); // Clear the buffer
-                bool isClean = true;
-                for (int i = 0; i < patternPixelCount; ++i) {
-                    int my = i / this->matcherInstance->LANDMARK_SIZE;
-                    int mx = i % this->matcherInstance->LANDMARK_SIZE;
-                    uint8_t liveIndex = unpackedMinimap[(y - halfLandmark + my) * minimapWidth + (x - halfLandmark + mx)];
-                    if (this->matcherInstance->liveNoiseIndices.count(liveIndex)) {
-                        isClean = false;
-                        break;
-                    }
-                    int byteIndex = i / 2;
-                    if (i % 2 == 0) {
-                        probePatternData[byteIndex] = static_cast<char>(liveIndex << 4);
-                    } else {
-                        probePatternData[byteIndex] |= static_cast<char>(liveIndex);
-                    }
-                }
-
-                if (isClean) {
-                    auto lm_it = landmarkMap.find(probePattern);
-                    if (lm_it != landmarkMap.end()) {
-                        const NativeLandmark& foundLandmark = lm_it->second;
-                        this->resultPosition.found = true;
-                        int mapViewX = foundLandmark.x - x;
-                        int mapViewY = foundLandmark.y - y;
-                        this->resultPosition.x = mapViewX + (minimapWidth / 2);
-                        this->resultPosition.y = mapViewY + (minimapHeight / 2);
-                        this->resultPosition.z = targetZ;
-                        this->resultPosition.mapViewX = mapViewX;
-                        this->resultPosition.mapViewY = mapViewY;
-                        auto end_time = std::chrono::high_resolution_clock::now();
-                        this->durationMs = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000.0;
-                        return; // Position found, exit immediately.
-                    }
-                }
-            }
-        }
-    }
-
-    // --- Phase 2: Search Natural Landmarks (only if no artificial match was found) ---
-    if (hasNatural) {
-        this->searchMethod = "v3.0_natural_fallback";
-        const auto& landmarkMap = natural_it->second;
-        for (int y = halfLandmark; y < minimapHeight - halfLandmark; ++y) {
-            if (this->wasCancelled) { return; }
-            for (int x = halfLandmark; x < minimapWidth - halfLandmark; ++x) {
+    const std::pair<const MinimapMatcher::LandmarkMap*, const char*> phases[] = {
+        {artificial, "v3.0_artificial"},
+        {natural, "v3.0_natural_fallback"},
+    };
+    for (const auto& [landmarkMap, method] : phases) {
+        if (!landmarkMap) continue;
+        this->searchMethod = method;
+        for (int y = halfLandmark; y < planeHeight - halfLandmark; ++y) {
+            if (this->wasCancelled) { return false; }
+            for (int x = halfLandmark; x < planeWidth - halfLandmark; ++x) {
                 probePattern.assign(this->matcherInstance->LANDMARK_PATTERN_BYTES, '\0'); // Clear the buffer
+                probePatternData = probePattern.data();
                 bool isClean = true;
                 for (int i = 0; i < patternPixelCount; ++i) {
                     int my = i / this->matcherInstance->LANDMARK_SIZE;
                     int mx = i % this->matcherInstance->LANDMARK_SIZE;
-                    uint8_t liveIndex = unpackedMinimap[(y - halfLandmark + my) * minimapWidth + (x - halfLandmark + mx)];
+                    uint8_t liveIndex = plane[(y - halfLandmark + my) * planeWidth + (x - halfLandmark + mx)];
                     if (this->matcherInstance->liveNoiseIndices.count(liveIndex)) {
                         isClean = false;
                         break;
@@ -251,29 +384,24 @@ void PositionFinderWorker::Execute() {
                 }
 
                 if (isClean) {
-                    auto lm_it = landmarkMap.find(probePattern);
-                    if (lm_it != landmarkMap.end()) {
+                    auto lm_it = landmarkMap->find(probePattern);
+                    if (lm_it != landmarkMap->end()) {
                         const NativeLandmark& foundLandmark = lm_it->second;
                         this->resultPosition.found = true;
                         int mapViewX = foundLandmark.x - x;
                         int mapViewY = foundLandmark.y - y;
-                        this->resultPosition.x = mapViewX + (minimapWidth / 2);
-                        this->resultPosition.y = mapViewY + (minimapHeight / 2);
+                        this->resultPosition.x = mapViewX + centerX;
+                        this->resultPosition.y = mapViewY + centerY;
                         this->resultPosition.z = targetZ;
                         this->resultPosition.mapViewX = mapViewX;
                         this->resultPosition.mapViewY = mapViewY;
-                        auto end_time = std::chrono::high_resolution_clock::now();
-                        this->durationMs = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000.0;
-                        return; // Position found, exit immediately.
+                        return true; // Position found, exit immediately.
                     }
                 }
             }
         }
     }
-
-    this->searchMethod = "fallback_no_match";
-    auto end_time = std::chrono::high_resolution_clock::now();
-    this->durationMs = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count() / 1000.0;
+    return false;
 }
 
 // --- OnOK (No Changes) ---
@@ -287,6 +415,7 @@ void PositionFinderWorker::OnOK() {
     Napi::Object performance = Napi::Object::New(env);
     performance.Set("totalTimeMs", Napi::Number::New(env, this->durationMs));
     performance.Set("method", Napi::String::New(env, this->searchMethod));
+    performance.Set("zoomScale", Napi::Number::New(env, this->resultPosition.zoomScale));
     Napi::Object result = Napi::Object::New(env);
     result.Set("performance", performance);
     if (this->resultPosition.found) {
@@ -297,6 +426,7 @@ void PositionFinderWorker::OnOK() {
         result.Set("position", position);
         result.Set("mapViewX", Napi::Number::New(env, this->resultPosition.mapViewX));
         result.Set("mapViewY", Napi::Number::New(env, this->resultPosition.mapViewY));
+        result.Set("zoomScale", Napi::Number::New(env, this->resultPosition.zoomScale));
     } else {
         result.Set("position", env.Null());
     }
@@ -37,6 +37,24 @@ public:
     int LANDMARK_PATTERN_BYTES;
     std::set<int> liveNoiseIndices;
 
+    // Palette as packed 0x00RRGGBB keys, index == palette index. Used by the
+    // BGRA frame path to map pixels to indices without a JS conversion pass.
+    std::vector<uint32_t> paletteKeys;
+
+    // The capture buffers start with an 8-byte (width, height) header.
+    static const size_t FRAME_HEADER_SIZE = 8;
+
+    // Client minimap zoom-in levels (screen pixels per tile side), largest first.
+    // Landmarks are stored at 1:1, so zoomed frames are decimated to tile
+    // resolution before searching. Zoomed-out minimaps (several tiles per
+    // screen pixel) are not localized: their landmarks would have to be
+    // sampled from the full map raster, which this module never receives.
+    static constexpr int ZOOM_SCALES[] = {4, 2, 1};
+    // Last confidently detected zoom and block phase; reused when a frame has too few edges.
+    std::atomic<int> lastZoomScale{1};
+    std::atomic<int> lastZoomPhaseX{0};
+    std::atomic<int> lastZoomPhaseY{0};
+
     // --- NEW: Type aliases for clarity and easy modification ---
     using LandmarkPattern = std::string;
     using LandmarkMap = std::unordered_map<LandmarkPattern, NativeLandmark>;
@@ -50,6 +68,8 @@ public:
 private:
     // --- Instance Methods ---
     Napi::Value FindPosition(const Napi::CallbackInfo& info);
+    Napi::Value FindPositionInFrame(const Napi::CallbackInfo& info);
+    Napi::Value QueueSearch(Napi::Env env, std::vector<uint8_t>&& unpackedMinimap, int minimapWidth, int minimapHeight, int targetZ);
     Napi::Value CancelSearch(const Napi::CallbackInfo& info);
 
     // --- Accessors ---
@@ -14,6 +14,7 @@ struct NativePosition {
     int z = 0;
     int mapViewX = 0;
     int mapViewY = 0;
+    int zoomScale = 1;
 };
 
 // --- The Asynchronous Worker Declaration ---
@@ -22,7 +23,7 @@ public:
     PositionFinderWorker(
         Napi::Env env,
         MinimapMatcher* matcher,
-        const std::vector<uint8_t>& unpackedMinimap,
+        std::vector<uint8_t>&& unpackedMinimap,
         int minimapWidth,
         int minimapHeight,
         int targetZ
@@ -54,6 +55,12 @@ private:
     double durationMs;
 
     Napi::Promise::Deferred deferred;
+
+    bool DetectZoom(int& zoomScale, int& phaseX, int& phaseY) const;
+    bool SearchLandmarks(const uint8_t* plane, int planeWidth, int planeHeight, int centerX, int centerY,
+                         const MinimapMatcher::LandmarkMap* artificial, const MinimapMatcher::LandmarkMap* natural);
+    void StoreZoom(int zoomScale, int phaseX, int phaseY);
+    void FinishTiming(std::chrono::high_resolution_clock::time_point start_time);
 };
 
 #endif // POSITION_FINDER_WORKER_H
\ No newline at end of file
@@ -0,0 +1,181 @@
+// FrameReplay: plays back a recording made with X11RegionCapture.startRecording()
+// through the same frame API as the live capture, so vision modules can be
+// profiled and regression-tested without an X server. See src/frameRecorder.h
+// for the file format.
+
+const fs = require('fs');
+
+const FILE_MAGIC = 0x52465441; // "ATFR"
+const FILE_VERSION = 1;
+const FILE_HEADER_BYTES = 8;
+const RECORD_HEADER_BYTES = 32;
+const RECORD_KEY = 0;
+const RUN_FLAG = 0x8000;
+const IMAGE_HEADER_SIZE = 8;
+
+// Decodes `count` RLE'd pixels from src at pos into dst starting at index.
+// Returns the position after them.
+function decodePixels(src, pos, dst, index, count) {
+  const end = index + count;
+  while (index < end) {
+    const token = src.readUInt16LE(pos);
+    pos += 2;
+    if (token & RUN_FLAG) {
+      const n = (token & 0x7fff) + 1;
+      dst.fill(src.readUInt32LE(pos), index, index + n);
+      pos += 4;
+      index += n;
+    } else {
+      for (let n = token + 1; n > 0; n--, pos += 4) dst[index++] = src.readUInt32LE(pos);
+    }
+  }
+  return pos;
+}
+
+class FrameReplay {
+  // options.realtime: getLatestFrame() follows the recorded timestamps from
+  //   startMonitorInstance() on, skipping frames the caller was too slow for.
+  //   Off (default), every call returns the next frame: deterministic.
+  // options.loop: start over at the end instead of reporting failure.
+  constructor(path, options = {}) {
+    this.data = fs.readFileSync(path);
+    if (this.data.length < FILE_HEADER_BYTES || this.data.readUInt32LE(0) !== FILE_MAGIC) {
+      throw new Error(`${path} is not a frame recording`);
+    }
+    if (this.data.readUInt32LE(4) !== FILE_VERSION) {
+      throw new Error(`Unsupported frame recording version ${this.data.readUInt32LE(4)}`);
+    }
+    this.realtime = !!options.realtime;
+    this.loop = !!options.loop;
+
+    this.records = [];
+    this.maxFrameBytes = 0;
+    for (let pos = FILE_HEADER_BYTES; pos + RECORD_HEADER_BYTES <= this.data.length; ) {
+      const payloadBytes = this.data.readUInt32LE(pos);
+      const rectCount = this.data.readUInt32LE(pos + 28);
+      const next = pos + RECORD_HEADER_BYTES + rectCount * 16 + payloadBytes;
+      if (next > this.data.length) break; // Truncated by a crash mid-write.
+      const width = this.data.readUInt32LE(pos + 8);
+      const height = this.data.readUInt32LE(pos + 12);
+      this.records.push({
+        offset: pos,
+        key: this.data[pos + 4] === RECORD_KEY,
+        width,
+        height,
+        timestampUs: Number(this.data.readBigUInt64LE(pos + 16)),
+        rectCount,
+      });
+      this.maxFrameBytes = Math.max(this.maxFrameBytes, IMAGE_HEADER_SIZE + width * height * 4);
+      pos = next;
+    }
+    if (this.records.length === 0 || !this.records[0].key) {
+      throw new Error(`${path} holds no playable frames`);
+    }
+
+    this.frame = Buffer.alloc(this.maxFrameBytes);
+    this.pixels = new Uint32Array(this.frame.buffer, this.frame.byteOffset + IMAGE_HEADER_SIZE, (this.maxFrameBytes - IMAGE_HEADER_SIZE) / 4);
+    this.next = 0;
+    this.current = null;
+    this.pendingRects = [];
+    this.running = false;
+    this.startTimeUs = 0;
+  }
+
+  get frameCount() {
+    return this.records.length;
+  }
+
+  isConnected() {
+    return true;
+  }
+
+  startMonitorInstance() {
+    this.running = true;
+    this.startTimeUs = Number(process.hrtime.bigint() / 1000n);
+  }
+
+  stopMonitorInstance() {
+    this.running = false;
+  }
+
+  // Same result shape as X11RegionCapture.getLatestFrame(targetBuffer).
+  getLatestFrame(targetBuffer) {
+    if (this.realtime) {
+      const elapsedUs = Number(process.hrtime.bigint() / 1000n) - this.startTimeUs;
+      const base = this.records[0].timestampUs;
+      let advanced = false;
+      while (this.hasNext() && this.peek().timestampUs - base <= elapsedUs) {
+        this.advance();
+        advanced = true;
+      }
+      if (!advanced) return { success: false };
+    } else {
+      if (!this.hasNext()) return { success: false, reason: 'End of recording.' };
+      this.advance();
+    }
+
+    const { width, height, timestampUs } = this.current;
+    const bytes = IMAGE_HEADER_SIZE + width * height * 4;
+    if (targetBuffer) {
+      if (targetBuffer.length < bytes) return { success: false, reason: 'Target buffer too small.' };
+      this.frame.copy(targetBuffer, 0, 0, bytes);
+    }
+    const changedRegions = this.pendingRects;
+    this.pendingRects = [];
+    return { success: true, width, height, captureTimestampUs: timestampUs, changedRegions };
+  }
+
+  // The decoded frame (header + BGRA) of the last getLatestFrame(), without a copy.
+  get frameBuffer() {
+    return this.frame;
+  }
+
+  hasNext() {
+    return this.next < this.records.length || (this.loop && this.records.length > 0);
+  }
+
+  peek() {
+    if (this.next >= this.records.length) {
+      // Looping: timestamps restart, so shift the clock by one recording length.
+      const last = this.records[this.records.length - 1].timestampUs;
+      this.startTimeUs += last - this.records[0].timestampUs;
+      this.next = 0;
+    }
+    return this.records[this.next];
+  }
+
+  advance() {
+    const record = this.peek();
+    this.next++;
+    const { data } = this;
+    const { width, height } = record;
+    this.frame.writeUInt32LE(width, 0);
+    this.frame.writeUInt32LE(height, 4);
+
+    const rects = [];
+    let pos = record.offset + RECORD_HEADER_BYTES;
+    for (let i = 0; i < record.rectCount; i++, pos += 16) {
+      rects.push({
+        x: data.readInt32LE(pos),
+        y: data.readInt32LE(pos + 4),
+        width: data.readInt32LE(pos + 8),
+        height: data.readInt32LE(pos + 12),
+      });
+    }
+    if (record.key) {
+      decodePixels(data, pos, this.pixels, 0, width * height);
+    } else {
+      for (const rect of rects) {
+        for (let y = rect.y; y < rect.y + rect.height; y++) {
+          pos = decodePixels(data, pos, this.pixels, y * width + rect.x, rect.width);
+        }
+      }
+    }
+    // Like the live capture, rects accumulate until the caller fetches them.
+    if (record.key && rects.length === 0) rects.push({ x: 0, y: 0, width, height });
+    this.pendingRects.push(...rects);
+    this.current = record;
+  }
+}
+
+module.exports = { FrameReplay };
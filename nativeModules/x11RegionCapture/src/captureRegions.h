@@ -0,0 +1,101 @@
+// captureRegions.h - Per-region capture subscriptions (addCaptureRegion).
+//
+// Each subscription is a window sub-rectangle with its own rate. The capture
+// loop wakes at the fastest rate and grabs only the regions that are due,
+// fetching overlapping ones once. Not thread-safe: the owner locks the list.
+
+#ifndef CAPTURE_REGIONS_H
+#define CAPTURE_REGIONS_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "frameUpdate.h"
+
+namespace capture_regions {
+
+using frame_update::Rect;
+
+struct CaptureRegion {
+    int id; Rect rect; std::chrono::microseconds interval;
+    std::chrono::steady_clock::time_point next_due;
+    bool changed; uint64_t last_capture_us;
+    bool damaged; // Damage pacing: the client drew into it since its last grab.
+};
+
+inline bool Intersects(const Rect& a, const Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+// The loop wakes at the fastest subscribed rate; slower regions are skipped
+// until due. Without subscriptions it runs at `fallback`.
+inline std::chrono::microseconds TickInterval(const std::vector<CaptureRegion>& regions, std::chrono::microseconds fallback) {
+    if (regions.empty()) return fallback;
+    std::chrono::microseconds tick = regions.front().interval;
+    for (const auto& region : regions) tick = std::min(tick, region.interval);
+    return tick;
+}
+
+// Schedules every region due at `now` for its next interval and returns what
+// to grab: the due regions clipped to the window, overlapping ones merged
+// into their bounding box. Under damage pacing an untouched region stays due
+// until it is drawn to.
+inline std::vector<Rect> TakeDue(std::vector<CaptureRegion>& regions, uint32_t width, uint32_t height, bool damage_paced,
+                                 std::chrono::steady_clock::time_point now) {
+    std::vector<Rect> due;
+    for (auto& region : regions) {
+        if (region.next_due > now) continue;
+        if (damage_paced && !region.damaged) continue;
+        region.damaged = false;
+        region.next_due = std::max(region.next_due + region.interval, now);
+        int x0 = std::max(region.rect.x, 0), y0 = std::max(region.rect.y, 0);
+        int x1 = std::min(region.rect.x + region.rect.width, (int)width);
+        int y1 = std::min(region.rect.y + region.rect.height, (int)height);
+        if (x1 <= x0 || y1 <= y0) continue;
+        due.push_back({x0, y0, x1 - x0, y1 - y0});
+    }
+    for (size_t i = 0; i < due.size(); ++i) {
+        for (size_t j = i + 1; j < due.size(); ++j) {
+            Rect& a = due[i]; const Rect& b = due[j];
+            if (!Intersects(a, b)) continue;
+            int x1 = std::max(a.x + a.width, b.x + b.width), y1 = std::max(a.y + a.height, b.y + b.height);
+            a.x = std::min(a.x, b.x); a.y = std::min(a.y, b.y);
+            a.width = x1 - a.x; a.height = y1 - a.y;
+            due.erase(due.begin() + j);
+            j = i; // Rescan: the grown box may overlap entries already passed over.
+        }
+    }
+    return due;
+}
+
+// Every region the update fully covers was captured at `timestamp`; it
+// changed if one of the update's dirty rects touches it.
+inline void MarkChanges(std::vector<CaptureRegion>& regions, const frame_update::FrameUpdate& update, uint64_t timestamp) {
+    for (auto& region : regions) {
+        const Rect& r = region.rect;
+        bool covered = false;
+        for (const auto& area : update.areas) {
+            if (r.x >= area.rect.x && r.y >= area.rect.y && r.x + r.width <= area.rect.x + area.rect.width && r.y + r.height <= area.rect.y + area.rect.height) { covered = true; break; }
+        }
+        if (!covered) continue;
+        region.last_capture_us = timestamp;
+        for (const auto& d : update.rects) {
+            if (Intersects(d, r)) { region.changed = true; break; }
+        }
+    }
+}
+
+inline void MarkDamaged(std::vector<CaptureRegion>& regions, const Rect& area) {
+    for (auto& region : regions) if (Intersects(area, region.rect)) region.damaged = true;
+}
+
+inline bool AnyDamaged(const std::vector<CaptureRegion>& regions) {
+    for (const auto& region : regions) if (region.damaged) return true;
+    return false;
+}
+
+} // namespace capture_regions
+
+#endif // CAPTURE_REGIONS_H
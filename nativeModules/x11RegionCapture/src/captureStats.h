@@ -0,0 +1,112 @@
+// captureStats.h - Lock-free capture telemetry for X11RegionCapture.
+//
+// The capture thread records, JS reads through getStats(). Everything is a
+// relaxed atomic: a snapshot may mix values from adjacent frames, which is
+// fine for monitoring and keeps the capture path free of locks.
+
+#ifndef CAPTURE_STATS_H
+#define CAPTURE_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+
+namespace capture_stats {
+
+// Bucket i counts samples in [2^(i-1), 2^i) microseconds; bucket 0 is < 1 us.
+// The last bucket also takes everything slower (~4.2 s and up).
+static const int HISTOGRAM_BUCKETS = 24;
+
+inline uint64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() { Reset(); }
+
+    void Record(uint64_t us) {
+        int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+        if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_us.fetch_add(us, std::memory_order_relaxed);
+        uint64_t seen = max_us.load(std::memory_order_relaxed);
+        while (us > seen && !max_us.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {}
+    }
+
+    // Upper bound of the bucket holding the given quantile (0..1).
+    uint64_t QuantileUpperBoundUs(double quantile) const {
+        uint64_t total = count.load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total - 1)) + 1, seen = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank) return 1ULL << i;
+        }
+        return max_us.load(std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        sum_us.store(0, std::memory_order_relaxed);
+        max_us.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count, sum_us, max_us;
+};
+
+// Measures one stage: construct before it, Stop() (or destruct) after it.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(LatencyHistogram& histogram) : histogram(&histogram), start_us(NowUs()) {}
+    ~ScopedTimer() { Stop(); }
+    void Stop() { if (histogram) { histogram->Record(NowUs() - start_us); histogram = nullptr; } }
+private:
+    LatencyHistogram* histogram; uint64_t start_us;
+};
+
+struct CaptureStats {
+    LatencyHistogram grab;      // xcb_shm_get_image request -> reply
+    LatencyHistogram diff;      // DiffFrames / tile diff (0 in fused mode)
+    LatencyHistogram copy;      // Publishing into the double buffer or ring
+    LatencyHistogram interval;  // Time between consecutive published frames
+    std::atomic<uint64_t> frames_published{0};
+    std::atomic<uint64_t> frames_dropped{0};   // Published over a frame nobody fetched
+    std::atomic<uint64_t> grab_failures{0};
+    std::atomic<uint64_t> reconnects{0};
+    std::atomic<uint64_t> last_publish_us{0};
+    // Whether the latest published frame was handed to a reader before the
+    // next one replaced it.
+    std::atomic<bool> frame_fetched{false};
+    // effectiveFps covers the frames published since the previous snapshot.
+    // Only touched by the reading (JS) thread.
+    uint64_t window_start_us = NowUs(), window_frames = 0;
+
+    void Reset() {
+        grab.Reset(); diff.Reset(); copy.Reset(); interval.Reset();
+        frames_published = 0; frames_dropped = 0; grab_failures = 0; reconnects = 0;
+    }
+
+    void RecordFetch() { frame_fetched = true; }
+
+    // Capture thread, once per published frame.
+    void RecordPublish(uint64_t timestamp_us) {
+        bool fetched = frame_fetched.exchange(false);
+        if (frames_published.fetch_add(1) > 0 && !fetched) frames_dropped++;
+        uint64_t last = last_publish_us.exchange(timestamp_us);
+        if (last && timestamp_us > last) interval.Record(timestamp_us - last);
+    }
+
+    double EffectiveFps(uint64_t now_us) const {
+        double elapsed_s = static_cast<double>(now_us - window_start_us) / 1e6;
+        return elapsed_s > 0 ? static_cast<double>(frames_published.load() - window_frames) / elapsed_s : 0.0;
+    }
+    void StartWindow(uint64_t now_us) { window_start_us = now_us; window_frames = frames_published.load(); }
+};
+
+} // namespace capture_stats
+
+#endif // CAPTURE_STATS_H
@@ -0,0 +1,67 @@
+// damageTracker.h - XDamage on the capture target, for damage pacing.
+//
+// With setPacingMode('damage') the capture loop sleeps until the client draws
+// into the window instead of grabbing on a timer. The damage object reports at
+// NON_EMPTY level: one notify, then silence until it is acknowledged (emptied).
+
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
+#include <xcb/damage.h>
+
+namespace damage_tracker {
+
+class DamageTracker {
+public:
+    bool Active() const { return damage != XCB_NONE; }
+
+    // Starts tracking `window`. Without a usable XDamage extension it warns
+    // and returns false, and the caller keeps timed capture.
+    bool Create(xcb_connection_t* connection, xcb_window_t window) {
+        Destroy(connection);
+        const xcb_query_extension_reply_t* extension = xcb_get_extension_data(connection, &xcb_damage_id);
+        if (!extension || !extension->present) { fprintf(stderr, "Warning: XDamage not available, falling back to timed capture.\n"); return false; }
+        xcb_damage_query_version_reply_t* version = xcb_damage_query_version_reply(connection, xcb_damage_query_version(connection, 1, 1), NULL);
+        if (!version) { fprintf(stderr, "Warning: XDamage version query failed, falling back to timed capture.\n"); return false; }
+        free(version);
+        event_base = extension->first_event;
+        damage = xcb_generate_id(connection);
+        xcb_damage_create(connection, damage, window, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+        return true;
+    }
+
+    void Destroy(xcb_connection_t* connection) {
+        if (damage == XCB_NONE) return;
+        if (connection && !xcb_connection_has_error(connection)) { xcb_damage_destroy(connection, damage); xcb_flush(connection); }
+        damage = XCB_NONE;
+    }
+
+    // The connection is gone, and the server-side object with it.
+    void Forget() { damage = XCB_NONE; }
+
+    // True if the event is this object's notify; `area` is then what was drawn.
+    bool IsNotify(const xcb_generic_event_t* event, xcb_rectangle_t& area) const {
+        if (damage == XCB_NONE || (event->response_type & ~0x80) != event_base + XCB_DAMAGE_NOTIFY) return false;
+        const xcb_damage_notify_event_t* notify = reinterpret_cast<const xcb_damage_notify_event_t*>(event);
+        if (notify->damage != damage) return false;
+        area = notify->area;
+        return true;
+    }
+
+    // Empties the damage so the next draw sends a fresh notify.
+    void Acknowledge(xcb_connection_t* connection) {
+        xcb_damage_subtract(connection, damage, XCB_NONE, XCB_NONE);
+        xcb_flush(connection);
+    }
+
+private:
+    xcb_damage_damage_t damage = XCB_NONE;
+    uint8_t event_base = 0;
+};
+
+} // namespace damage_tracker
+
+#endif // DAMAGE_TRACKER_H
@@ -0,0 +1,246 @@
+// frameDiff.h - Finding what changed between two frames.
+//
+// Two modes. Rect mode (DiffFrames) returns coalesced rects covering every
+// changed pixel. Tile mode (TileGrid) flags fixed-size tiles instead: cheaper
+// to compute, and readers get a bitmap of changed tiles (dirtyTiles). Tile
+// mode can also run fused with the publish copy (TileGrid::FusedCopyDiff),
+// hashing each tile's content on the way.
+
+#ifndef FRAME_DIFF_H
+#define FRAME_DIFF_H
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <emmintrin.h>
+
+#include "frameUpdate.h"
+#include "pixelKernels.h"
+
+namespace frame_diff {
+
+using frame_update::Rect;
+using frame_update::CapturedArea;
+
+// Extends the open rect overlapping [start_x, end_x) on the row above down by
+// one row, or opens a new one. Rects carried over go to new_active_rects.
+inline void CoalesceSegment(int start_x, int end_x, int y, std::vector<Rect>& active_rects, std::vector<Rect>& new_active_rects) {
+    bool merged = false;
+    for (auto it = active_rects.begin(); it != active_rects.end(); ) {
+        if (start_x < it->x + it->width && end_x > it->x) {
+            int new_x = std::min(start_x, it->x);
+            it->width = std::max(end_x, it->x + it->width) - new_x;
+            it->x = new_x;
+            it->height++;
+            new_active_rects.push_back(*it);
+            it = active_rects.erase(it);
+            merged = true;
+            break;
+        } else {
+            ++it;
+        }
+    }
+    if (!merged) {
+        new_active_rects.push_back({start_x, y, end_x - start_x, 1});
+    }
+}
+
+// First pixel at or after `from` whose bit equals `set`, or `limit`.
+inline int FindDiffBit(const uint64_t* bits, int from, int limit, bool set) {
+    if (from >= limit) return limit;
+    size_t w = static_cast<size_t>(from) >> 6;
+    uint64_t word = (set ? bits[w] : ~bits[w]) & (~0ULL << (from & 63));
+    while (!word) {
+        if (++w * 64 >= static_cast<size_t>(limit)) return limit;
+        word = set ? bits[w] : ~bits[w];
+    }
+    return std::min(limit, static_cast<int>(w * 64 + __builtin_ctzll(word)));
+}
+
+// Rects covering every changed pixel. Unchanged rows are skipped with memcmp;
+// changed rows are turned into a diff bitmap by the widest diffPixels kernel
+// and its runs coalesced with the rects still open from the row above.
+inline void DiffFrames(const uint8_t* prev_frame, size_t prev_stride, const uint8_t* curr_frame, size_t curr_stride, int width, int height, std::vector<Rect>& out_rects) {
+    out_rects.clear();
+    if (!prev_frame || !curr_frame) {
+        out_rects.push_back({0, 0, width, height});
+        return;
+    }
+    const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+    const size_t row_bytes = static_cast<size_t>(width) * 4;
+    std::vector<uint64_t> diff_bits((static_cast<size_t>(width) + 63) / 64);
+    std::vector<Rect> active_rects, new_active_rects;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* p1_row = prev_frame + y * prev_stride;
+        const uint8_t* p2_row = curr_frame + y * curr_stride;
+        if (memcmp(p1_row, p2_row, row_bytes) == 0) {
+            for (const auto& rect : active_rects) out_rects.push_back(rect);
+            active_rects.clear();
+            continue;
+        }
+        kernels.diffPixels(p2_row, static_cast<uint32_t>(width), p1_row, diff_bits.data());
+        new_active_rects.clear();
+        for (int x = FindDiffBit(diff_bits.data(), 0, width, true); x < width;) {
+            const int end_x = FindDiffBit(diff_bits.data(), x, width, false);
+            CoalesceSegment(x, end_x, y, active_rects, new_active_rects);
+            x = FindDiffBit(diff_bits.data(), end_x, width, true);
+        }
+        for (const auto& rect : active_rects) out_rects.push_back(rect);
+        active_rects.swap(new_active_rects);
+    }
+    for (const auto& rect : active_rects) out_rects.push_back(rect);
+}
+
+// Per-pixel lane hash (pixelKernels.h hashLanes): pixel i of a tile row goes
+// to lane i % 8, so every SIMD level produces the same value.
+static const uint32_t TILE_HASH_LANE_PRIME = 0x9E3779B1u;
+static const uint64_t TILE_HASH_SEED = 0xCBF29CE484222325ULL;
+inline uint64_t FoldTileHashRow(uint64_t tile_hash, const uint32_t lanes[8]) {
+    uint64_t row = TILE_HASH_SEED;
+    for (int k = 0; k < 8; ++k) row = (row ^ lanes[k]) * 0x100000001B3ULL;
+    tile_hash = (tile_hash ^ row) * 0x9E3779B97F4A7C15ULL;
+    return tile_hash ^ (tile_hash >> 29);
+}
+
+// Copies one row into the target with non-temporal stores once the
+// destination is 16-byte aligned (frames start 8 bytes past an aligned base).
+// SSE2 is baseline x86-64; wider streaming stores write no faster to memory.
+// The caller issues _mm_sfence() before publishing the target.
+inline void StreamRow(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    while ((reinterpret_cast<uintptr_t>(dst) & 15) && bytes >= 4) {
+        memcpy(dst, src, 4); dst += 4; src += 4; bytes -= 4;
+    }
+    for (; bytes >= 16; bytes -= 16, dst += 16, src += 16) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+    memcpy(dst, src, bytes);
+}
+
+// Dirty state as a columns * rows grid of size x size tiles. flags is the
+// per-tick scratch (one byte per tile); frame_bits holds the tiles this tick
+// dirtied and bitmap their OR since the last read (one bit per tile,
+// row-major). Not thread-safe: the owner serialises access.
+struct TileGrid {
+    int size = 0; // 0: rect mode
+    uint32_t columns = 0, rows = 0;
+    std::vector<uint8_t> flags;
+    std::vector<uint64_t> frame_bits, bitmap;
+    // Per-tile content hashes of the frame being written and of the last
+    // published one; only kept when the grid was sized with hashes.
+    std::vector<uint64_t> hashes, published_hashes;
+
+    size_t Count() const { return static_cast<size_t>(columns) * rows; }
+
+    void Resize(uint32_t width, uint32_t height, bool with_hashes) {
+        if (size <= 0) { columns = rows = 0; flags.clear(); frame_bits.clear(); bitmap.clear(); hashes.clear(); published_hashes.clear(); return; }
+        columns = (width + size - 1) / size;
+        rows = (height + size - 1) / size;
+        const size_t tile_count = Count();
+        flags.assign(tile_count, 0);
+        frame_bits.assign((tile_count + 63) / 64, 0);
+        bitmap.assign((tile_count + 63) / 64, 0);
+        hashes.assign(with_hashes ? tile_count : 0, 0);
+        published_hashes.assign(hashes.size(), 0);
+    }
+
+    // Flags every tile the area touches whose pixels differ from the previous
+    // frame. One pass over the rows, no allocation; a tile already flagged on
+    // an earlier row is not compared again.
+    void Diff(const uint8_t* prev_frame, size_t prev_stride, const CapturedArea& area) {
+        const int x_end = area.rect.x + area.rect.width;
+        const int first_tx = area.rect.x / size, last_tx = (x_end - 1) / size;
+        const int first_ty = area.rect.y / size, last_ty = (area.rect.y + area.rect.height - 1) / size;
+        for (int ty = first_ty; ty <= last_ty; ++ty) {
+            memset(&flags[static_cast<size_t>(ty) * columns + first_tx], 0, last_tx - first_tx + 1);
+        }
+        for (int y = 0; y < area.rect.height; ++y) {
+            const int frame_y = area.rect.y + y;
+            uint8_t* row_flags = &flags[static_cast<size_t>(frame_y / size) * columns];
+            const uint8_t* prev_row = prev_frame + static_cast<size_t>(frame_y) * prev_stride;
+            const uint8_t* curr_row = area.data + static_cast<size_t>(y) * area.stride - static_cast<size_t>(area.rect.x) * 4;
+            for (int tx = first_tx; tx <= last_tx; ++tx) {
+                if (row_flags[tx]) continue;
+                const int x0 = std::max(tx * size, area.rect.x), x1 = std::min((tx + 1) * size, x_end);
+                if (memcmp(prev_row + x0 * 4, curr_row + x0 * 4, static_cast<size_t>(x1 - x0) * 4) != 0) row_flags[tx] = 1;
+            }
+        }
+    }
+
+    // Turns the area's flagged tiles into rects (runs of dirty tiles per tile
+    // row, clipped to the area, area-relative) and records them in frame_bits.
+    void Collect(const CapturedArea& area, std::vector<Rect>& out_rects) {
+        out_rects.clear();
+        const int x_end = area.rect.x + area.rect.width, y_end = area.rect.y + area.rect.height;
+        const int first_tx = area.rect.x / size, last_tx = (x_end - 1) / size;
+        const int first_ty = area.rect.y / size, last_ty = (y_end - 1) / size;
+        for (int ty = first_ty; ty <= last_ty; ++ty) {
+            const size_t row = static_cast<size_t>(ty) * columns;
+            const int y0 = std::max(ty * size, area.rect.y), y1 = std::min((ty + 1) * size, y_end);
+            int run_start = -1;
+            for (int tx = first_tx; tx <= last_tx + 1; ++tx) {
+                bool dirty = tx <= last_tx && flags[row + tx];
+                if (dirty) {
+                    frame_bits[(row + tx) >> 6] |= 1ULL << ((row + tx) & 63);
+                    if (run_start < 0) run_start = tx;
+                } else if (run_start >= 0) {
+                    const int x0 = std::max(run_start * size, area.rect.x), x1 = std::min(tx * size, x_end);
+                    out_rects.push_back({x0 - area.rect.x, y0 - area.rect.y, x1 - x0, y1 - y0});
+                    run_start = -1;
+                }
+            }
+        }
+    }
+
+    // Fused mode: one pass per captured row compares each tile segment with
+    // the previous frame and hashes it while the row is hot in L1, then
+    // streams the row out to the target. Without a previous frame every tile
+    // is flagged. Hashes cover the tile's pixels inside the frame; a tile that
+    // a region only partly covers keeps a hash of just the captured part.
+    // Needs a grid sized with hashes.
+    void FusedCopyDiff(const uint8_t* prev_frame, uint8_t* target, size_t frame_stride, const CapturedArea& area) {
+        const int x_end = area.rect.x + area.rect.width;
+        const int first_tx = area.rect.x / size, last_tx = (x_end - 1) / size;
+        const int first_ty = area.rect.y / size, last_ty = (area.rect.y + area.rect.height - 1) / size;
+        for (int ty = first_ty; ty <= last_ty; ++ty) {
+            const size_t row = static_cast<size_t>(ty) * columns;
+            memset(&flags[row + first_tx], prev_frame ? 0 : 1, last_tx - first_tx + 1);
+            std::fill(hashes.begin() + row + first_tx, hashes.begin() + row + last_tx + 1, TILE_HASH_SEED);
+        }
+        const size_t row_bytes = static_cast<size_t>(area.rect.width) * 4;
+        const pixel_kernels::Kernels& kernels = pixel_kernels::Active();
+        for (int y = 0; y < area.rect.height; ++y) {
+            const int frame_y = area.rect.y + y;
+            const size_t tile_row = static_cast<size_t>(frame_y / size) * columns;
+            const uint8_t* curr_row = area.data + static_cast<size_t>(y) * area.stride - static_cast<size_t>(area.rect.x) * 4;
+            const uint8_t* prev_row = prev_frame ? prev_frame + static_cast<size_t>(frame_y) * frame_stride : nullptr;
+            for (int tx = first_tx; tx <= last_tx; ++tx) {
+                const int x0 = std::max(tx * size, area.rect.x), x1 = std::min((tx + 1) * size, x_end);
+                uint32_t lanes[8];
+                const bool changed = kernels.hashLanes(curr_row + x0 * 4, static_cast<uint32_t>(x1 - x0), prev_row ? prev_row + x0 * 4 : nullptr,
+                                                       TILE_HASH_LANE_PRIME, lanes);
+                if (changed) flags[tile_row + tx] = 1;
+                hashes[tile_row + tx] = FoldTileHashRow(hashes[tile_row + tx], lanes);
+            }
+            StreamRow(target + static_cast<size_t>(frame_y) * frame_stride + static_cast<size_t>(area.rect.x) * 4, area.data + static_cast<size_t>(y) * area.stride, row_bytes);
+        }
+    }
+
+    // The frame was published: its tiles join the unread bitmap and its
+    // hashes become the published ones.
+    void Accumulate() {
+        for (size_t i = 0; i < bitmap.size() && i < frame_bits.size(); ++i) bitmap[i] |= frame_bits[i];
+        if (!hashes.empty()) published_hashes.assign(hashes.begin(), hashes.end());
+    }
+
+    // A full-frame update sets whole words; drops the bits past the last tile.
+    void TrimBitmap() {
+        const size_t tile_count = Count();
+        if (tile_count % 64 && !bitmap.empty()) bitmap.back() &= (1ULL << (tile_count % 64)) - 1;
+    }
+};
+
+} // namespace frame_diff
+
+#endif // FRAME_DIFF_H
@@ -0,0 +1,186 @@
+// frameRecorder.h - Streams published frames to a compressed sequence on disk.
+//
+// The capture thread encodes each frame right after publishing it; a writer
+// thread does the file I/O so a slow disk never stalls capture. replay.js reads
+// the same format back (FrameReplay).
+//
+// File layout (little-endian):
+//   header  "ATFR" magic, u32 version
+//   record  u32 payload_bytes, u8 type, u8[3] reserved, u32 width, u32 height,
+//           u64 timestamp_us, u32 reserved, u32 rect_count,
+//           rect_count * i32[4] {x, y, w, h},
+//           payload (payload_bytes bytes)
+// A key record (type 0) encodes the whole frame; a delta record (type 1) only
+// the pixels inside its rects, row by row, rect by rect. Either way the rects
+// are the frame's dirty rects. Pixels are RLE'd as 32-bit words: a u16 token
+// n < 0x8000 is followed by n + 1 literal pixels, n >= 0x8000 by one pixel
+// repeated (n & 0x7FFF) + 1 times.
+
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace frame_recorder {
+
+static const uint32_t FILE_MAGIC = 0x52465441; // "ATFR"
+static const uint32_t FILE_VERSION = 1;
+static const uint8_t RECORD_KEY = 0;
+static const uint8_t RECORD_DELTA = 1;
+static const size_t RECORD_HEADER_BYTES = 32;
+static const uint32_t MAX_RUN = 0x8000;
+static const uint32_t RUN_FLAG = 0x8000;
+// Encoded records waiting for the writer beyond this are dropped (and the next
+// frame forced to a key record) instead of growing memory without bound.
+static const size_t MAX_QUEUED_BYTES = 256u << 20;
+
+inline void PutU16(std::vector<uint8_t>& out, uint16_t v) { out.push_back(v & 0xFF); out.push_back(v >> 8); }
+inline void PutU32(std::vector<uint8_t>& out, uint32_t v) { for (int i = 0; i < 4; ++i) out.push_back((v >> (i * 8)) & 0xFF); }
+
+// Appends the RLE encoding of `count` pixels to out.
+inline void EncodePixels(const uint32_t* pixels, size_t count, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < count) {
+        size_t run = 1;
+        while (i + run < count && run < MAX_RUN && pixels[i + run] == pixels[i]) ++run;
+        if (run >= 3) {
+            PutU16(out, static_cast<uint16_t>(RUN_FLAG | (run - 1)));
+            PutU32(out, pixels[i]);
+            i += run;
+            continue;
+        }
+        // Literal span up to the next run of 3 identical pixels.
+        size_t end = i + 1;
+        while (end < count && end - i < MAX_RUN &&
+               !(end + 2 < count && pixels[end] == pixels[end + 1] && pixels[end] == pixels[end + 2])) ++end;
+        PutU16(out, static_cast<uint16_t>(end - i - 1));
+        size_t offset = out.size();
+        out.resize(offset + (end - i) * 4);
+        memcpy(out.data() + offset, pixels + i, (end - i) * 4);
+        i = end;
+    }
+}
+
+class FrameRecorder {
+public:
+    ~FrameRecorder() { Stop(); }
+
+    bool IsActive() const { return active.load(std::memory_order_acquire); }
+
+    // Returns an empty string on success, else the reason.
+    std::string Start(const std::string& path, uint32_t keyframe_interval) {
+        Stop();
+        std::lock_guard<std::mutex> record_lock(record_mutex);
+        file = fopen(path.c_str(), "wb");
+        if (!file) return "Cannot open " + path + " for writing";
+        std::vector<uint8_t> header;
+        PutU32(header, FILE_MAGIC); PutU32(header, FILE_VERSION);
+        fwrite(header.data(), 1, header.size(), file);
+        interval = keyframe_interval ? keyframe_interval : 1;
+        since_key = 0; last_width = last_height = 0; force_key = true;
+        frames = 0; bytes_written = header.size(); dropped = 0; queued_bytes = 0;
+        stopping = false;
+        writer = std::thread(&FrameRecorder::WriterLoop, this);
+        active.store(true, std::memory_order_release);
+        return "";
+    }
+
+    // Flushes queued records and closes the file.
+    void Stop() {
+        std::lock_guard<std::mutex> record_lock(record_mutex);
+        if (!writer.joinable()) return;
+        active.store(false, std::memory_order_release);
+        { std::lock_guard<std::mutex> lock(queue_mutex); stopping = true; }
+        queue_cv.notify_one();
+        writer.join();
+        fclose(file); file = nullptr;
+    }
+
+    // Capture thread only. `frame` is the complete published frame (BGRA,
+    // width * 4 stride); rects are its dirty rects.
+    template <typename RectT>
+    void Record(const uint8_t* frame, uint32_t width, uint32_t height, const std::vector<RectT>& rects, bool full_frame, uint64_t timestamp_us) {
+        std::lock_guard<std::mutex> record_lock(record_mutex);
+        if (!active.load(std::memory_order_relaxed)) return;
+        bool key = force_key || full_frame || width != last_width || height != last_height || since_key + 1 >= interval;
+        if (!key && rects.empty()) return;
+        std::vector<uint8_t> record(RECORD_HEADER_BYTES);
+        for (const auto& r : rects) {
+            PutU32(record, static_cast<uint32_t>(r.x)); PutU32(record, static_cast<uint32_t>(r.y));
+            PutU32(record, static_cast<uint32_t>(r.width)); PutU32(record, static_cast<uint32_t>(r.height));
+        }
+        size_t payload_start = record.size();
+        const uint32_t* pixels = reinterpret_cast<const uint32_t*>(frame);
+        if (key) {
+            EncodePixels(pixels, static_cast<size_t>(width) * height, record);
+        } else {
+            for (const auto& r : rects) {
+                for (int y = r.y; y < r.y + r.height; ++y) EncodePixels(pixels + static_cast<size_t>(y) * width + r.x, r.width, record);
+            }
+        }
+        uint32_t payload_bytes = static_cast<uint32_t>(record.size() - payload_start);
+        uint32_t rect_count = static_cast<uint32_t>(rects.size());
+        uint8_t* h = record.data();
+        memcpy(h, &payload_bytes, 4); h[4] = key ? RECORD_KEY : RECORD_DELTA;
+        memcpy(h + 8, &width, 4); memcpy(h + 12, &height, 4); memcpy(h + 16, &timestamp_us, 8);
+        memcpy(h + 28, &rect_count, 4); // 24..27 reserved
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (queued_bytes + record.size() > MAX_QUEUED_BYTES) {
+                // A delta on top of a missing record would replay garbage.
+                ++dropped; force_key = true;
+                return;
+            }
+            queued_bytes += record.size();
+            queue.push_back(std::move(record));
+        }
+        queue_cv.notify_one();
+        force_key = false; last_width = width; last_height = height;
+        since_key = key ? 0 : since_key + 1;
+        ++frames;
+    }
+
+    uint64_t Frames() const { return frames.load(); }
+    uint64_t BytesWritten() const { return bytes_written.load(); }
+    uint64_t Dropped() const { return dropped.load(); }
+
+private:
+    void WriterLoop() {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        for (;;) {
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) break;
+            std::vector<uint8_t> record = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            fwrite(record.data(), 1, record.size(), file);
+            bytes_written += record.size();
+            lock.lock();
+            queued_bytes -= record.size();
+        }
+        fflush(file);
+    }
+
+    // Serialises Record against Start/Stop from the JS thread.
+    std::mutex record_mutex;
+    FILE* file = nullptr;
+    std::atomic<bool> active{false};
+    std::thread writer;
+    std::mutex queue_mutex; std::condition_variable queue_cv;
+    std::deque<std::vector<uint8_t>> queue; size_t queued_bytes = 0; bool stopping = false;
+    uint32_t interval = 1, since_key = 0, last_width = 0, last_height = 0; bool force_key = true;
+    std::atomic<uint64_t> frames{0}, bytes_written{0}, dropped{0};
+};
+
+} // namespace frame_recorder
+
+#endif // FRAME_RECORDER_H
@@ -0,0 +1,188 @@
+// frameRing.h - Layout and seqlock helpers for the SharedArrayBuffer frame ring.
+//
+// The ring lives in memory owned by JS (a SharedArrayBuffer). The capture
+// thread writes each frame straight into the next slot; workers read the
+// latest completed slot in place. Every field is a little-endian int32 so JS
+// can read it with Atomics on an Int32Array. Keep in sync with
+// electron/workers/capture/frameRing.js.
+//
+// Ring header (RING_HEADER_BYTES):
+//   [0] magic  [1] version  [2] slot count  [3] slot stride (bytes)
+//   [4] frame offset within a slot  [5] max dirty rects per slot
+//   [6] latest completed slot (-1 = none)  [7] publish counter
+// Slot:
+//   [0] sequence (odd while being written)  [1] width  [2] height
+//   [3] timestamp us (low)  [4] timestamp us (high)  [5] frame number
+//   [6] dirty rect count (-1 = whole frame)  [7] reserved
+//   [8..] dirty rects as (x, y, width, height)
+//   frame offset: 8-byte (width, height) header + BGRA pixels, the same
+//   layout as the double-buffered image SABs.
+
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+
+#include "frameUpdate.h"
+
+namespace frame_ring {
+
+static const int32_t MAGIC = 0x474E5246; // "FRNG"
+static const int32_t VERSION = 1;
+static const size_t RING_HEADER_BYTES = 64;
+static const int MAX_SLOT_RECTS = 64;
+static const size_t SLOT_RECTS_OFFSET = 32;
+static const size_t FRAME_OFFSET = (SLOT_RECTS_OFFSET + MAX_SLOT_RECTS * 16 + 63) & ~static_cast<size_t>(63);
+static const size_t FRAME_HEADER_SIZE = 8;
+
+enum HeaderWord { H_MAGIC = 0, H_VERSION, H_SLOT_COUNT, H_SLOT_STRIDE, H_FRAME_OFFSET, H_MAX_RECTS, H_LATEST_SLOT, H_PUBLISH_COUNT };
+enum SlotWord { S_SEQUENCE = 0, S_WIDTH, S_HEIGHT, S_TIMESTAMP_LO, S_TIMESTAMP_HI, S_FRAME_NUMBER, S_DIRTY_COUNT };
+
+inline int32_t* Words(uint8_t* p) { return reinterpret_cast<int32_t*>(p); }
+inline const int32_t* Words(const uint8_t* p) { return reinterpret_cast<const int32_t*>(p); }
+
+inline int32_t Load(const int32_t* word) { return __atomic_load_n(word, __ATOMIC_ACQUIRE); }
+inline void Store(int32_t* word, int32_t value) { __atomic_store_n(word, value, __ATOMIC_RELEASE); }
+
+// Seqlock writer side: the sequence is odd while the slot is being written.
+inline int32_t BeginWrite(uint8_t* slot) {
+    int32_t* seq = Words(slot) + S_SEQUENCE;
+    int32_t next = __atomic_load_n(seq, __ATOMIC_RELAXED) | 1;
+    __atomic_store_n(seq, next, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return next;
+}
+inline void EndWrite(uint8_t* slot, int32_t odd_sequence) {
+    Store(Words(slot) + S_SEQUENCE, odd_sequence + 1);
+}
+
+struct SlotHeader {
+    int32_t sequence;
+    uint32_t width;
+    uint32_t height;
+    uint64_t timestamp_us;
+    int32_t frame_number;
+};
+
+// Seqlock reader side. Returns true once the slot was stable across reading
+// its header (or anything else read since BeginRead).
+inline bool EndRead(const uint8_t* slot, int32_t sequence) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(Words(slot) + S_SEQUENCE, __ATOMIC_RELAXED) == sequence;
+}
+// Reads the slot header under the seqlock. Fails while the slot is being
+// written or if the writer got to it during the read.
+inline bool BeginRead(const uint8_t* slot, SlotHeader& header) {
+    const int32_t* words = Words(slot);
+    header.sequence = Load(words + S_SEQUENCE);
+    if (header.sequence & 1) return false;
+    header.width = static_cast<uint32_t>(__atomic_load_n(words + S_WIDTH, __ATOMIC_RELAXED));
+    header.height = static_cast<uint32_t>(__atomic_load_n(words + S_HEIGHT, __ATOMIC_RELAXED));
+    uint32_t lo = static_cast<uint32_t>(__atomic_load_n(words + S_TIMESTAMP_LO, __ATOMIC_RELAXED));
+    uint32_t hi = static_cast<uint32_t>(__atomic_load_n(words + S_TIMESTAMP_HI, __ATOMIC_RELAXED));
+    header.timestamp_us = lo | (static_cast<uint64_t>(hi) << 32);
+    header.frame_number = __atomic_load_n(words + S_FRAME_NUMBER, __ATOMIC_RELAXED);
+    return EndRead(slot, header.sequence);
+}
+
+// The writer's view of a ring laid out in someone else's memory, plus which
+// areas each slot is missing relative to the latest one, so a slot is brought
+// up to date by copying only those and the new frame's dirty rects.
+struct RingWriter {
+    uint8_t* base = nullptr; size_t length = 0;
+    int slot_count = 0; size_t slot_stride = 0; std::atomic<int> latest_slot{-1};
+    uint32_t frame_number = 0;
+    std::vector<std::vector<frame_update::Rect>> stale_rects; std::vector<uint8_t> stale_full;
+
+    uint8_t* Slot(int slot) const { return base + RING_HEADER_BYTES + static_cast<size_t>(slot) * slot_stride; }
+    // The latest frame (its width/height header included), or nullptr.
+    const uint8_t* LatestFrame() const {
+        int slot = latest_slot.load();
+        return slot < 0 ? nullptr : Slot(slot) + FRAME_OFFSET;
+    }
+    size_t MaxFrameBytes() const { return slot_stride - FRAME_OFFSET; }
+
+    // Validates the memory, writes the ring header and empty slots, and points
+    // the writer at it. Returns an error message, or nullptr on success.
+    const char* Format(uint8_t* data, size_t data_length, int slots) {
+        if (slots < 2) return "A frame ring needs at least 2 slots";
+        if (data_length <= RING_HEADER_BYTES) return "Frame ring buffer too small";
+        size_t stride = ((data_length - RING_HEADER_BYTES) / slots) & ~static_cast<size_t>(63);
+        if (stride <= FRAME_OFFSET + FRAME_HEADER_SIZE || stride > INT32_MAX) return "Frame ring slots are too small or too large";
+
+        base = data; length = data_length;
+        slot_count = slots; slot_stride = stride;
+        latest_slot = -1; frame_number = 0;
+        stale_rects.assign(slots, std::vector<frame_update::Rect>());
+        stale_full.assign(slots, 1);
+
+        int32_t* header = Words(base);
+        header[H_MAGIC] = MAGIC; header[H_VERSION] = VERSION;
+        header[H_SLOT_COUNT] = slots; header[H_SLOT_STRIDE] = static_cast<int32_t>(stride);
+        header[H_FRAME_OFFSET] = static_cast<int32_t>(FRAME_OFFSET); header[H_MAX_RECTS] = MAX_SLOT_RECTS;
+        header[H_PUBLISH_COUNT] = 0;
+        for (int i = 0; i < slots; ++i) Words(Slot(i))[S_SEQUENCE] = 0;
+        Store(header + H_LATEST_SLOT, -1);
+        return nullptr;
+    }
+
+    void Detach() {
+        base = nullptr; length = 0; slot_count = 0; slot_stride = 0; latest_slot = -1;
+        stale_rects.clear(); stale_full.clear();
+    }
+
+    // Writes the update into the next slot under its seqlock and publishes it.
+    // write_pixels(pixels, previous, stale_rects, stale_full) fills the slot's
+    // pixels, copying what it is missing from `previous` (the latest frame's
+    // pixels, or nullptr); it may rewrite update.rects, which are read after.
+    template <typename WritePixels>
+    void Write(frame_update::FrameUpdate& update, uint64_t timestamp, size_t max_stale_rects, WritePixels write_pixels) {
+        const int previous_slot = latest_slot.load();
+        const int slot = (previous_slot + 1) % slot_count;
+        uint8_t* slot_ptr = Slot(slot);
+        int32_t* words = Words(slot_ptr);
+        uint8_t* frame = slot_ptr + FRAME_OFFSET;
+        const uint8_t* previous = previous_slot < 0 ? nullptr : Slot(previous_slot) + FRAME_OFFSET + FRAME_HEADER_SIZE;
+
+        int32_t seq = BeginWrite(slot_ptr);
+        memcpy(frame, &update.width, sizeof(uint32_t));
+        memcpy(frame + 4, &update.height, sizeof(uint32_t));
+        write_pixels(frame + FRAME_HEADER_SIZE, previous, stale_rects[slot], stale_full[slot] != 0);
+        const std::vector<frame_update::Rect>& rects = update.rects;
+        words[S_WIDTH] = static_cast<int32_t>(update.width);
+        words[S_HEIGHT] = static_cast<int32_t>(update.height);
+        words[S_TIMESTAMP_LO] = static_cast<int32_t>(timestamp & 0xFFFFFFFFu);
+        words[S_TIMESTAMP_HI] = static_cast<int32_t>(timestamp >> 32);
+        words[S_FRAME_NUMBER] = static_cast<int32_t>(++frame_number);
+        if (update.full_frame || rects.size() > static_cast<size_t>(MAX_SLOT_RECTS)) {
+            words[S_DIRTY_COUNT] = -1;
+        } else {
+            int32_t* out = Words(slot_ptr + SLOT_RECTS_OFFSET);
+            for (size_t i = 0; i < rects.size(); ++i) {
+                out[i * 4 + 0] = rects[i].x; out[i * 4 + 1] = rects[i].y;
+                out[i * 4 + 2] = rects[i].width; out[i * 4 + 3] = rects[i].height;
+            }
+            words[S_DIRTY_COUNT] = static_cast<int32_t>(rects.size());
+        }
+        EndWrite(slot_ptr, seq);
+
+        stale_full[slot] = 0;
+        stale_rects[slot].clear();
+        for (int i = 0; i < slot_count; ++i) {
+            if (i != slot) frame_update::AddStaleRects(stale_rects[i], stale_full[i], update, max_stale_rects);
+        }
+
+        int32_t* header = Words(base);
+        Store(header + H_LATEST_SLOT, slot);
+        __atomic_fetch_add(header + H_PUBLISH_COUNT, 1, __ATOMIC_RELEASE);
+        latest_slot = slot;
+    }
+};
+
+} // namespace frame_ring
+
+#endif // FRAME_RING_H
@@ -0,0 +1,97 @@
+// frameUpdate.h - What one capture tick grabbed, and how it reaches a buffer.
+//
+// A tick grabs one or more areas of the window into SHM and diffs them into
+// dirty rects (frame coordinates). Publish targets (the double buffer, ring
+// slots) are brought up to date by copying only those rects, plus whatever
+// the target missed while other targets were being written ("stale" rects).
+
+#ifndef FRAME_UPDATE_H
+#define FRAME_UPDATE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace frame_update {
+
+struct Rect { int x, y, width, height; };
+
+// A piece of the window grabbed into SHM this tick. The dirty rects found in it
+// are update.rects[first_rect, first_rect + rect_count), in frame coordinates.
+struct CapturedArea { Rect rect; const uint8_t* data; size_t stride; size_t first_rect; size_t rect_count; };
+struct FrameUpdate {
+    uint32_t width = 0, height = 0;
+    bool full_frame = false; // a single area covering the whole window
+    uint64_t grab_us = 0; // When the pixels were requested, if not just now (prefetched grabs)
+    std::vector<CapturedArea> areas;
+    std::vector<Rect> rects;
+};
+
+// Copies frame-coordinate rects from a source whose top-left pixel is (src_x, src_y).
+inline void CopyRects(const uint8_t* src, size_t src_stride, int src_x, int src_y, uint8_t* dst, size_t dst_stride, const Rect* rects, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const Rect& rect = rects[i];
+        const uint8_t* from = src + static_cast<size_t>(rect.y - src_y) * src_stride + static_cast<size_t>(rect.x - src_x) * 4;
+        uint8_t* to = dst + static_cast<size_t>(rect.y) * dst_stride + static_cast<size_t>(rect.x) * 4;
+        const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+        for (int row = 0; row < rect.height; ++row) {
+            memcpy(to + row * dst_stride, from + row * src_stride, row_bytes);
+        }
+    }
+}
+
+// Copies what a publish target is missing relative to `previous` (the last
+// published frame). Skipped for full-frame updates, which overwrite it all.
+inline void CopyStale(uint8_t* target, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full, const FrameUpdate& update) {
+    if (update.full_frame || !previous) return;
+    const size_t stride = static_cast<size_t>(update.width) * 4;
+    if (stale_full) memcpy(target, previous, stride * update.height);
+    else CopyRects(previous, stride, 0, 0, target, stride, stale_rects.data(), stale_rects.size());
+}
+
+// Brings a publish target up to date. The target is missing the stale rects
+// relative to `previous`, which are copied from there; this tick's changes are
+// then copied from the captured SHM areas.
+inline void ApplyFrameUpdate(uint8_t* target, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full, const FrameUpdate& update) {
+    const size_t stride = static_cast<size_t>(update.width) * 4;
+    CopyStale(target, previous, stale_rects, stale_full, update);
+    for (const auto& area : update.areas) {
+        if (update.full_frame) {
+            CopyRects(area.data, area.stride, area.rect.x, area.rect.y, target, stride, &area.rect, 1);
+        } else {
+            CopyRects(area.data, area.stride, area.rect.x, area.rect.y, target, stride, update.rects.data() + area.first_rect, area.rect_count);
+        }
+    }
+}
+
+// A buffer that was not written this tick now also lags by this tick's
+// changes. Past max_rects it is marked as needing a full copy.
+inline void AddStaleRects(std::vector<Rect>& stale_rects, uint8_t& stale_full, const FrameUpdate& update, size_t max_rects) {
+    if (stale_full) return;
+    if (update.full_frame || stale_rects.size() + update.rects.size() > max_rects) {
+        stale_full = 1;
+        stale_rects.clear();
+        return;
+    }
+    stale_rects.insert(stale_rects.end(), update.rects.begin(), update.rects.end());
+}
+
+// Queues this tick's rects for the next reader. Past max_rects the queue
+// collapses into one full-frame rect, so an idle reader cannot make it grow
+// without bound.
+inline void AppendPendingRects(std::vector<Rect>& pending, const FrameUpdate& update, size_t max_rects) {
+    if (update.rects.empty()) return;
+    const Rect whole = {0, 0, (int)update.width, (int)update.height};
+    bool collapsed = pending.size() == 1 && pending[0].x == 0 && pending[0].y == 0 &&
+                     pending[0].width == whole.width && pending[0].height == whole.height;
+    if (collapsed) return;
+    if (update.full_frame || pending.size() + update.rects.size() > max_rects) {
+        pending.assign(1, whole);
+        return;
+    }
+    pending.insert(pending.end(), update.rects.begin(), update.rects.end());
+}
+
+} // namespace frame_update
+
+#endif // FRAME_UPDATE_H
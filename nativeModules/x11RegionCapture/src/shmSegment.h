@@ -0,0 +1,53 @@
+// shmSegment.h - MIT-SHM segments that xcb_shm_get_image grabs into.
+//
+// Segments are sized to the next power of two (at least a page) and marked
+// for removal right after attaching, so they vanish with the process.
+
+#ifndef SHM_SEGMENT_H
+#define SHM_SEGMENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <algorithm>
+
+typedef struct {
+    xcb_shm_seg_t shmseg;
+    uint8_t *data;
+    uint64_t size;
+    int shmid;
+} shm_segment_info_t;
+
+inline void free_segment_info(shm_segment_info_t *segment) { if (segment) free(segment); }
+inline void cleanup_shm(xcb_connection_t *connection, shm_segment_info_t *segment) {
+    if (!segment) return;
+    if (connection && segment->shmseg != XCB_NONE) xcb_shm_detach(connection, segment->shmseg);
+    if (segment->data != nullptr && segment->data != (void*)-1) shmdt(segment->data);
+    free_segment_info(segment);
+}
+inline shm_segment_info_t* init_shm(xcb_connection_t *connection, uint64_t requested_size) {
+    uint64_t size = 1;
+    while (size < requested_size) size *= 2;
+    size = std::max(size, static_cast<uint64_t>(4096));
+
+    shm_segment_info_t *segment = static_cast<shm_segment_info_t*>(malloc(sizeof(shm_segment_info_t)));
+    if (!segment) { perror("Failed to allocate segment info"); return nullptr; }
+    segment->data = nullptr; segment->shmseg = XCB_NONE; segment->shmid = -1; segment->size = 0;
+    segment->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (segment->shmid == -1) { perror("shmget failed"); free_segment_info(segment); return nullptr; }
+    segment->data = static_cast<uint8_t*>(shmat(segment->shmid, nullptr, 0));
+    if (segment->data == reinterpret_cast<void*>(-1)) { perror("shmat failed"); shmctl(segment->shmid, IPC_RMID, nullptr); free_segment_info(segment); return nullptr; }
+    if (shmctl(segment->shmid, IPC_RMID, nullptr) == -1) { perror("shmctl(IPC_RMID) failed"); shmdt(segment->data); free_segment_info(segment); return nullptr; }
+    segment->shmseg = xcb_generate_id(connection);
+    segment->size = size;
+    xcb_void_cookie_t attach_cookie = xcb_shm_attach_checked(connection, segment->shmseg, segment->shmid, 0);
+    xcb_generic_error_t *error = xcb_request_check(connection, attach_cookie);
+    if (error) { fprintf(stderr, "XCB SHM attach failed: error code %d\n", error->error_code); free(error); shmdt(segment->data); free_segment_info(segment); return nullptr; }
+    return segment;
+}
+
+#endif // SHM_SEGMENT_H
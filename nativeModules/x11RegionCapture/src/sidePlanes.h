@@ -0,0 +1,112 @@
+// sidePlanes.h - Derived planes computed from freshly published frames.
+//
+// Detectors that only need coarse data read these instead of the BGRA frame:
+// a luma plane downscaled by 2 or 4, and palette-index planes for fixed
+// regions (e.g. the minimap). Only blocks touched by the frame's dirty rects
+// are recomputed, right after the frame was written, while it is in cache.
+
+#ifndef SIDE_PLANES_H
+#define SIDE_PLANES_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "frameUpdate.h"
+#include "pixelKernels.h"
+
+namespace side_planes {
+
+using frame_update::Rect;
+
+static const uint8_t UNMATCHED_INDEX = 0xFF;
+
+// Recomputes luma blocks [bx0, bx1) x [by0, by1) of a plane downscaled by
+// `scale`. Luma is BT.709 in 8-bit fixed point; each output is the mean over
+// the block's pixels inside the frame.
+inline void UpdateLumaBlocks(const uint8_t* frame, size_t stride, int frame_width, int frame_height, int scale,
+                             uint8_t* plane, int plane_width, int bx0, int by0, int bx1, int by1) {
+    std::vector<uint32_t> sums(bx1 - bx0);
+    for (int by = by0; by < by1; ++by) {
+        std::fill(sums.begin(), sums.end(), 0);
+        const int y0 = by * scale, y1 = std::min(y0 + scale, frame_height);
+        const int x0 = bx0 * scale, x1 = std::min(bx1 * scale, frame_width);
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* p = frame + static_cast<size_t>(y) * stride + static_cast<size_t>(x0) * 4;
+            for (int x = x0; x < x1; ++x, p += 4) {
+                sums[x / scale - bx0] += (54u * p[2] + 183u * p[1] + 19u * p[0]) >> 8;
+            }
+        }
+        uint8_t* out = plane + static_cast<size_t>(by) * plane_width;
+        for (int bx = bx0; bx < bx1; ++bx) {
+            const int cols = std::min(scale, frame_width - bx * scale);
+            out[bx] = static_cast<uint8_t>(sums[bx - bx0] / static_cast<uint32_t>(cols * (y1 - y0)));
+        }
+    }
+}
+
+// Maps one BGRA row to palette indices; keys are 0xRRGGBB. Pixels matching no
+// entry get UNMATCHED_INDEX; a colour listed twice maps to its first entry.
+inline void MapRowToPalette(const uint8_t* bgra_row, int width, const std::vector<uint32_t>& keys, uint8_t* out_row) {
+    pixel_kernels::Active().mapPalette(bgra_row, static_cast<uint32_t>(width), keys.data(), static_cast<uint32_t>(keys.size()), UNMATCHED_INDEX, out_row);
+}
+
+// Luma plane downscaled by `scale` (2 or 4; 0 is off).
+struct LumaPlane {
+    int scale = 0; bool valid = false; uint32_t width = 0, height = 0;
+    std::vector<uint8_t> data; uint64_t timestamp_us = 0;
+
+    void SetScale(int new_scale) {
+        scale = new_scale; valid = false;
+        if (scale == 0) { data.clear(); width = height = 0; }
+    }
+
+    // Recomputes the blocks the frame's dirty rects touch; the whole plane
+    // when it is new, after a resize or for a full frame.
+    void Update(const uint8_t* frame, size_t stride, int frame_width, int frame_height, const std::vector<Rect>& rects, bool full_frame, uint64_t timestamp) {
+        if (scale <= 0) return;
+        const int s = scale;
+        uint32_t plane_w = (frame_width + s - 1) / s, plane_h = (frame_height + s - 1) / s;
+        if (!valid || full_frame || plane_w != width || plane_h != height) {
+            width = plane_w; height = plane_h;
+            data.resize(static_cast<size_t>(plane_w) * plane_h);
+            UpdateLumaBlocks(frame, stride, frame_width, frame_height, s, data.data(), plane_w, 0, 0, plane_w, plane_h);
+            valid = true;
+        } else {
+            for (const auto& r : rects) {
+                UpdateLumaBlocks(frame, stride, frame_width, frame_height, s, data.data(), plane_w,
+                                 r.x / s, r.y / s, (r.x + r.width + s - 1) / s, (r.y + r.height + s - 1) / s);
+            }
+        }
+        timestamp_us = timestamp;
+    }
+};
+
+// Palette-index plane for a fixed window region: one byte per pixel.
+struct PalettePlane {
+    int id; Rect rect; std::vector<uint32_t> keys; std::vector<uint8_t> data;
+    bool valid; uint64_t timestamp_us;
+
+    // Remaps the region when a dirty rect touches it (or it was never mapped).
+    // A region no longer inside the frame becomes invalid.
+    void Update(const uint8_t* frame, size_t stride, int frame_width, int frame_height, const std::vector<Rect>& rects, bool full_frame, uint64_t timestamp) {
+        if (rect.x + rect.width > frame_width || rect.y + rect.height > frame_height) { valid = false; return; }
+        bool touched = !valid || full_frame;
+        for (size_t i = 0; i < rects.size() && !touched; ++i) {
+            const Rect& d = rects[i];
+            touched = d.x < rect.x + rect.width && rect.x < d.x + d.width && d.y < rect.y + rect.height && rect.y < d.y + d.height;
+        }
+        if (touched) {
+            for (int y = 0; y < rect.height; ++y) {
+                MapRowToPalette(frame + static_cast<size_t>(rect.y + y) * stride + static_cast<size_t>(rect.x) * 4, rect.width, keys,
+                                data.data() + static_cast<size_t>(y) * rect.width);
+            }
+            valid = true;
+        }
+        timestamp_us = timestamp;
+    }
+};
+
+} // namespace side_planes
+
+#endif // SIDE_PLANES_H
@@ -0,0 +1,97 @@
+// windowCapture.h - Additional windows captured on the primary's connection.
+//
+// addWindow() windows are grabbed whole on the primary monitor's ticks, each
+// into its own SHM segment. All requests go out before the primary grab and
+// the replies are collected after it, so the round-trips overlap. Each window
+// publishes into its own frame ring; the owner holds a lock around all of it.
+
+#ifndef WINDOW_CAPTURE_H
+#define WINDOW_CAPTURE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <mutex>
+#include <vector>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+#include "shmSegment.h"
+#include "frameUpdate.h"
+#include "frameDiff.h"
+
+namespace window_capture {
+
+using frame_update::Rect;
+using frame_update::FrameUpdate;
+
+struct Window {
+    xcb_window_t id; uint32_t width = 0, height = 0;
+    shm_segment_info_t* shm = nullptr;
+    xcb_shm_get_image_cookie_t cookie; bool requested = false; bool resized = true;
+    // Dirty rects not yet handed to a reader and the ring frame number they
+    // reach, under pending_mutex.
+    std::mutex pending_mutex; std::vector<Rect> pending_rects; uint32_t pending_frame_number = 0;
+
+    // Sends a whole-window grab without waiting for the reply. Skipped when
+    // the size is out of range, the frame would not fit in max_frame_bytes or
+    // no SHM segment can be had.
+    void Request(xcb_connection_t* connection, uint32_t max_dimension, uint64_t max_frame_bytes) {
+        requested = false;
+        if (width < 1 || height < 1 || width > max_dimension || height > max_dimension) return;
+        uint64_t bytes = static_cast<uint64_t>(width) * height * 4;
+        if (bytes > max_frame_bytes) return;
+        if (!shm || shm->size < bytes) {
+            if (shm) cleanup_shm(connection, shm);
+            shm = init_shm(connection, bytes);
+            if (!shm) return;
+        }
+        cookie = xcb_shm_get_image(connection, id, 0, 0, width, height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, shm->shmseg, 0);
+        requested = true;
+    }
+
+    // Waits for the requested grab. False if it failed.
+    bool Receive(xcb_connection_t* connection) {
+        requested = false;
+        xcb_shm_get_image_reply_t* reply = xcb_shm_get_image_reply(connection, cookie, NULL);
+        if (!reply) return false;
+        free(reply);
+        return true;
+    }
+
+    // Describes the received grab as one whole-window area, diffed against
+    // `previous` (the pixels last published for this window, or nullptr).
+    // After a resize, or with more than max_rects rects, it is a full frame.
+    void BuildUpdate(const uint8_t* previous, size_t max_rects, FrameUpdate& update) const {
+        update.width = width; update.height = height;
+        const size_t stride = static_cast<size_t>(width) * 4;
+        update.full_frame = resized || !previous;
+        if (!update.full_frame) {
+            frame_diff::DiffFrames(previous, stride, shm->data, stride, width, height, update.rects);
+            if (update.rects.size() > max_rects) update.full_frame = true;
+        }
+        if (update.full_frame) update.rects.assign(1, {0, 0, (int)width, (int)height});
+        update.areas.push_back({{0, 0, (int)width, (int)height}, shm->data, stride, 0, update.rects.size()});
+    }
+
+    // The connection was lost: the segment is gone and the next grab is whole.
+    void Reset(xcb_connection_t* connection) {
+        if (shm) { cleanup_shm(connection, shm); shm = nullptr; }
+        requested = false; resized = true;
+    }
+
+    // Stops capturing: drops an outstanding grab, the segment and the
+    // StructureNotify subscription.
+    void Release(xcb_connection_t* connection) {
+        if (!connection) { shm = nullptr; return; }
+        if (requested) xcb_discard_reply(connection, cookie.sequence);
+        requested = false;
+        if (shm) { cleanup_shm(connection, shm); shm = nullptr; }
+        uint32_t values[] = { XCB_EVENT_MASK_NO_EVENT };
+        xcb_change_window_attributes(connection, id, XCB_CW_EVENT_MASK, values);
+        xcb_flush(connection);
+    }
+};
+
+} // namespace window_capture
+
+#endif // WINDOW_CAPTURE_H
@@ -1,12 +1,11 @@
-// @x11RegionCapture.cc (Final Corrected Version)
+// x11RegionCapture.cc - N-API X11 window capture over XCB SHM.
 #include <napi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/shm.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <atomic>
@@ -18,48 +17,35 @@
 #include <memory>
 #include <vector>
 #include <condition_variable>
+#include "shmSegment.h"
+#include "frameUpdate.h"
+#include "frameDiff.h"
+#include "frameRing.h"
+#include "captureRegions.h"
+#include "damageTracker.h"
+#include "windowCapture.h"
+#include "captureStats.h"
+#include "sidePlanes.h"
+#include "frameRecorder.h"
+#include "pixelKernels.h"
 
-#ifdef __AVX2__
-#include <immintrin.h>
-#endif
-
-// ... (structs and helper functions are unchanged) ...
-typedef struct {
-    xcb_shm_seg_t shmseg;
-    uint8_t *data;
-    uint64_t size;
-    int shmid;
-} shm_segment_info_t;
-
-void free_segment_info(shm_segment_info_t *segment) { if (segment) free(segment); }
-void cleanup_shm(xcb_connection_t *connection, shm_segment_info_t *segment) {
-    if (!segment) return;
-    if (connection && segment->shmseg != XCB_NONE) xcb_shm_detach(connection, segment->shmseg);
-    if (segment->data != nullptr && segment->data != (void*)-1) shmdt(segment->data);
-    free_segment_info(segment);
-}
-shm_segment_info_t* init_shm(xcb_connection_t *connection, uint64_t requested_size) {
-    uint64_t size = 1;
-    while (size < requested_size) size *= 2;
-    size = std::max(size, static_cast<uint64_t>(4096));
-
-    shm_segment_info_t *segment = static_cast<shm_segment_info_t*>(malloc(sizeof(shm_segment_info_t)));
-    if (!segment) { perror("Failed to allocate segment info"); return nullptr; }
-    segment->data = nullptr; segment->shmseg = XCB_NONE; segment->shmid = -1; segment->size = 0;
-    segment->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
-    if (segment->shmid == -1) { perror("shmget failed"); free_segment_info(segment); return nullptr; }
-    segment->data = static_cast<uint8_t*>(shmat(segment->shmid, nullptr, 0));
-    if (segment->data == reinterpret_cast<void*>(-1)) { perror("shmat failed"); shmctl(segment->shmid, IPC_RMID, nullptr); free_segment_info(segment); return nullptr; }
-    if (shmctl(segment->shmid, IPC_RMID, nullptr) == -1) { perror("shmctl(IPC_RMID) failed"); shmdt(segment->data); free_segment_info(segment); return nullptr; }
-    segment->shmseg = xcb_generate_id(connection);
-    segment->size = size;
-    xcb_void_cookie_t attach_cookie = xcb_shm_attach_checked(connection, segment->shmseg, segment->shmid, 0);
-    xcb_generic_error_t *error = xcb_request_check(connection, attach_cookie);
-    if (error) { fprintf(stderr, "XCB SHM attach failed: error code %d\n", error->error_code); free(error); shmdt(segment->data); free_segment_info(segment); return nullptr; }
-    return segment;
-}
-
-struct Rect { int x, y, width, height; };
+using frame_update::Rect;
+using frame_update::CapturedArea;
+using frame_update::FrameUpdate;
+
+using capture_regions::CaptureRegion;
+
+using side_planes::PalettePlane;
+
+// A frame ring (see frameRing.h) in a SharedArrayBuffer kept alive by ref.
+struct RingState : frame_ring::RingWriter {
+    Napi::ObjectReference ref;
+};
+
+// An additional window (see windowCapture.h) and the ring it publishes into.
+struct WindowCapture : window_capture::Window {
+    RingState ring;
+};
 
 class X11RegionCapture : public Napi::ObjectWrap<X11RegionCapture> {
 public:
@@ -68,11 +54,21 @@ public:
     ~X11RegionCapture();
 
 private:
-    // ... (member variables are unchanged) ...
     static const int MAX_DIMENSION = 32767; static const int DEFAULT_FPS = 60;
     static const int MIN_FPS = 1; static const int MAX_FPS = 1000;
     static const size_t IMAGE_HEADER_SIZE = 8;
+    static const size_t MAX_STALE_RECTS = 256;
+    // Pending dirty rects beyond this collapse into one full-frame rect, so an
+    // idle reader cannot make the queue grow without bound.
+    static const size_t MAX_PENDING_DIRTY_RECTS = 512;
+    static const int MIN_TILE_SIZE = 8; static const int MAX_TILE_SIZE = 256;
+    static const int DAMAGE_IDLE_POLL_MS = 50; // Bounds how long Stop waits on an idle window.
     xcb_connection_t *connection; shm_segment_info_t *shm_segment;
+    // Second SHM segment for pipelined full-window grabs: while the loop is
+    // saturated, the next frame is requested into shm_spare before the current
+    // one is diffed and published; the two segments then swap roles.
+    shm_segment_info_t *shm_spare; bool prefetch_pending; xcb_shm_get_image_cookie_t prefetch_cookie;
+    uint32_t prefetch_width, prefetch_height; uint64_t prefetch_issued_us;
     std::atomic<bool> is_connected; std::atomic<bool> should_capture; std::atomic<bool> is_capturing;
     std::thread capture_thread; xcb_window_t target_window_id;
     std::chrono::microseconds target_frame_time_us; std::string display_name;
@@ -82,35 +78,124 @@ private:
     uint64_t latest_capture_timestamp_us;
     std::atomic<uint32_t> latest_width; std::atomic<uint32_t> latest_height;
     std::vector<Rect> latest_dirty_rects;
+    // Ring mode: the ring frame number latest_dirty_rects reach.
+    uint32_t latest_dirty_frame_number;
+    // Areas the writable buffer is missing relative to the readable one. Only
+    // these (plus the new frame's dirty rects) are copied out of SHM.
+    std::vector<Rect> writable_stale_rects; bool writable_stale_full;
+    // Optional SharedArrayBuffer frame ring (see frameRing.h). When attached the
+    // capture thread publishes into it instead of buffer_a/buffer_b.
+    RingState ring;
+    // Additional windows (addWindow). The capture thread holds windows_mutex
+    // while it touches them; only the JS thread ever owns a shared_ptr copy, so
+    // the ring references are released there.
+    std::mutex windows_mutex; std::vector<std::shared_ptr<WindowCapture>> windows;
+    // Per-region subscriptions. With none registered the whole window is grabbed
+    // at target_frame_time_us; otherwise only due regions are requested.
+    std::mutex regions_mutex; std::vector<CaptureRegion> capture_regions; int next_region_id;
+    // Tile diff mode (tiles.size > 0): dirty state is a tile grid instead of
+    // coalesced spans (see frameDiff.h). Resized, accumulated and read under
+    // buffer_mutex; diffed by the capture thread alone.
+    frame_diff::TileGrid tiles;
+    // Per-area dirty rects while a frame is diffed; kept so the capture
+    // thread does not allocate every tick.
+    std::vector<Rect> area_rects;
+    // Fused mode (tiles only): the publish copy, the tile diff and per-tile
+    // content hashes are computed in one streaming pass over SHM.
+    bool fuse_copy;
+    // Damage pacing: with an XDamage object on the target window the loop
+    // sleeps until the client draws; the frame interval only caps the rate.
+    bool damage_pacing; damage_tracker::DamageTracker damage; bool window_damaged;
+    // Telemetry (see captureStats.h).
+    capture_stats::CaptureStats stats;
+    // Side planes, refreshed from each published frame under planes_mutex.
+    std::mutex planes_mutex; side_planes::LumaPlane luma;
+    std::vector<PalettePlane> palette_planes; int next_palette_plane_id;
+    // startRecording(): published frames are also streamed to disk (see frameRecorder.h).
+    frame_recorder::FrameRecorder recorder;
     std::mutex timing_mutex;
     std::condition_variable cv;
 
-    // ... (unchanged methods) ...
     bool CheckSHM();
     void Connect();
     void Cleanup();
     bool EnsureBufferSizes(uint32_t width, uint32_t height);
-    void CoalesceSegment(int start_x, int end_x, int y, std::vector<Rect>& active_rects, std::vector<Rect>& new_active_rects);
-#ifdef __AVX2__
-    void DiffFramesAVX2(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects);
-#endif
-    void DiffFramesScalar(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects);
-    void DiffFrames(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects);
+    bool EnsureShmSize(uint64_t required_size);
+    bool CaptureWindow(uint32_t width, uint32_t height, FrameUpdate& update, bool prefetch_next);
+    void DiscardPrefetch();
+    bool CaptureDueRegions(uint32_t width, uint32_t height, FrameUpdate& update);
+    void DiffUpdate(const uint8_t* previous, FrameUpdate& update);
+    void PublishToDoubleBuffer(FrameUpdate& update, uint64_t timestamp);
+    void MarkRegionChanges(const FrameUpdate& update, uint64_t timestamp);
+    std::chrono::microseconds TickInterval();
+    void ProcessEvents();
+    bool CreateDamage();
+    void DestroyDamage();
+    void OnDamage(const xcb_rectangle_t& area);
+    bool HasPendingDamage();
+    void UpdateSidePlanes(const FrameUpdate& update, const uint8_t* frame, uint64_t timestamp);
+    void AccumulatePending(const FrameUpdate& update);
+    void PublishToRing(FrameUpdate& update, uint64_t timestamp);
+    void WriteRingSlot(RingState& target_ring, FrameUpdate& update, uint64_t timestamp, bool primary);
+    static const char* FormatRing(RingState& target_ring, Napi::Buffer<uint8_t> buffer, int slot_count);
+    static Napi::Object RingInfo(Napi::Env env, const RingState& target_ring);
+    Napi::Object ReadRingFrame(Napi::Env env, const Napi::CallbackInfo& info, size_t buffer_arg, const RingState& source_ring, std::vector<Rect>& pending_rects, const uint32_t& pending_frame_number, std::mutex& pending_mutex);
+    void IssueWindowRequests();
+    void CollectWindowFrames();
+    void PublishFrame(uint8_t* target, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full, FrameUpdate& update);
     void StopCaptureThread();
     Napi::Value IsConnected(const Napi::CallbackInfo& info);
     Napi::Value StartMonitorInstance(const Napi::CallbackInfo& info);
     Napi::Value StopMonitorInstance(const Napi::CallbackInfo& info);
     Napi::Value GetLatestFrame(const Napi::CallbackInfo& info);
+    Napi::Value GetLatestRingFrame(const Napi::CallbackInfo& info);
+    Napi::Value AttachFrameRing(const Napi::CallbackInfo& info);
+    Napi::Value DetachFrameRing(const Napi::CallbackInfo& info);
+    Napi::Value AddCaptureRegion(const Napi::CallbackInfo& info);
+    Napi::Value RemoveCaptureRegion(const Napi::CallbackInfo& info);
+    void SetRegionStatus(Napi::Env env, Napi::Object result);
+    void SetTileStatus(Napi::Env env, Napi::Object result);
+    Napi::Value SetDiffMode(const Napi::CallbackInfo& info);
+    Napi::Value GetTileHashes(const Napi::CallbackInfo& info);
+    Napi::Value SetPacingMode(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+    Napi::Value AddWindow(const Napi::CallbackInfo& info);
+    Napi::Value RemoveWindow(const Napi::CallbackInfo& info);
+    Napi::Value GetWindowFrame(const Napi::CallbackInfo& info);
+    Napi::Value SetLumaPlane(const Napi::CallbackInfo& info);
+    Napi::Value GetLumaPlane(const Napi::CallbackInfo& info);
+    Napi::Value AddPalettePlane(const Napi::CallbackInfo& info);
+    Napi::Value RemovePalettePlane(const Napi::CallbackInfo& info);
+    Napi::Value GetPalettePlane(const Napi::CallbackInfo& info);
+    Napi::Value StartRecording(const Napi::CallbackInfo& info);
+    Napi::Value StopRecording(const Napi::CallbackInfo& info);
 
     void CaptureLoop();
 };
 
-// ... (Init, constructor, destructor, and other helpers are unchanged) ...
 Napi::Object X11RegionCapture::Init(Napi::Env env, Napi::Object exports) {
     Napi::Function func = DefineClass(env, "X11RegionCapture", {
         InstanceMethod("startMonitorInstance", &X11RegionCapture::StartMonitorInstance),
         InstanceMethod("stopMonitorInstance", &X11RegionCapture::StopMonitorInstance),
         InstanceMethod("getLatestFrame", &X11RegionCapture::GetLatestFrame),
+        InstanceMethod("attachFrameRing", &X11RegionCapture::AttachFrameRing),
+        InstanceMethod("detachFrameRing", &X11RegionCapture::DetachFrameRing),
+        InstanceMethod("addCaptureRegion", &X11RegionCapture::AddCaptureRegion),
+        InstanceMethod("removeCaptureRegion", &X11RegionCapture::RemoveCaptureRegion),
+        InstanceMethod("setDiffMode", &X11RegionCapture::SetDiffMode),
+        InstanceMethod("getTileHashes", &X11RegionCapture::GetTileHashes),
+        InstanceMethod("setPacingMode", &X11RegionCapture::SetPacingMode),
+        InstanceMethod("getStats", &X11RegionCapture::GetStats),
+        InstanceMethod("addWindow", &X11RegionCapture::AddWindow),
+        InstanceMethod("removeWindow", &X11RegionCapture::RemoveWindow),
+        InstanceMethod("getWindowFrame", &X11RegionCapture::GetWindowFrame),
+        InstanceMethod("setLumaPlane", &X11RegionCapture::SetLumaPlane),
+        InstanceMethod("getLumaPlane", &X11RegionCapture::GetLumaPlane),
+        InstanceMethod("addPalettePlane", &X11RegionCapture::AddPalettePlane),
+        InstanceMethod("removePalettePlane", &X11RegionCapture::RemovePalettePlane),
+        InstanceMethod("getPalettePlane", &X11RegionCapture::GetPalettePlane),
+        InstanceMethod("startRecording", &X11RegionCapture::StartRecording),
+        InstanceMethod("stopRecording", &X11RegionCapture::StopRecording),
         InstanceMethod("isConnected", &X11RegionCapture::IsConnected)
     });
     Napi::FunctionReference* constructor = new Napi::FunctionReference();
@@ -121,12 +206,18 @@ Napi::Object X11RegionCapture::Init(Napi::Env env, Napi::Object exports) {
 }
 X11RegionCapture::X11RegionCapture(const Napi::CallbackInfo& info) : Napi::ObjectWrap<X11RegionCapture>(info) {
     connection = nullptr; shm_segment = nullptr; is_connected = false;
+    shm_spare = nullptr; prefetch_pending = false; prefetch_width = 0; prefetch_height = 0; prefetch_issued_us = 0;
     should_capture = false; is_capturing = false; target_window_id = XCB_NONE;
     target_frame_time_us = std::chrono::microseconds(1000000 / 60);
     display_name = "";
     if (info.Length() > 0 && info[0].IsString()) display_name = info[0].As<Napi::String>().Utf8Value();
     readable_buffer_ptr = nullptr; writable_buffer_ptr = nullptr; frame_buffer_size = 0;
-    latest_capture_timestamp_us = 0; latest_width = 0; latest_height = 0;
+    latest_capture_timestamp_us = 0; latest_dirty_frame_number = 0; latest_width = 0; latest_height = 0;
+    writable_stale_full = true;
+    next_region_id = 1;
+    fuse_copy = false;
+    damage_pacing = false; window_damaged = false;
+    next_palette_plane_id = 1;
     Connect();
 }
 X11RegionCapture::~X11RegionCapture() { StopCaptureThread(); Cleanup(); }
@@ -148,11 +239,18 @@ void X11RegionCapture::Connect() {
 }
 void X11RegionCapture::Cleanup() {
     StopCaptureThread();
+    DiscardPrefetch();
     if (shm_segment) { cleanup_shm(connection, shm_segment); shm_segment = nullptr; }
+    if (shm_spare) { cleanup_shm(connection, shm_spare); shm_spare = nullptr; }
     { std::lock_guard<std::mutex> lock(buffer_mutex); buffer_a.reset(); buffer_b.reset();
       readable_buffer_ptr = nullptr; writable_buffer_ptr = nullptr; frame_buffer_size = 0;
       latest_dirty_rects.clear();
     }
+    damage.Forget();
+    {
+        std::lock_guard<std::mutex> lock(windows_mutex);
+        for (auto& window : windows) window->Reset(connection);
+    }
     if (connection) { xcb_disconnect(connection); connection = nullptr; }
     is_connected = false; target_window_id = XCB_NONE;
 }
@@ -160,10 +258,19 @@ bool X11RegionCapture::EnsureBufferSizes(uint32_t width, uint32_t height) {
     if (!connection) return false;
     uint64_t required_shm_size = static_cast<uint64_t>(width) * height * 4;
     uint64_t required_frame_buffer_size = required_shm_size + IMAGE_HEADER_SIZE;
-    if (!shm_segment || shm_segment->size < required_shm_size) {
-        if (shm_segment) cleanup_shm(connection, shm_segment);
-        shm_segment = init_shm(connection, required_shm_size);
-        if (!shm_segment) { fprintf(stderr, "Error: Failed to initialize SHM segment.\n"); return false; }
+    if (!EnsureShmSize(required_shm_size)) return false;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        tiles.Resize(width, height, fuse_copy);
+    }
+    if (ring.base) {
+        // Frames go straight into the ring; every slot needs a full copy after a resize.
+        if (required_frame_buffer_size > ring.MaxFrameBytes()) {
+            fprintf(stderr, "Error: Frame %ux%u does not fit in a frame ring slot.\n", width, height);
+            return false;
+        }
+        std::fill(ring.stale_full.begin(), ring.stale_full.end(), 1);
+        return true;
     }
     if (frame_buffer_size < required_frame_buffer_size) {
         std::lock_guard<std::mutex> lock(buffer_mutex);
@@ -177,142 +284,178 @@ bool X11RegionCapture::EnsureBufferSizes(uint32_t width, uint32_t height) {
         readable_buffer_ptr = buffer_a.get(); writable_buffer_ptr = buffer_b.get();
         latest_dirty_rects.clear();
     }
+    writable_stale_rects.clear(); writable_stale_full = true;
     return true;
 }
-void X11RegionCapture::CoalesceSegment(int start_x, int end_x, int y, std::vector<Rect>& active_rects, std::vector<Rect>& new_active_rects) {
-    bool merged = false;
-    for (auto it = active_rects.begin(); it != active_rects.end(); ) {
-        if (start_x < it->x + it->width && end_x > it->x) {
-            int new_x = std::min(start_x, it->x);
-            it->width = std::max(end_x, it->x + it->width) - new_x;
-            it->x = new_x;
-            it->height++;
-            new_active_rects.push_back(*it);
-            it = active_rects.erase(it);
-            merged = true;
-            break;
-        } else {
-            ++it;
-        }
+bool X11RegionCapture::EnsureShmSize(uint64_t required_size) {
+    if (!shm_segment || shm_segment->size < required_size) {
+        if (shm_segment) cleanup_shm(connection, shm_segment);
+        shm_segment = init_shm(connection, required_size);
+        if (!shm_segment) { fprintf(stderr, "Error: Failed to initialize SHM segment.\n"); return false; }
     }
-    if (!merged) {
-        new_active_rects.push_back({start_x, y, end_x - start_x, 1});
-    }
-}
-
-// --- [MODIFIED] --- DiffFrames now writes to an output vector instead of the class member.
-#ifdef __AVX2__
-void X11RegionCapture::DiffFramesAVX2(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects) {
-    out_rects.clear();
-    if (!prev_frame || !curr_frame) {
-        out_rects.push_back({0, 0, width, height});
-        return;
-    }
-    // ... (rest of the function is identical)
-    const int stride = width * 4;
-    const int pixels_per_avx = 8;
-    const int avx_width_limit = width - (width % pixels_per_avx);
-    std::vector<Rect> active_rects;
-    for (int y = 0; y < height; ++y) {
-        const uint8_t* p1_row = prev_frame + y * stride;
-        const uint8_t* p2_row = curr_frame + y * stride;
-        if (memcmp(p1_row, p2_row, stride) == 0) {
-            for (const auto& rect : active_rects) out_rects.push_back(rect);
-            active_rects.clear();
-            continue;
-        }
-        std::vector<Rect> new_active_rects;
-        int current_dirty_start_x = -1;
-        for (int x = 0; x < avx_width_limit; x += pixels_per_avx) {
-            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1_row + x * 4));
-            __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p2_row + x * 4));
-            int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(v1, v2));
-            bool all_same = (mask == 0xFFFFFFFF);
-            if (!all_same && current_dirty_start_x == -1) {
-                current_dirty_start_x = x;
-            } else if (all_same && current_dirty_start_x != -1) {
-                CoalesceSegment(current_dirty_start_x, x, y, active_rects, new_active_rects);
-                current_dirty_start_x = -1;
-            }
-        }
-        for (int x = avx_width_limit; x < width; ++x) {
-            bool pixel_diff = (*reinterpret_cast<const uint32_t*>(p1_row + x * 4) != *reinterpret_cast<const uint32_t*>(p2_row + x * 4));
-            if (pixel_diff && current_dirty_start_x == -1) {
-                current_dirty_start_x = x;
-            } else if (!pixel_diff && current_dirty_start_x != -1) {
-                CoalesceSegment(current_dirty_start_x, x, y, active_rects, new_active_rects);
-                current_dirty_start_x = -1;
-            }
+    return true;
+}
+// Writes this tick's pixels into a publish target. The classic path copies
+// only what changed (diffed beforehand); the fused path diffs while copying.
+void X11RegionCapture::PublishFrame(uint8_t* target, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full, FrameUpdate& update) {
+    if (!fuse_copy) { frame_update::ApplyFrameUpdate(target, previous, stale_rects, stale_full, update); return; }
+    const size_t stride = static_cast<size_t>(update.width) * 4;
+    frame_update::CopyStale(target, previous, stale_rects, stale_full, update);
+    const uint8_t* diff_against = update.full_frame ? nullptr : previous;
+    std::fill(tiles.frame_bits.begin(), tiles.frame_bits.end(), 0);
+    update.rects.clear();
+    for (auto& area : update.areas) {
+        area.first_rect = update.rects.size();
+        tiles.FusedCopyDiff(diff_against, target, stride, area);
+        tiles.Collect(area, area_rects);
+        if (update.full_frame) area_rects.assign(1, {0, 0, area.rect.width, area.rect.height});
+        for (const auto& r : area_rects) update.rects.push_back({r.x + area.rect.x, r.y + area.rect.y, r.width, r.height});
+        area.rect_count = update.rects.size() - area.first_rect;
+    }
+    _mm_sfence(); // Order the non-temporal stores before the frame is published.
+}
+void X11RegionCapture::PublishToRing(FrameUpdate& update, uint64_t timestamp) {
+    WriteRingSlot(ring, update, timestamp, true);
+    std::lock_guard<std::mutex> buffer_lock(buffer_mutex);
+    AccumulatePending(update);
+    latest_dirty_frame_number = ring.frame_number;
+    latest_capture_timestamp_us = timestamp;
+}
+// Additional windows always use the plain rect copy; the primary honours the diff mode.
+void X11RegionCapture::WriteRingSlot(RingState& target_ring, FrameUpdate& update, uint64_t timestamp, bool primary) {
+    target_ring.Write(update, timestamp, MAX_STALE_RECTS, [&](uint8_t* pixels, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full) {
+        if (primary) PublishFrame(pixels, previous, stale_rects, stale_full, update);
+        else frame_update::ApplyFrameUpdate(pixels, previous, stale_rects, stale_full, update);
+    });
+}
+void X11RegionCapture::PublishToDoubleBuffer(FrameUpdate& update, uint64_t timestamp) {
+    const uint8_t* previous = readable_buffer_ptr.load();
+    memcpy(writable_buffer_ptr, &update.width, sizeof(uint32_t));
+    memcpy(writable_buffer_ptr + 4, &update.height, sizeof(uint32_t));
+    PublishFrame(writable_buffer_ptr + IMAGE_HEADER_SIZE, previous ? previous + IMAGE_HEADER_SIZE : nullptr, writable_stale_rects, writable_stale_full, update);
+    // After the swap below, the other buffer misses exactly this tick's changes.
+    writable_stale_rects.clear();
+    uint8_t stale_full = 0;
+    frame_update::AddStaleRects(writable_stale_rects, stale_full, update, MAX_STALE_RECTS);
+    writable_stale_full = stale_full != 0;
+
+    std::lock_guard<std::mutex> buffer_lock(buffer_mutex);
+    // Accumulate: the reader may not have taken the previous rects yet.
+    AccumulatePending(update);
+    uint8_t* previously_readable = readable_buffer_ptr.exchange(writable_buffer_ptr);
+    writable_buffer_ptr = previously_readable;
+    latest_capture_timestamp_us = timestamp;
+}
+// With prefetch_next the following frame is requested into the spare segment
+// before returning, so its round-trip overlaps this frame's diff and publish.
+// A pending prefetch of the same size is consumed instead of a new request.
+bool X11RegionCapture::CaptureWindow(uint32_t width, uint32_t height, FrameUpdate& update, bool prefetch_next) {
+    capture_stats::ScopedTimer grab_timer(stats.grab);
+    xcb_shm_get_image_reply_t *img_reply;
+    if (prefetch_pending && prefetch_width == width && prefetch_height == height) {
+        prefetch_pending = false;
+        std::swap(shm_segment, shm_spare);
+        img_reply = xcb_shm_get_image_reply(connection, prefetch_cookie, NULL);
+        update.grab_us = prefetch_issued_us;
+    } else {
+        DiscardPrefetch();
+        xcb_shm_get_image_cookie_t img_cookie = xcb_shm_get_image(
+            connection, target_window_id, 0, 0, width, height, ~0,
+            XCB_IMAGE_FORMAT_Z_PIXMAP, shm_segment->shmseg, 0);
+        img_reply = xcb_shm_get_image_reply(connection, img_cookie, NULL);
+    }
+    grab_timer.Stop();
+    if (!img_reply) { stats.grab_failures++; return false; }
+    free(img_reply);
+
+    uint64_t bytes = static_cast<uint64_t>(width) * height * 4;
+    if (prefetch_next) {
+        if (!shm_spare || shm_spare->size < bytes) {
+            if (shm_spare) cleanup_shm(connection, shm_spare);
+            shm_spare = init_shm(connection, bytes);
         }
-        if (current_dirty_start_x != -1) {
-            CoalesceSegment(current_dirty_start_x, width, y, active_rects, new_active_rects);
+        if (shm_spare) {
+            prefetch_cookie = xcb_shm_get_image(connection, target_window_id, 0, 0, width, height, ~0,
+                                                XCB_IMAGE_FORMAT_Z_PIXMAP, shm_spare->shmseg, 0);
+            xcb_flush(connection);
+            prefetch_pending = true; prefetch_width = width; prefetch_height = height;
+            prefetch_issued_us = capture_stats::NowUs();
         }
-        for (const auto& rect : active_rects) out_rects.push_back(rect);
-        active_rects = new_active_rects;
-    }
-    for (const auto& rect : active_rects) out_rects.push_back(rect);
-}
-#endif
-void X11RegionCapture::DiffFramesScalar(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects) {
-    out_rects.clear();
-    if (!prev_frame || !curr_frame) {
-        out_rects.push_back({0, 0, width, height});
-        return;
-    }
-    // ... (rest of the function is identical)
-    const int stride = width * 4;
-    std::vector<Rect> active_rects;
-    for (int y = 0; y < height; ++y) {
-        const uint8_t* p1_row = prev_frame + y * stride;
-        const uint8_t* p2_row = curr_frame + y * stride;
-        if (memcmp(p1_row, p2_row, stride) == 0) {
-            for (const auto& rect : active_rects) out_rects.push_back(rect);
-            active_rects.clear();
-            continue;
+    }
+    update.areas.push_back({{0, 0, (int)width, (int)height}, shm_segment->data, static_cast<size_t>(width) * 4, 0, 0});
+    window_damaged = false;
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    for (auto& region : capture_regions) region.damaged = false;
+    return true;
+}
+void X11RegionCapture::DiscardPrefetch() {
+    if (!prefetch_pending) return;
+    prefetch_pending = false;
+    if (connection) xcb_discard_reply(connection, prefetch_cookie.sequence);
+}
+// Requests every due region into its own slice of the SHM segment, then
+// collects the replies, so the X round-trips overlap.
+bool X11RegionCapture::CaptureDueRegions(uint32_t width, uint32_t height, FrameUpdate& update) {
+    struct PendingArea { Rect rect; uint64_t offset; xcb_shm_get_image_cookie_t cookie; };
+    std::vector<PendingArea> pending;
+    uint64_t shm_bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(regions_mutex);
+        for (const auto& rect : capture_regions::TakeDue(capture_regions, width, height, damage.Active(), std::chrono::steady_clock::now())) {
+            pending.push_back({rect, 0, {}});
         }
-        std::vector<Rect> new_active_rects;
-        int x = 0;
-        while (x < width) {
-            const uint64_t* p1_64 = reinterpret_cast<const uint64_t*>(p1_row + x * 4);
-            const uint64_t* p2_64 = reinterpret_cast<const uint64_t*>(p2_row + x * 4);
-            int start_x = -1;
-            while (x < width) {
-                if (x + 1 < width) {
-                    if (*p1_64 != *p2_64) { start_x = x; break; }
-                    p1_64++; p2_64++; x += 2;
-                } else {
-                    if (*reinterpret_cast<const uint32_t*>(p1_64) != *reinterpret_cast<const uint32_t*>(p2_64)) { start_x = x; }
-                    x++; break;
-                }
-            }
-            if (start_x == -1) break;
-            int end_x = start_x;
-            while (x < width) {
-                if (x + 1 < width) {
-                    if (*p1_64 == *p2_64) { end_x = x; break; }
-                    p1_64++; p2_64++; x += 2;
-                } else {
-                    if (*reinterpret_cast<const uint32_t*>(p1_64) == *reinterpret_cast<const uint32_t*>(p2_64)) { end_x = x; } else { end_x = x + 1; }
-                    x++; break;
-                }
-            }
-            if (end_x <= start_x) end_x = width;
-            CoalesceSegment(start_x, end_x, y, active_rects, new_active_rects);
-            x = end_x;
+    }
+    for (auto& area : pending) {
+        area.offset = shm_bytes;
+        shm_bytes += (static_cast<uint64_t>(area.rect.width) * area.rect.height * 4 + 63) & ~static_cast<uint64_t>(63);
+    }
+    DiscardPrefetch();
+    if (pending.empty() || !EnsureShmSize(shm_bytes)) return false;
+    capture_stats::ScopedTimer grab_timer(stats.grab);
+    for (auto& area : pending) {
+        area.cookie = xcb_shm_get_image(connection, target_window_id, area.rect.x, area.rect.y, area.rect.width, area.rect.height, ~0,
+                                        XCB_IMAGE_FORMAT_Z_PIXMAP, shm_segment->shmseg, static_cast<uint32_t>(area.offset));
+    }
+    for (auto& area : pending) {
+        xcb_shm_get_image_reply_t *img_reply = xcb_shm_get_image_reply(connection, area.cookie, NULL);
+        if (!img_reply) { stats.grab_failures++; continue; }
+        free(img_reply);
+        update.areas.push_back({area.rect, shm_segment->data + area.offset, static_cast<size_t>(area.rect.width) * 4, 0, 0});
+    }
+    return !update.areas.empty();
+}
+// Diffs every captured area against the last published frame. Areas with too
+// many dirty spans are collapsed into a single rect covering the area.
+void X11RegionCapture::DiffUpdate(const uint8_t* previous, FrameUpdate& update) {
+    const size_t frame_stride = static_cast<size_t>(update.width) * 4;
+    if (tiles.size > 0) std::fill(tiles.frame_bits.begin(), tiles.frame_bits.end(), 0);
+    for (auto& area : update.areas) {
+        area.first_rect = update.rects.size();
+        if (update.full_frame || !previous) {
+            area_rects.assign(1, {0, 0, area.rect.width, area.rect.height});
+        } else if (tiles.size > 0) {
+            tiles.Diff(previous, frame_stride, area);
+            tiles.Collect(area, area_rects);
+        } else {
+            const uint8_t* prev_origin = previous + static_cast<size_t>(area.rect.y) * frame_stride + static_cast<size_t>(area.rect.x) * 4;
+            frame_diff::DiffFrames(prev_origin, frame_stride, area.data, area.stride, area.rect.width, area.rect.height, area_rects);
+            if (area_rects.size() > MAX_STALE_RECTS) area_rects.assign(1, {0, 0, area.rect.width, area.rect.height});
         }
-        for (const auto& rect : active_rects) out_rects.push_back(rect);
-        active_rects = new_active_rects;
+        for (const auto& r : area_rects) update.rects.push_back({r.x + area.rect.x, r.y + area.rect.y, r.width, r.height});
+        area.rect_count = update.rects.size() - area.first_rect;
+    }
+    if (tiles.size > 0 && (update.full_frame || !previous)) {
+        std::fill(tiles.frame_bits.begin(), tiles.frame_bits.end(), ~0ULL);
+    }
+    if (update.rects.size() > MAX_STALE_RECTS && update.areas.size() == 1 && update.areas[0].rect.width == (int)update.width && update.areas[0].rect.height == (int)update.height) {
+        update.full_frame = true;
     }
-    for (const auto& rect : active_rects) out_rects.push_back(rect);
 }
-void X11RegionCapture::DiffFrames(const uint8_t* prev_frame, const uint8_t* curr_frame, int width, int height, std::vector<Rect>& out_rects) {
-#ifdef __AVX2__
-    DiffFramesAVX2(prev_frame, curr_frame, width, height, out_rects);
-#else
-    DiffFramesScalar(prev_frame, curr_frame, width, height, out_rects);
-#endif
+// Caller holds buffer_mutex.
+void X11RegionCapture::AccumulatePending(const FrameUpdate& update) {
+    tiles.Accumulate();
+    frame_update::AppendPendingRects(latest_dirty_rects, update, MAX_PENDING_DIRTY_RECTS);
 }
-
 void X11RegionCapture::CaptureLoop() {
     is_capturing = true;
     bool first_frame = true;
@@ -329,30 +472,40 @@ void X11RegionCapture::CaptureLoop() {
     }
 
     auto next_frame_time = std::chrono::steady_clock::now();
+    std::chrono::microseconds last_processing_time(0);
 
     while (should_capture) {
-        next_frame_time += target_frame_time_us;
+        next_frame_time += TickInterval();
         std::unique_lock<std::mutex> lock(timing_mutex);
         if (!cv.wait_until(lock, next_frame_time, [this]{ return !should_capture.load(); })) {
             if (!should_capture) break;
 
-            // ... (event polling and dimension checking is unchanged) ...
-            xcb_generic_event_t *event;
-            while ((event = xcb_poll_for_event(connection))) {
-                if ((event->response_type & ~0x80) == XCB_CONFIGURE_NOTIFY) {
-                    xcb_configure_notify_event_t *cfg = (xcb_configure_notify_event_t *)event;
-                    if (cfg->window == target_window_id) {
-                        latest_width.store(cfg->width);
-                        latest_height.store(cfg->height);
-                    }
-                }
-                free(event);
-            }
+            ProcessEvents();
             if (!connection || xcb_connection_has_error(connection)) {
+                stats.reconnects++;
                 Connect();
                 std::this_thread::sleep_for(std::chrono::seconds(1));
                 continue;
             }
+            // Damage pacing: the FPS wait above was only the cap; now sleep until
+            // the client has drawn something, then grab right away.
+            // Additional windows are captured on the primary's ticks, so they
+            // keep the timer pacing.
+            bool has_windows;
+            {
+                std::lock_guard<std::mutex> windows_lock(windows_mutex);
+                has_windows = !windows.empty();
+            }
+            if (damage.Active() && !first_frame && !has_windows) {
+                while (should_capture && !HasPendingDamage() && !xcb_connection_has_error(connection)) {
+                    struct pollfd pfd = { xcb_get_file_descriptor(connection), POLLIN, 0 };
+                    poll(&pfd, 1, DAMAGE_IDLE_POLL_MS);
+                    ProcessEvents();
+                }
+                if (!should_capture) break;
+                if (!HasPendingDamage()) continue;
+                next_frame_time = std::max(next_frame_time, std::chrono::steady_clock::now());
+            }
             uint32_t width = latest_width.load();
             uint32_t height = latest_height.load();
             if (width < 1 || height < 1 || width > MAX_DIMENSION || height > MAX_DIMENSION) continue;
@@ -366,51 +519,62 @@ void X11RegionCapture::CaptureLoop() {
                 }
             }
 
-            xcb_shm_get_image_cookie_t img_cookie = xcb_shm_get_image(
-                connection, target_window_id, 0, 0, width, height, ~0,
-                XCB_IMAGE_FORMAT_Z_PIXMAP, shm_segment->shmseg, 0);
-            xcb_shm_get_image_reply_t *img_reply = xcb_shm_get_image_reply(connection, img_cookie, NULL);
-
-            if (img_reply) {
-                uint8_t* bgra_data_from_shm = shm_segment->data;
-                uint64_t bgra_data_size = static_cast<uint64_t>(width) * height * 4;
-                memcpy(writable_buffer_ptr, &width, sizeof(uint32_t));
-                memcpy(writable_buffer_ptr + 4, &height, sizeof(uint32_t));
-                memcpy(writable_buffer_ptr + IMAGE_HEADER_SIZE, bgra_data_from_shm, bgra_data_size);
-                uint64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-
-                std::vector<Rect> current_frame_rects;
-                uint8_t* current_image_data = writable_buffer_ptr + IMAGE_HEADER_SIZE;
-                uint8_t* previous_image_data = readable_buffer_ptr.load();
-                if (previous_image_data) previous_image_data += IMAGE_HEADER_SIZE;
-
-                if (first_frame || dimensions_changed) {
-                    current_frame_rects.push_back({0, 0, (int)width, (int)height});
-                    first_frame = false;
-                } else {
-                    DiffFrames(previous_image_data, current_image_data, width, height, current_frame_rects);
-                }
+            const uint8_t* previous_image_data = ring.base ? ring.LatestFrame() : readable_buffer_ptr.load();
+            if (previous_image_data) previous_image_data += IMAGE_HEADER_SIZE;
 
-                {
-                    std::lock_guard<std::mutex> buffer_lock(buffer_mutex);
-                    // --- [FIXED] --- Accumulate new rects instead of replacing.
-                    if (!current_frame_rects.empty()) {
-                        latest_dirty_rects.insert(latest_dirty_rects.end(), current_frame_rects.begin(), current_frame_rects.end());
-                    }
-
-                    uint8_t* previously_readable = readable_buffer_ptr.exchange(writable_buffer_ptr);
-                    writable_buffer_ptr = previously_readable;
-                    latest_capture_timestamp_us = timestamp;
-                }
+            // The whole window is grabbed when nothing is subscribed, and always
+            // for the first frame after a (re)size so every buffer starts complete.
+            FrameUpdate update;
+            update.width = width; update.height = height;
+            update.full_frame = first_frame || dimensions_changed || !previous_image_data;
+            bool has_regions;
+            {
+                std::lock_guard<std::mutex> regions_lock(regions_mutex);
+                has_regions = !capture_regions.empty();
+            }
+            // Saturated: the next deadline will have passed by the time this
+            // frame is processed, so request the next one now. Damage pacing
+            // wants pixels from after the notify, so it never prefetches.
+            bool prefetch_next = !has_regions && !damage.Active() &&
+                std::chrono::steady_clock::now() + last_processing_time >= next_frame_time + TickInterval();
+            // Other windows' grabs are in flight while the primary one is served.
+            if (has_windows) IssueWindowRequests();
+            bool captured = (update.full_frame || !has_regions)
+                ? CaptureWindow(width, height, update, prefetch_next)
+                : CaptureDueRegions(width, height, update);
+            if (has_windows) CollectWindowFrames();
+            if (!captured) continue;
+            if (update.full_frame) first_frame = false;
 
-                free(img_reply);
+            auto processing_start = std::chrono::steady_clock::now();
+            uint64_t timestamp = update.grab_us ? update.grab_us : std::chrono::duration_cast<std::chrono::microseconds>(processing_start.time_since_epoch()).count();
+            // Diff straight against SHM; the readable buffer holds the last published frame.
+            // In fused mode the diff happens while publishing.
+            if (!fuse_copy) {
+                capture_stats::ScopedTimer diff_timer(stats.diff);
+                DiffUpdate(previous_image_data, update);
             }
+            {
+                capture_stats::ScopedTimer copy_timer(stats.copy);
+                if (ring.base) PublishToRing(update, timestamp);
+                else PublishToDoubleBuffer(update, timestamp);
+            }
+            stats.RecordPublish(timestamp);
+            MarkRegionChanges(update, timestamp);
+            {
+                const uint8_t* published = ring.base ? ring.LatestFrame() : readable_buffer_ptr.load();
+                if (published) UpdateSidePlanes(update, published + IMAGE_HEADER_SIZE, timestamp);
+                if (published && recorder.IsActive()) recorder.Record(published + IMAGE_HEADER_SIZE, update.width, update.height, update.rects, update.full_frame, timestamp);
+            }
+            last_processing_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - processing_start);
         }
     }
+    DiscardPrefetch();
     is_capturing = false;
 }
 
 Napi::Value X11RegionCapture::GetLatestFrame(const Napi::CallbackInfo& info) {
+    if (ring.base) return GetLatestRingFrame(info);
     Napi::Env env = info.Env();
     Napi::Object result = Napi::Object::New(env);
     if (info.Length() < 1 || !info[0].IsBuffer()) { Napi::TypeError::New(env, "Expected a Buffer as the first argument").ThrowAsJavaScriptException(); result.Set("success", Napi::Boolean::New(env, false)); return result; }
@@ -446,19 +610,551 @@ Napi::Value X11RegionCapture::GetLatestFrame(const Napi::CallbackInfo& info) {
             changedRegions[i] = regionObj;
         }
 
-        // --- [FIXED] --- Acknowledge and clear the queue after reading.
+        // The reader has them now.
         latest_dirty_rects.clear();
     }
 
+    stats.RecordFetch();
     result.Set("success", Napi::Boolean::New(env, true));
     result.Set("width", Napi::Number::New(env, width));
     result.Set("height", Napi::Number::New(env, height));
     result.Set("captureTimestampUs", Napi::Number::New(env, static_cast<double>(timestamp)));
     result.Set("changedRegions", changedRegions);
+    SetRegionStatus(env, result);
+    SetTileStatus(env, result);
+    return result;
+}
+
+// In ring mode the frame already lives in shared memory, so the target buffer
+// is optional: without one only the metadata and dirty rects are returned.
+Napi::Value X11RegionCapture::GetLatestRingFrame(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = ReadRingFrame(env, info, 0, ring, latest_dirty_rects, latest_dirty_frame_number, buffer_mutex);
+    if (!result.Get("success").ToBoolean().Value()) return result;
+    stats.RecordFetch();
+    SetRegionStatus(env, result);
+    SetTileStatus(env, result);
+    return result;
+}
+// Reads the latest slot of a ring, optionally copying the frame into the Buffer
+// at info[buffer_arg], and drains the pending dirty rects. frameNumber is the
+// ring frame those rects reach: they cover every change up to that slot's
+// frameNumber, which may be newer or older than the slot read here.
+Napi::Object X11RegionCapture::ReadRingFrame(Napi::Env env, const Napi::CallbackInfo& info, size_t buffer_arg, const RingState& source_ring, std::vector<Rect>& pending_rects, const uint32_t& pending_frame_number, std::mutex& pending_mutex) {
+    using namespace frame_ring;
+    Napi::Object result = Napi::Object::New(env);
+    int slot = source_ring.latest_slot.load();
+    if (slot < 0) { result.Set("success", Napi::Boolean::New(env, false)); return result; }
+
+    const uint8_t* slot_ptr = source_ring.Slot(slot);
+    SlotHeader header;
+    // The writer lapped us onto this slot; report failure rather than a torn header.
+    if (!BeginRead(slot_ptr, header)) {
+        result.Set("success", Napi::Boolean::New(env, false));
+        result.Set("reason", Napi::String::New(env, "Ring slot is being written."));
+        return result;
+    }
+
+    if (info.Length() > buffer_arg && info[buffer_arg].IsBuffer()) {
+        Napi::Buffer<uint8_t> targetBuffer = info[buffer_arg].As<Napi::Buffer<uint8_t>>();
+        uint64_t source_size = static_cast<uint64_t>(header.width) * header.height * 4 + IMAGE_HEADER_SIZE;
+        if (targetBuffer.Length() < source_size) {
+            result.Set("success", Napi::Boolean::New(env, false));
+            result.Set("reason", Napi::String::New(env, "Target buffer too small."));
+            return result;
+        }
+        memcpy(targetBuffer.Data(), slot_ptr + FRAME_OFFSET, source_size);
+        // Same for the pixels: the writer lapped us while copying.
+        if (!EndRead(slot_ptr, header.sequence)) {
+            result.Set("success", Napi::Boolean::New(env, false));
+            result.Set("reason", Napi::String::New(env, "Ring slot is being written."));
+            return result;
+        }
+    }
+
+    Napi::Array changedRegions = Napi::Array::New(env);
+    uint32_t changed_through;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        changed_through = pending_frame_number;
+        for (size_t i = 0; i < pending_rects.size(); ++i) {
+            const auto& rect = pending_rects[i];
+            Napi::Object regionObj = Napi::Object::New(env);
+            regionObj.Set("x", Napi::Number::New(env, rect.x));
+            regionObj.Set("y", Napi::Number::New(env, rect.y));
+            regionObj.Set("width", Napi::Number::New(env, rect.width));
+            regionObj.Set("height", Napi::Number::New(env, rect.height));
+            changedRegions[i] = regionObj;
+        }
+        pending_rects.clear();
+    }
+
+    result.Set("success", Napi::Boolean::New(env, true));
+    result.Set("width", Napi::Number::New(env, header.width));
+    result.Set("height", Napi::Number::New(env, header.height));
+    result.Set("captureTimestampUs", Napi::Number::New(env, static_cast<double>(header.timestamp_us)));
+    result.Set("changedRegions", changedRegions);
+    result.Set("ringSlot", Napi::Number::New(env, slot));
+    result.Set("ringSequence", Napi::Number::New(env, header.sequence));
+    result.Set("frameNumber", Napi::Number::New(env, changed_through));
+    return result;
+}
+
+// attachFrameRing(sharedBufferView, slotCount): formats the ring inside the
+// given view of a SharedArrayBuffer and makes the capture thread write into it.
+Napi::Value X11RegionCapture::AttachFrameRing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsBuffer() || !info[1].IsNumber()) { Napi::TypeError::New(env, "Expected (Buffer, slotCount)").ThrowAsJavaScriptException(); return env.Null(); }
+    if (is_capturing) { Napi::Error::New(env, "Cannot attach a frame ring while monitoring is running").ThrowAsJavaScriptException(); return env.Null(); }
+    const char* error = FormatRing(ring, info[0].As<Napi::Buffer<uint8_t>>(), info[1].As<Napi::Number>().Int32Value());
+    if (error) { Napi::RangeError::New(env, error).ThrowAsJavaScriptException(); return env.Null(); }
+    {
+        // The new ring numbers its frames from 1.
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        latest_dirty_frame_number = 0;
+    }
+    return RingInfo(env, ring);
+}
+// Formats the ring inside the buffer and keeps the buffer alive while the
+// ring points into it. Returns an error message, or nullptr on success.
+const char* X11RegionCapture::FormatRing(RingState& target_ring, Napi::Buffer<uint8_t> ringBuffer, int slot_count) {
+    const char* error = target_ring.Format(ringBuffer.Data(), ringBuffer.Length(), slot_count);
+    if (!error) target_ring.ref = Napi::Persistent(ringBuffer.As<Napi::Object>());
+    return error;
+}
+Napi::Object X11RegionCapture::RingInfo(Napi::Env env, const RingState& target_ring) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("slotCount", Napi::Number::New(env, target_ring.slot_count));
+    result.Set("slotStride", Napi::Number::New(env, static_cast<double>(target_ring.slot_stride)));
+    result.Set("maxFrameBytes", Napi::Number::New(env, static_cast<double>(target_ring.MaxFrameBytes() - frame_ring::FRAME_HEADER_SIZE)));
+    return result;
+}
+Napi::Value X11RegionCapture::DetachFrameRing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (is_capturing) { Napi::Error::New(env, "Cannot detach the frame ring while monitoring is running").ThrowAsJavaScriptException(); return env.Null(); }
+    ring.Detach();
+    ring.ref.Reset();
+    return env.Undefined();
+}
+
+// Without subscriptions the loop runs at the monitor's FPS.
+std::chrono::microseconds X11RegionCapture::TickInterval() {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    return capture_regions::TickInterval(capture_regions, target_frame_time_us);
+}
+void X11RegionCapture::MarkRegionChanges(const FrameUpdate& update, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    capture_regions::MarkChanges(capture_regions, update, timestamp);
+}
+// Adds { id: { changed, captureTimestampUs } } for every subscription and
+// acknowledges the changed flags.
+void X11RegionCapture::SetRegionStatus(Napi::Env env, Napi::Object result) {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    if (capture_regions.empty()) return;
+    Napi::Object regions = Napi::Object::New(env);
+    for (auto& region : capture_regions) {
+        Napi::Object status = Napi::Object::New(env);
+        status.Set("changed", Napi::Boolean::New(env, region.changed));
+        status.Set("captureTimestampUs", Napi::Number::New(env, static_cast<double>(region.last_capture_us)));
+        regions.Set(std::to_string(region.id), status);
+        region.changed = false;
+    }
+    result.Set("regions", regions);
+}
+// In tile mode adds dirtyTiles: { tileSize, columns, rows, bitmap } where bit
+// (ty * columns + tx) of the little-endian bitmap is set if that tile changed
+// since the last read. The bitmap is cleared on read.
+void X11RegionCapture::SetTileStatus(Napi::Env env, Napi::Object result) {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    if (tiles.size <= 0 || tiles.bitmap.empty()) return;
+    Napi::Object dirty = Napi::Object::New(env);
+    dirty.Set("tileSize", Napi::Number::New(env, tiles.size));
+    dirty.Set("columns", Napi::Number::New(env, tiles.columns));
+    dirty.Set("rows", Napi::Number::New(env, tiles.rows));
+    tiles.TrimBitmap();
+    dirty.Set("bitmap", Napi::Buffer<uint8_t>::Copy(env, reinterpret_cast<const uint8_t*>(tiles.bitmap.data()), (tiles.Count() + 7) / 8));
+    result.Set("dirtyTiles", dirty);
+    std::fill(tiles.bitmap.begin(), tiles.bitmap.end(), 0);
+}
+// setDiffMode('rects') | setDiffMode('tiles' | 'fused', tileSize = 16): selects
+// how changes are tracked. 'fused' is tile mode with a single streaming
+// copy + diff + hash pass. Takes effect from the next (re)start of monitoring.
+Napi::Value X11RegionCapture::SetDiffMode(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) { Napi::TypeError::New(env, "Expected ('rects' | 'tiles' | 'fused', tileSize)").ThrowAsJavaScriptException(); return env.Null(); }
+    if (is_capturing) { Napi::Error::New(env, "Cannot change the diff mode while monitoring is running").ThrowAsJavaScriptException(); return env.Null(); }
+    std::string mode = info[0].As<Napi::String>().Utf8Value();
+    if (mode == "rects") { tiles.size = 0; fuse_copy = false; return env.Undefined(); }
+    if (mode != "tiles" && mode != "fused") { Napi::TypeError::New(env, "Unknown diff mode: " + mode).ThrowAsJavaScriptException(); return env.Null(); }
+    int size = (info.Length() > 1 && info[1].IsNumber()) ? info[1].As<Napi::Number>().Int32Value() : 16;
+    if (size < MIN_TILE_SIZE || size > MAX_TILE_SIZE || size % 8 != 0) { Napi::RangeError::New(env, "Tile size must be a multiple of 8 between 8 and 256").ThrowAsJavaScriptException(); return env.Null(); }
+    tiles.size = size;
+    fuse_copy = mode == "fused";
+    return env.Undefined();
+}
+// getTileHashes(): in fused mode, { tileSize, columns, rows, hashes } with one
+// little-endian uint64 content hash per tile (row-major) for the latest
+// published frame, so results can be cached by tile content. Null otherwise.
+Napi::Value X11RegionCapture::GetTileHashes(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    if (!fuse_copy || tiles.published_hashes.empty()) return env.Null();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("tileSize", Napi::Number::New(env, tiles.size));
+    result.Set("columns", Napi::Number::New(env, tiles.columns));
+    result.Set("rows", Napi::Number::New(env, tiles.rows));
+    result.Set("hashes", Napi::Buffer<uint8_t>::Copy(env, reinterpret_cast<const uint8_t*>(tiles.published_hashes.data()), tiles.published_hashes.size() * sizeof(uint64_t)));
+    return result;
+}
+// addCaptureRegion({ x, y, width, height }, fps): subscribes to a window
+// sub-rectangle captured at its own rate. Returns the subscription id.
+Napi::Value X11RegionCapture::AddCaptureRegion(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject()) { Napi::TypeError::New(env, "Expected ({ x, y, width, height }, fps)").ThrowAsJavaScriptException(); return env.Null(); }
+    Napi::Object rectObj = info[0].As<Napi::Object>();
+    Rect rect;
+    rect.x = rectObj.Get("x").As<Napi::Number>().Int32Value();
+    rect.y = rectObj.Get("y").As<Napi::Number>().Int32Value();
+    rect.width = rectObj.Get("width").As<Napi::Number>().Int32Value();
+    rect.height = rectObj.Get("height").As<Napi::Number>().Int32Value();
+    if (rect.x < 0 || rect.y < 0 || rect.width < 1 || rect.height < 1 || rect.x + rect.width > MAX_DIMENSION || rect.y + rect.height > MAX_DIMENSION) {
+        Napi::RangeError::New(env, "Capture region is out of bounds").ThrowAsJavaScriptException(); return env.Null();
+    }
+    uint32_t fps = (info.Length() > 1 && info[1].IsNumber()) ? info[1].As<Napi::Number>().Uint32Value() : DEFAULT_FPS;
+    fps = std::max((uint32_t)MIN_FPS, std::min(fps, (uint32_t)MAX_FPS));
+
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    CaptureRegion region;
+    region.id = next_region_id++;
+    region.rect = rect;
+    region.interval = std::chrono::microseconds(1000000 / fps);
+    region.next_due = std::chrono::steady_clock::now();
+    region.changed = true; // Nothing has been delivered for it yet.
+    region.last_capture_us = 0;
+    region.damaged = true;
+    capture_regions.push_back(region);
+    return Napi::Number::New(env, region.id);
+}
+Napi::Value X11RegionCapture::RemoveCaptureRegion(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Region id (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    auto it = std::find_if(capture_regions.begin(), capture_regions.end(), [id](const CaptureRegion& r) { return r.id == id; });
+    if (it == capture_regions.end()) return Napi::Boolean::New(env, false);
+    capture_regions.erase(it);
+    return Napi::Boolean::New(env, true);
+}
+
+void X11RegionCapture::ProcessEvents() {
+    if (!connection) return;
+    bool acknowledged = false;
+    xcb_generic_event_t *event;
+    xcb_rectangle_t damaged_area;
+    while ((event = xcb_poll_for_event(connection))) {
+        uint8_t type = event->response_type & ~0x80;
+        if (type == XCB_CONFIGURE_NOTIFY) {
+            xcb_configure_notify_event_t *cfg = (xcb_configure_notify_event_t *)event;
+            if (cfg->window == target_window_id) {
+                latest_width.store(cfg->width);
+                latest_height.store(cfg->height);
+            } else {
+                std::lock_guard<std::mutex> lock(windows_mutex);
+                for (auto& window : windows) {
+                    if (window->id != cfg->window || (window->width == cfg->width && window->height == cfg->height)) continue;
+                    window->width = cfg->width; window->height = cfg->height; window->resized = true;
+                }
+            }
+        } else if (damage.IsNotify(event, damaged_area)) {
+            OnDamage(damaged_area); acknowledged = true;
+        }
+        free(event);
+    }
+    if (acknowledged) damage.Acknowledge(connection);
+}
+void X11RegionCapture::OnDamage(const xcb_rectangle_t& area) {
+    window_damaged = true;
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    capture_regions::MarkDamaged(capture_regions, {area.x, area.y, area.width, area.height});
+}
+bool X11RegionCapture::HasPendingDamage() {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    if (capture_regions.empty()) return window_damaged;
+    return capture_regions::AnyDamaged(capture_regions);
+}
+bool X11RegionCapture::CreateDamage() {
+    if (!damage.Create(connection, target_window_id)) return false;
+    window_damaged = true; // Grab once before waiting for the first notify.
+    return true;
+}
+void X11RegionCapture::DestroyDamage() { damage.Destroy(connection); }
+// setPacingMode('timer' | 'damage'): 'damage' captures right after the client
+// draws into the window (XDamage), with the monitor FPS as an upper bound.
+// Takes effect from the next startMonitorInstance.
+Napi::Value X11RegionCapture::SetPacingMode(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) { Napi::TypeError::New(env, "Expected 'timer' | 'damage'").ThrowAsJavaScriptException(); return env.Null(); }
+    if (is_capturing) { Napi::Error::New(env, "Cannot change the pacing mode while monitoring is running").ThrowAsJavaScriptException(); return env.Null(); }
+    std::string mode = info[0].As<Napi::String>().Utf8Value();
+    if (mode != "timer" && mode != "damage") { Napi::TypeError::New(env, "Unknown pacing mode: " + mode).ThrowAsJavaScriptException(); return env.Null(); }
+    damage_pacing = mode == "damage";
+    return env.Undefined();
+}
+
+static Napi::Object HistogramToObject(Napi::Env env, const capture_stats::LatencyHistogram& histogram) {
+    Napi::Object obj = Napi::Object::New(env);
+    uint64_t count = histogram.count.load(std::memory_order_relaxed);
+    obj.Set("count", Napi::Number::New(env, static_cast<double>(count)));
+    obj.Set("meanUs", Napi::Number::New(env, count ? static_cast<double>(histogram.sum_us.load(std::memory_order_relaxed)) / count : 0.0));
+    obj.Set("maxUs", Napi::Number::New(env, static_cast<double>(histogram.max_us.load(std::memory_order_relaxed))));
+    obj.Set("p50Us", Napi::Number::New(env, static_cast<double>(histogram.QuantileUpperBoundUs(0.50))));
+    obj.Set("p99Us", Napi::Number::New(env, static_cast<double>(histogram.QuantileUpperBoundUs(0.99))));
+    Napi::Array buckets = Napi::Array::New(env, capture_stats::HISTOGRAM_BUCKETS);
+    for (int i = 0; i < capture_stats::HISTOGRAM_BUCKETS; ++i) {
+        buckets[i] = Napi::Number::New(env, static_cast<double>(histogram.buckets[i].load(std::memory_order_relaxed)));
+    }
+    obj.Set("log2Buckets", buckets);
+    return obj;
+}
+// getStats({ reset = false }): capture telemetry. Histograms are in
+// microseconds with log2 buckets (bucket i = [2^(i-1), 2^i) us), quantiles are
+// bucket upper bounds. effectiveFps covers the time since the previous call.
+Napi::Value X11RegionCapture::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    bool reset = info.Length() > 0 && info[0].IsObject() && info[0].As<Napi::Object>().Get("reset").ToBoolean().Value();
+    uint64_t now = capture_stats::NowUs();
+    uint64_t published = stats.frames_published.load();
+    double effective_fps = stats.EffectiveFps(now);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("framesPublished", Napi::Number::New(env, static_cast<double>(published)));
+    result.Set("framesDropped", Napi::Number::New(env, static_cast<double>(stats.frames_dropped.load())));
+    result.Set("grabFailures", Napi::Number::New(env, static_cast<double>(stats.grab_failures.load())));
+    result.Set("reconnects", Napi::Number::New(env, static_cast<double>(stats.reconnects.load())));
+    result.Set("effectiveFps", Napi::Number::New(env, effective_fps));
+    result.Set("grab", HistogramToObject(env, stats.grab));
+    result.Set("diff", HistogramToObject(env, stats.diff));
+    result.Set("copy", HistogramToObject(env, stats.copy));
+    result.Set("frameInterval", HistogramToObject(env, stats.interval));
+
+    if (reset) stats.Reset();
+    stats.StartWindow(now);
+    return result;
+}
+
+// Other windows' grabs go out before the primary one's and are collected
+// after it, so the round-trips overlap.
+void X11RegionCapture::IssueWindowRequests() {
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    for (auto& window : windows) window->Request(connection, MAX_DIMENSION, window->ring.MaxFrameBytes() - IMAGE_HEADER_SIZE);
+}
+void X11RegionCapture::CollectWindowFrames() {
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    for (auto& window : windows) {
+        if (!window->requested) continue;
+        if (!window->Receive(connection)) { stats.grab_failures++; continue; }
+        uint64_t timestamp = capture_stats::NowUs();
+
+        FrameUpdate update;
+        const uint8_t* previous = window->ring.LatestFrame();
+        window->BuildUpdate(previous ? previous + IMAGE_HEADER_SIZE : nullptr, MAX_STALE_RECTS, update);
+        WriteRingSlot(window->ring, update, timestamp, false);
+        window->resized = false;
+
+        std::lock_guard<std::mutex> pending_lock(window->pending_mutex);
+        frame_update::AppendPendingRects(window->pending_rects, update, MAX_PENDING_DIRTY_RECTS);
+        window->pending_frame_number = window->ring.frame_number;
+    }
+}
+// addWindow(windowId, ringBuffer, slotCount): also monitors another window on
+// this instance's connection and capture thread, publishing whole frames into
+// its own frame ring. Captured at the primary monitor's rate.
+Napi::Value X11RegionCapture::AddWindow(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsBuffer() || !info[2].IsNumber()) { Napi::TypeError::New(env, "Expected (windowId, Buffer, slotCount)").ThrowAsJavaScriptException(); return env.Null(); }
+    if (!is_connected) { Napi::Error::New(env, "Not connected to X server").ThrowAsJavaScriptException(); return env.Null(); }
+    xcb_window_t window_id = info[0].As<Napi::Number>().Uint32Value();
+    if (window_id == target_window_id) { Napi::Error::New(env, "Window is already the primary capture target").ThrowAsJavaScriptException(); return env.Null(); }
+    {
+        std::lock_guard<std::mutex> lock(windows_mutex);
+        for (const auto& window : windows) {
+            if (window->id == window_id) { Napi::Error::New(env, "Window is already being captured").ThrowAsJavaScriptException(); return env.Null(); }
+        }
+    }
+
+    auto window = std::make_shared<WindowCapture>();
+    window->id = window_id;
+    const char* error = FormatRing(window->ring, info[1].As<Napi::Buffer<uint8_t>>(), info[2].As<Napi::Number>().Int32Value());
+    if (error) { Napi::RangeError::New(env, error).ThrowAsJavaScriptException(); return env.Null(); }
+    xcb_get_geometry_reply_t *geom_reply = xcb_get_geometry_reply(connection, xcb_get_geometry(connection, window_id), NULL);
+    if (!geom_reply) { Napi::Error::New(env, "Window not found").ThrowAsJavaScriptException(); return env.Null(); }
+    window->width = geom_reply->width; window->height = geom_reply->height;
+    free(geom_reply);
+    uint32_t values[] = { XCB_EVENT_MASK_STRUCTURE_NOTIFY };
+    xcb_change_window_attributes(connection, window_id, XCB_CW_EVENT_MASK, values);
+    xcb_flush(connection);
+
+    Napi::Object result = RingInfo(env, window->ring);
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    windows.push_back(window);
+    return result;
+}
+Napi::Value X11RegionCapture::RemoveWindow(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Window ID (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    xcb_window_t window_id = info[0].As<Napi::Number>().Uint32Value();
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    auto it = std::find_if(windows.begin(), windows.end(), [window_id](const std::shared_ptr<WindowCapture>& w) { return w->id == window_id; });
+    if (it == windows.end()) return Napi::Boolean::New(env, false);
+    (*it)->Release(connection);
+    windows.erase(it);
+    return Napi::Boolean::New(env, true);
+}
+// getWindowFrame(windowId, [targetBuffer]): getLatestFrame for a window added
+// with addWindow.
+Napi::Value X11RegionCapture::GetWindowFrame(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Window ID (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    xcb_window_t window_id = info[0].As<Napi::Number>().Uint32Value();
+    std::shared_ptr<WindowCapture> window;
+    {
+        std::lock_guard<std::mutex> lock(windows_mutex);
+        for (const auto& w : windows) if (w->id == window_id) { window = w; break; }
+    }
+    if (!window) { Napi::Error::New(env, "Window is not being captured").ThrowAsJavaScriptException(); return env.Null(); }
+    return ReadRingFrame(env, info, 1, window->ring, window->pending_rects, window->pending_frame_number, window->pending_mutex);
+}
+
+// Refreshes the side planes from the frame just published, touching only the
+// blocks and regions its dirty rects cover.
+void X11RegionCapture::UpdateSidePlanes(const FrameUpdate& update, const uint8_t* frame, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    const size_t stride = static_cast<size_t>(update.width) * 4;
+    luma.Update(frame, stride, update.width, update.height, update.rects, update.full_frame, timestamp);
+    for (auto& plane : palette_planes) plane.Update(frame, stride, update.width, update.height, update.rects, update.full_frame, timestamp);
+}
+// Copies a plane into info[arg] when it is a Buffer, else returns it as `data`.
+static void SetPlaneData(Napi::Env env, const Napi::CallbackInfo& info, size_t arg, Napi::Object result, const std::vector<uint8_t>& data) {
+    if (info.Length() > arg && info[arg].IsBuffer()) {
+        Napi::Buffer<uint8_t> target = info[arg].As<Napi::Buffer<uint8_t>>();
+        if (target.Length() < data.size()) {
+            result.Set("success", Napi::Boolean::New(env, false));
+            result.Set("reason", Napi::String::New(env, "Target buffer too small."));
+            return;
+        }
+        memcpy(target.Data(), data.data(), data.size());
+    } else {
+        result.Set("data", Napi::Buffer<uint8_t>::Copy(env, data.data(), data.size()));
+    }
+    result.Set("success", Napi::Boolean::New(env, true));
+}
+// setLumaPlane(scale): 2 or 4 publishes a luma plane downscaled by that factor
+// next to every frame; 0 turns it off.
+Napi::Value X11RegionCapture::SetLumaPlane(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Scale (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    int scale = info[0].As<Napi::Number>().Int32Value();
+    if (scale != 0 && scale != 2 && scale != 4) { Napi::RangeError::New(env, "Luma plane scale must be 0, 2 or 4").ThrowAsJavaScriptException(); return env.Null(); }
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    luma.SetScale(scale);
+    return env.Undefined();
+}
+// getLumaPlane([targetBuffer]): { success, width, height, scale,
+// captureTimestampUs, data } (data only when no target buffer is given).
+Napi::Value X11RegionCapture::GetLumaPlane(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    if (luma.scale == 0 || !luma.valid) { result.Set("success", Napi::Boolean::New(env, false)); return result; }
+    result.Set("width", Napi::Number::New(env, luma.width));
+    result.Set("height", Napi::Number::New(env, luma.height));
+    result.Set("scale", Napi::Number::New(env, luma.scale));
+    result.Set("captureTimestampUs", Napi::Number::New(env, static_cast<double>(luma.timestamp_us)));
+    SetPlaneData(env, info, 0, result, luma.data);
+    return result;
+}
+// addPalettePlane({ x, y, width, height }, palette): maps the region to one
+// byte per pixel, the index of its colour in palette ([{ r, g, b }, ...], at
+// most 255 entries) or 255 when it matches none. Returns the plane id.
+Napi::Value X11RegionCapture::AddPalettePlane(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray()) { Napi::TypeError::New(env, "Expected ({ x, y, width, height }, palette)").ThrowAsJavaScriptException(); return env.Null(); }
+    Napi::Object rectObj = info[0].As<Napi::Object>();
+    Napi::Array paletteArray = info[1].As<Napi::Array>();
+    PalettePlane plane;
+    plane.rect.x = rectObj.Get("x").As<Napi::Number>().Int32Value();
+    plane.rect.y = rectObj.Get("y").As<Napi::Number>().Int32Value();
+    plane.rect.width = rectObj.Get("width").As<Napi::Number>().Int32Value();
+    plane.rect.height = rectObj.Get("height").As<Napi::Number>().Int32Value();
+    if (plane.rect.x < 0 || plane.rect.y < 0 || plane.rect.width < 1 || plane.rect.height < 1 || plane.rect.x + plane.rect.width > MAX_DIMENSION || plane.rect.y + plane.rect.height > MAX_DIMENSION) {
+        Napi::RangeError::New(env, "Palette plane region is out of bounds").ThrowAsJavaScriptException(); return env.Null();
+    }
+    if (paletteArray.Length() < 1 || paletteArray.Length() >= side_planes::UNMATCHED_INDEX) { Napi::RangeError::New(env, "Palette must have 1 to 254 entries").ThrowAsJavaScriptException(); return env.Null(); }
+    for (uint32_t i = 0; i < paletteArray.Length(); ++i) {
+        Napi::Object color = paletteArray.Get(i).As<Napi::Object>();
+        uint32_t r = color.Get("r").As<Napi::Number>().Uint32Value() & 0xFF;
+        uint32_t g = color.Get("g").As<Napi::Number>().Uint32Value() & 0xFF;
+        uint32_t b = color.Get("b").As<Napi::Number>().Uint32Value() & 0xFF;
+        plane.keys.push_back((r << 16) | (g << 8) | b);
+    }
+    plane.data.assign(static_cast<size_t>(plane.rect.width) * plane.rect.height, side_planes::UNMATCHED_INDEX);
+    plane.valid = false; plane.timestamp_us = 0;
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    plane.id = next_palette_plane_id++;
+    palette_planes.push_back(std::move(plane));
+    return Napi::Number::New(env, palette_planes.back().id);
+}
+Napi::Value X11RegionCapture::RemovePalettePlane(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Plane id (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    auto it = std::find_if(palette_planes.begin(), palette_planes.end(), [id](const PalettePlane& p) { return p.id == id; });
+    if (it == palette_planes.end()) return Napi::Boolean::New(env, false);
+    palette_planes.erase(it);
+    return Napi::Boolean::New(env, true);
+}
+// getPalettePlane(id, [targetBuffer]): { success, x, y, width, height,
+// captureTimestampUs, data } (data only when no target buffer is given).
+Napi::Value X11RegionCapture::GetPalettePlane(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber()) { Napi::TypeError::New(env, "Plane id (Number) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    int id = info[0].As<Napi::Number>().Int32Value();
+    Napi::Object result = Napi::Object::New(env);
+    std::lock_guard<std::mutex> lock(planes_mutex);
+    auto it = std::find_if(palette_planes.begin(), palette_planes.end(), [id](const PalettePlane& p) { return p.id == id; });
+    if (it == palette_planes.end() || !it->valid) { result.Set("success", Napi::Boolean::New(env, false)); return result; }
+    result.Set("x", Napi::Number::New(env, it->rect.x));
+    result.Set("y", Napi::Number::New(env, it->rect.y));
+    result.Set("width", Napi::Number::New(env, it->rect.width));
+    result.Set("height", Napi::Number::New(env, it->rect.height));
+    result.Set("captureTimestampUs", Napi::Number::New(env, static_cast<double>(it->timestamp_us)));
+    SetPlaneData(env, info, 1, result, it->data);
+    return result;
+}
+
+// startRecording(path, [keyframeInterval]): streams every published frame with
+// its dirty rects and timestamp to path; read it back with FrameReplay
+// (replay.js). A key record is written every keyframeInterval frames (300).
+Napi::Value X11RegionCapture::StartRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) { Napi::TypeError::New(env, "Path (String) expected").ThrowAsJavaScriptException(); return env.Null(); }
+    uint32_t keyframe_interval = (info.Length() > 1 && info[1].IsNumber()) ? info[1].As<Napi::Number>().Uint32Value() : 300;
+    std::string error = recorder.Start(info[0].As<Napi::String>().Utf8Value(), keyframe_interval);
+    if (!error.empty()) { Napi::Error::New(env, error).ThrowAsJavaScriptException(); return env.Null(); }
+    return env.Undefined();
+}
+// stopRecording(): flushes and closes the file; returns { frames, bytes, dropped }.
+Napi::Value X11RegionCapture::StopRecording(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    recorder.Stop();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("frames", Napi::Number::New(env, static_cast<double>(recorder.Frames())));
+    result.Set("bytes", Napi::Number::New(env, static_cast<double>(recorder.BytesWritten())));
+    result.Set("dropped", Napi::Number::New(env, static_cast<double>(recorder.Dropped())));
     return result;
 }
 
-// ... (StopMonitorInstance, IsConnected, and module Init are unchanged) ...
 void X11RegionCapture::StopCaptureThread() {
     should_capture = false;
     cv.notify_all();
@@ -481,6 +1177,7 @@ Napi::Value X11RegionCapture::StartMonitorInstance(const Napi::CallbackInfo& inf
 
     uint32_t values[] = { XCB_EVENT_MASK_STRUCTURE_NOTIFY };
     xcb_change_window_attributes(connection, target_window_id, XCB_CW_EVENT_MASK, values);
+    if (damage_pacing) CreateDamage(); else DestroyDamage();
     xcb_flush(connection);
 
     StopCaptureThread(); should_capture = true;
@@ -488,6 +1185,6 @@ Napi::Value X11RegionCapture::StartMonitorInstance(const Napi::CallbackInfo& inf
     catch (const std::system_error& e) { should_capture = false; Napi::Error::New(env, std::string("Failed to create capture thread: ") + e.what()).ThrowAsJavaScriptException(); return env.Null(); }
     return env.Undefined();
 }
-Napi::Value X11RegionCapture::StopMonitorInstance(const Napi::CallbackInfo& info) { StopCaptureThread(); return info.Env().Undefined(); }
+Napi::Value X11RegionCapture::StopMonitorInstance(const Napi::CallbackInfo& info) { StopCaptureThread(); DestroyDamage(); return info.Env().Undefined(); }
 Napi::Object Init(Napi::Env env, Napi::Object exports) { return X11RegionCapture::Init(env, exports); }
 NODE_API_MODULE(x11regioncapture, Init)
\ No newline at end of file
@@ -0,0 +1,182 @@
+// frameDiffTest.cc - Checks the rect, tile and fused diffs in frameDiff.h
+// against a per-pixel comparison.
+//
+// Build and run (no X server or Node needed):
+//   g++ -std=c++17 -O2 -I../src -I../../common frameDiffTest.cc -o frameDiffTest && ./frameDiffTest
+
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+
+#include "frameDiff.h"
+
+using namespace frame_diff;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+static std::mt19937 rng(3);
+
+static const uint8_t* Bytes(const std::vector<uint32_t>& frame) { return reinterpret_cast<const uint8_t*>(frame.data()); }
+
+// A copy of `frame` with a few short horizontal runs of changed pixels.
+static std::vector<uint32_t> Scribble(const std::vector<uint32_t>& frame, int width, int height) {
+    std::vector<uint32_t> out = frame;
+    int runs = rng() % 10;
+    for (int i = 0; i < runs; ++i) {
+        int x = rng() % width, y = rng() % height, length = 1 + rng() % 20;
+        for (int k = 0; k < length && x + k < width; ++k) out[y * width + x + k] ^= 1u << (rng() % 32);
+    }
+    return out;
+}
+
+static void TestDiffFrames() {
+    printf("rects\n");
+    for (int round = 0; round < 2000; ++round) {
+        int width = 1 + rng() % 150, height = 1 + rng() % 20;
+        std::vector<uint32_t> prev(width * height);
+        for (auto& p : prev) p = rng() % 4;
+        std::vector<uint32_t> curr = Scribble(prev, width, height);
+        std::vector<Rect> rects;
+        DiffFrames(Bytes(prev), width * 4, Bytes(curr), width * 4, width, height, rects);
+
+        std::vector<uint8_t> covered(width * height, 0);
+        for (const auto& r : rects) {
+            CHECK(r.x >= 0 && r.y >= 0 && r.x + r.width <= width && r.y + r.height <= height);
+            for (int y = r.y; y < r.y + r.height; ++y) for (int x = r.x; x < r.x + r.width; ++x) covered[y * width + x] = 1;
+            // A single-row rect is one run: it starts and ends on a changed pixel.
+            if (r.height == 1) {
+                CHECK(prev[r.y * width + r.x] != curr[r.y * width + r.x]);
+                CHECK(prev[r.y * width + r.x + r.width - 1] != curr[r.y * width + r.x + r.width - 1]);
+            }
+        }
+        for (int i = 0; i < width * height; ++i) if (prev[i] != curr[i]) CHECK(covered[i]);
+        if (prev == curr) CHECK(rects.empty());
+    }
+    std::vector<Rect> rects;
+    DiffFrames(nullptr, 0, nullptr, 0, 5, 3, rects);
+    CHECK(rects.size() == 1 && rects[0].width == 5 && rects[0].height == 3);
+}
+
+static void TestTiles() {
+    printf("tiles\n");
+    for (int round = 0; round < 500; ++round) {
+        int width = 1 + rng() % 100, height = 1 + rng() % 60;
+        std::vector<uint32_t> prev(width * height);
+        for (auto& p : prev) p = rng() % 4;
+        std::vector<uint32_t> curr = Scribble(prev, width, height);
+
+        TileGrid grid;
+        grid.size = 8 * (1 + rng() % 3);
+        grid.Resize(width, height, false);
+        CHECK(grid.columns == static_cast<uint32_t>((width + grid.size - 1) / grid.size));
+        CHECK(grid.rows == static_cast<uint32_t>((height + grid.size - 1) / grid.size));
+
+        // A captured area somewhere inside the frame, as a region grab would give.
+        int ax = rng() % width, ay = rng() % height;
+        int aw = 1 + rng() % (width - ax), ah = 1 + rng() % (height - ay);
+        CapturedArea area = {{ax, ay, aw, ah}, Bytes(curr) + (static_cast<size_t>(ay) * width + ax) * 4, static_cast<size_t>(width) * 4, 0, 0};
+        std::vector<Rect> rects;
+        grid.Diff(Bytes(prev), width * 4, area);
+        grid.Collect(area, rects);
+
+        // Exactly the tiles with a changed pixel inside the area are set.
+        std::vector<uint8_t> expected(grid.Count(), 0);
+        for (int y = ay; y < ay + ah; ++y) for (int x = ax; x < ax + aw; ++x) {
+            if (prev[y * width + x] != curr[y * width + x]) expected[(y / grid.size) * grid.columns + x / grid.size] = 1;
+        }
+        for (size_t t = 0; t < grid.Count(); ++t) CHECK(((grid.frame_bits[t >> 6] >> (t & 63)) & 1) == expected[t]);
+
+        // The rects cover every changed pixel and stay inside the area.
+        std::vector<uint8_t> covered(width * height, 0);
+        for (const auto& r : rects) {
+            CHECK(r.x >= 0 && r.y >= 0 && r.x + r.width <= aw && r.y + r.height <= ah);
+            for (int y = r.y; y < r.y + r.height; ++y) for (int x = r.x; x < r.x + r.width; ++x) covered[(y + ay) * width + x + ax] = 1;
+        }
+        for (int y = ay; y < ay + ah; ++y) for (int x = ax; x < ax + aw; ++x) {
+            if (prev[y * width + x] != curr[y * width + x]) CHECK(covered[y * width + x]);
+        }
+
+        // Published bits accumulate until read; trimming keeps only real tiles.
+        grid.Accumulate();
+        CHECK(grid.bitmap == grid.frame_bits);
+        std::fill(grid.bitmap.begin(), grid.bitmap.end(), ~0ULL);
+        grid.TrimBitmap();
+        size_t set = 0;
+        for (uint64_t word : grid.bitmap) set += __builtin_popcountll(word);
+        CHECK(set == grid.Count());
+    }
+}
+
+static void TestFused() {
+    printf("fused\n");
+    for (int round = 0; round < 300; ++round) {
+        int width = 1 + rng() % 100, height = 1 + rng() % 60;
+        std::vector<uint32_t> prev(width * height);
+        for (auto& p : prev) p = rng() % 4;
+        std::vector<uint32_t> curr = Scribble(prev, width, height);
+
+        TileGrid plain, fused;
+        plain.size = fused.size = 8 * (1 + rng() % 3);
+        plain.Resize(width, height, false);
+        fused.Resize(width, height, true);
+        int ax = rng() % width, ay = rng() % height;
+        int aw = 1 + rng() % (width - ax), ah = 1 + rng() % (height - ay);
+        CapturedArea area = {{ax, ay, aw, ah}, Bytes(curr) + (static_cast<size_t>(ay) * width + ax) * 4, static_cast<size_t>(width) * 4, 0, 0};
+
+        // The target starts as the previous frame; the area is copied over it.
+        std::vector<uint32_t> target = prev;
+        fused.FusedCopyDiff(Bytes(prev), reinterpret_cast<uint8_t*>(target.data()), width * 4, area);
+        _mm_sfence();
+        plain.Diff(Bytes(prev), width * 4, area);
+        std::vector<Rect> rects;
+        fused.Collect(area, rects);
+        plain.Collect(area, rects);
+        CHECK(fused.frame_bits == plain.frame_bits);
+        for (int y = 0; y < height; ++y) for (int x = 0; x < width; ++x) {
+            bool inside = x >= ax && x < ax + aw && y >= ay && y < ay + ah;
+            CHECK(target[y * width + x] == (inside ? curr : prev)[y * width + x]);
+        }
+
+        // Without a previous frame every touched tile is dirty.
+        TileGrid first = fused;
+        std::fill(first.frame_bits.begin(), first.frame_bits.end(), 0);
+        first.FusedCopyDiff(nullptr, reinterpret_cast<uint8_t*>(target.data()), width * 4, area);
+        first.Collect(area, rects);
+        size_t touched = static_cast<size_t>((ax + aw - 1) / first.size - ax / first.size + 1) * ((ay + ah - 1) / first.size - ay / first.size + 1);
+        size_t set = 0;
+        for (uint64_t word : first.frame_bits) set += __builtin_popcountll(word);
+        CHECK(set == touched);
+        // Same pixels, same hashes, whatever the previous frame was.
+        CHECK(first.hashes == fused.hashes);
+    }
+
+    // Tiles with equal content hash equally; a changed pixel changes the hash.
+    const int size = 16, width = 3 * size, height = size;
+    std::vector<uint32_t> frame(width * height);
+    for (int y = 0; y < height; ++y) for (int x = 0; x < size; ++x) {
+        frame[y * width + x] = frame[y * width + x + size] = frame[y * width + x + 2 * size] = rng();
+    }
+    frame[5 * width + 2 * size + 7] ^= 1;
+    TileGrid grid;
+    grid.size = size;
+    grid.Resize(width, height, true);
+    std::vector<uint32_t> target(width * height);
+    CapturedArea area = {{0, 0, width, height}, Bytes(frame), static_cast<size_t>(width) * 4, 0, 0};
+    grid.FusedCopyDiff(nullptr, reinterpret_cast<uint8_t*>(target.data()), width * 4, area);
+    _mm_sfence();
+    CHECK(grid.hashes[0] == grid.hashes[1]);
+    CHECK(grid.hashes[0] != grid.hashes[2]);
+    CHECK(target == frame);
+}
+
+int main() {
+    TestDiffFrames();
+    TestTiles();
+    TestFused();
+    printf(failures ? "FAILED (%d)\n" : "OK\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// frameRingTest.cc - Checks the frame ring seqlock reader and the ring writer
+// in frameRing.h.
+//
+// Build and run (no X server or Node needed):
+//   g++ -std=c++17 -O2 -pthread -I../src frameRingTest.cc -o frameRingTest && ./frameRingTest
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "frameRing.h"
+
+using namespace frame_ring;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+static const size_t PIXELS = 4096;
+static const size_t SLOT_BYTES = FRAME_OFFSET + FRAME_HEADER_SIZE + PIXELS * 4;
+
+// Writes frame `n` the way WriteRingSlot does: every pixel byte and every
+// header field derives from n, so a torn read shows up as a mismatch.
+static void WriteFrame(uint8_t* slot, uint32_t n) {
+    int32_t seq = BeginWrite(slot);
+    int32_t* words = Words(slot);
+    uint8_t* pixels = slot + FRAME_OFFSET + FRAME_HEADER_SIZE;
+    memset(pixels, static_cast<int>(n & 0xFF), PIXELS * 4);
+    words[S_WIDTH] = static_cast<int32_t>(n);
+    words[S_HEIGHT] = static_cast<int32_t>(n + 1);
+    words[S_TIMESTAMP_LO] = static_cast<int32_t>(n * 3);
+    words[S_TIMESTAMP_HI] = 0;
+    words[S_FRAME_NUMBER] = static_cast<int32_t>(n);
+    EndWrite(slot, seq);
+}
+
+static void TestSingleThreaded() {
+    printf("single-threaded\n");
+    std::vector<uint8_t> slot(SLOT_BYTES, 0);
+    SlotHeader header;
+
+    WriteFrame(slot.data(), 7);
+    CHECK(BeginRead(slot.data(), header));
+    CHECK(header.sequence == 2);
+    CHECK(header.width == 7 && header.height == 8);
+    CHECK(header.timestamp_us == 21 && header.frame_number == 7);
+    CHECK(EndRead(slot.data(), header.sequence));
+
+    // Rewritten after the header was read: the reader must notice.
+    WriteFrame(slot.data(), 8);
+    CHECK(!EndRead(slot.data(), header.sequence));
+
+    // Writer in progress (odd sequence): the header must be rejected.
+    int32_t seq = BeginWrite(slot.data());
+    CHECK(seq & 1);
+    CHECK(!BeginRead(slot.data(), header));
+    EndWrite(slot.data(), seq);
+    CHECK(BeginRead(slot.data(), header));
+    CHECK(header.width == 8);
+}
+
+static void TestConcurrent() {
+    printf("concurrent writer\n");
+    std::vector<uint8_t> slot(SLOT_BYTES, 0);
+    WriteFrame(slot.data(), 0);
+    std::atomic<bool> stop(false);
+
+    std::thread writer([&] {
+        // Pause between frames like capture does, so some reads land between writes.
+        for (uint32_t n = 1; !stop.load(std::memory_order_relaxed); ++n) {
+            WriteFrame(slot.data(), n);
+            std::this_thread::sleep_for(std::chrono::microseconds(5));
+        }
+    });
+
+    std::vector<uint8_t> copy(PIXELS * 4);
+    int accepted = 0, rejected = 0, torn = 0;
+    for (int i = 0; i < 200000; ++i) {
+        SlotHeader header;
+        if (!BeginRead(slot.data(), header)) { ++rejected; continue; }
+        memcpy(copy.data(), slot.data() + FRAME_OFFSET + FRAME_HEADER_SIZE, copy.size());
+        if (!EndRead(slot.data(), header.sequence)) { ++rejected; continue; }
+        ++accepted;
+        const uint8_t expected = static_cast<uint8_t>(header.width & 0xFF);
+        bool ok = header.height == header.width + 1 && header.frame_number == static_cast<int32_t>(header.width) &&
+                  header.timestamp_us == static_cast<uint64_t>(header.width) * 3;
+        for (size_t p = 0; ok && p < copy.size(); p += 61) ok = copy[p] == expected;
+        if (!ok) ++torn;
+    }
+    stop = true;
+    writer.join();
+    printf("  accepted %d rejected %d torn %d\n", accepted, rejected, torn);
+    CHECK(accepted > 0);
+    CHECK(torn == 0);
+}
+
+// Publishes random partial updates through RingWriter with the plain rect
+// copy: every slot must end up identical to the frame it was written from,
+// however many frames it skipped.
+static void TestWriter() {
+    printf("writer\n");
+    using frame_update::Rect;
+    const uint32_t width = 64, height = 48;
+    const size_t frame_bytes = static_cast<size_t>(width) * height * 4;
+    const int slots = 3;
+    std::vector<uint8_t> memory(RING_HEADER_BYTES + slots * (FRAME_OFFSET + FRAME_HEADER_SIZE + frame_bytes + 63));
+    RingWriter ring;
+    CHECK(ring.Format(memory.data(), memory.size(), 1) != nullptr);
+    CHECK(ring.Format(memory.data(), RING_HEADER_BYTES, slots) != nullptr);
+    CHECK(ring.Format(memory.data(), memory.size(), slots) == nullptr);
+    CHECK(ring.MaxFrameBytes() >= frame_bytes + FRAME_HEADER_SIZE);
+    CHECK(Load(Words(memory.data()) + H_LATEST_SLOT) == -1 && ring.LatestFrame() == nullptr);
+
+    std::mt19937 rng(5);
+    std::vector<uint32_t> source(width * height, 0);
+    for (int n = 1; n <= 200; ++n) {
+        frame_update::FrameUpdate update;
+        update.width = width; update.height = height;
+        update.full_frame = n == 1 || rng() % 40 == 0;
+        if (update.full_frame) {
+            for (auto& p : source) p = rng();
+            update.rects.push_back({0, 0, (int)width, (int)height});
+        } else {
+            int count = rng() % 6;
+            for (int i = 0; i < count; ++i) {
+                int x = rng() % width, y = rng() % height;
+                Rect r = {x, y, 1 + (int)(rng() % (width - x)), 1 + (int)(rng() % (height - y))};
+                for (int yy = r.y; yy < r.y + r.height; ++yy) for (int xx = r.x; xx < r.x + r.width; ++xx) source[yy * width + xx] = rng();
+                update.rects.push_back(r);
+            }
+        }
+        update.areas.push_back({{0, 0, (int)width, (int)height}, reinterpret_cast<const uint8_t*>(source.data()), width * 4, 0, update.rects.size()});
+        ring.Write(update, 1000 + n, 8, [&](uint8_t* pixels, const uint8_t* previous, const std::vector<Rect>& stale_rects, bool stale_full) {
+            frame_update::ApplyFrameUpdate(pixels, previous, stale_rects, stale_full, update);
+        });
+
+        const int slot = ring.latest_slot.load();
+        CHECK(Load(Words(memory.data()) + H_LATEST_SLOT) == slot);
+        CHECK(Load(Words(memory.data()) + H_PUBLISH_COUNT) == n);
+        SlotHeader header;
+        CHECK(BeginRead(ring.Slot(slot), header));
+        CHECK(header.width == width && header.height == height);
+        CHECK(header.timestamp_us == static_cast<uint64_t>(1000 + n) && header.frame_number == n);
+        const int32_t* words = Words(ring.Slot(slot));
+        CHECK(words[S_DIRTY_COUNT] == (update.full_frame ? -1 : static_cast<int32_t>(update.rects.size())));
+        if (!update.full_frame && !update.rects.empty()) {
+            const int32_t* r = Words(ring.Slot(slot) + SLOT_RECTS_OFFSET);
+            CHECK(r[0] == update.rects[0].x && r[1] == update.rects[0].y && r[2] == update.rects[0].width && r[3] == update.rects[0].height);
+        }
+        const uint8_t* frame = ring.LatestFrame();
+        CHECK(memcmp(frame + FRAME_HEADER_SIZE, source.data(), frame_bytes) == 0);
+        CHECK(EndRead(ring.Slot(slot), header.sequence));
+    }
+}
+
+int main() {
+    TestSingleThreaded();
+    TestConcurrent();
+    TestWriter();
+    printf(failures ? "FAILED (%d)\n" : "OK\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+// sidePlanesTest.cc - Checks that the side planes in sidePlanes.h, refreshed
+// only where dirty rects say, match planes recomputed from scratch.
+//
+// Build and run (no X server or Node needed):
+//   g++ -std=c++17 -O2 -I../src -I../../common sidePlanesTest.cc -o sidePlanesTest && ./sidePlanesTest
+
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+
+#include "sidePlanes.h"
+
+using namespace side_planes;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); ++failures; } } while (0)
+
+static std::mt19937 rng(9);
+
+static const uint32_t COLORS[] = {0x102030, 0x00FF00, 0xFFFFFF, 0x000000, 0x123456};
+
+static uint32_t RandomPixel() { return 0xFF000000 | (rng() % 3 ? COLORS[rng() % 5] : rng()); }
+
+static void TestIncremental() {
+    printf("incremental\n");
+    for (int round = 0; round < 50; ++round) {
+        const int width = 1 + rng() % 120, height = 1 + rng() % 80;
+        const size_t stride = static_cast<size_t>(width) * 4;
+        std::vector<uint32_t> frame(width * height);
+        for (auto& p : frame) p = RandomPixel();
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(frame.data());
+
+        LumaPlane luma;
+        luma.SetScale(rng() % 2 ? 2 : 4);
+        PalettePlane palette;
+        palette.id = 1;
+        palette.rect.x = rng() % width; palette.rect.y = rng() % height;
+        palette.rect.width = 1 + rng() % (width - palette.rect.x); palette.rect.height = 1 + rng() % (height - palette.rect.y);
+        palette.keys.assign(COLORS, COLORS + 4);
+        palette.data.assign(static_cast<size_t>(palette.rect.width) * palette.rect.height, UNMATCHED_INDEX);
+        palette.valid = false; palette.timestamp_us = 0;
+
+        std::vector<Rect> none;
+        luma.Update(bytes, stride, width, height, none, true, 1);
+        palette.Update(bytes, stride, width, height, none, true, 1);
+        CHECK(luma.valid && palette.valid);
+
+        for (int frame_number = 2; frame_number < 20; ++frame_number) {
+            std::vector<Rect> rects;
+            int count = rng() % 4;
+            for (int i = 0; i < count; ++i) {
+                int x = rng() % width, y = rng() % height;
+                Rect r = {x, y, 1 + (int)(rng() % (width - x)), 1 + (int)(rng() % (height - y))};
+                for (int yy = r.y; yy < r.y + r.height; ++yy) for (int xx = r.x; xx < r.x + r.width; ++xx) frame[yy * width + xx] = RandomPixel();
+                rects.push_back(r);
+            }
+            luma.Update(bytes, stride, width, height, rects, false, frame_number);
+            palette.Update(bytes, stride, width, height, rects, false, frame_number);
+
+            LumaPlane fresh_luma;
+            fresh_luma.SetScale(luma.scale);
+            fresh_luma.Update(bytes, stride, width, height, none, true, frame_number);
+            CHECK(luma.data == fresh_luma.data);
+            CHECK(luma.timestamp_us == static_cast<uint64_t>(frame_number));
+
+            PalettePlane fresh_palette = palette;
+            fresh_palette.valid = false;
+            fresh_palette.Update(bytes, stride, width, height, none, false, frame_number);
+            CHECK(palette.data == fresh_palette.data);
+        }
+    }
+}
+
+static void TestEdges() {
+    printf("edges\n");
+    std::vector<uint32_t> frame(4 * 2, 0xFF102030);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(frame.data());
+    std::vector<Rect> none;
+
+    PalettePlane plane;
+    plane.rect = {2, 0, 3, 2}; // One column past a 4-pixel-wide frame.
+    plane.keys = {0x102030};
+    plane.data.assign(6, UNMATCHED_INDEX);
+    plane.valid = true; plane.timestamp_us = 0;
+    plane.Update(bytes, 16, 4, 2, none, true, 5);
+    CHECK(!plane.valid);
+
+    plane.rect = {1, 0, 3, 2};
+    plane.Update(bytes, 16, 4, 2, none, true, 6);
+    CHECK(plane.valid && plane.data == std::vector<uint8_t>(6, 0));
+
+    LumaPlane luma;
+    luma.SetScale(4);
+    luma.Update(bytes, 16, 4, 2, none, true, 1);
+    CHECK(luma.width == 1 && luma.height == 1 && luma.data.size() == 1);
+    luma.SetScale(0);
+    CHECK(!luma.valid && luma.data.empty() && luma.width == 0);
+    luma.Update(bytes, 16, 4, 2, none, true, 2);
+    CHECK(!luma.valid);
+}
+
+int main() {
+    TestIncremental();
+    TestEdges();
+    printf(failures ? "FAILED (%d)\n" : "OK\n", failures);
+    return failures ? 1 : 0;
+}
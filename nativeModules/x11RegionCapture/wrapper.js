@@ -1,2 +1,4 @@
 const x11RegionCaptureNative = require('./build/Release/x11RegionCapture.node');
+// Recorded sessions play back through the same frame API (see replay.js).
+x11RegionCaptureNative.FrameReplay = require('./replay.js').FrameReplay;
 module.exports = x11RegionCaptureNative;
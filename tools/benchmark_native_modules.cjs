@@ -10,11 +10,17 @@
  *   node tools/benchmark_native_modules.js findSequences
  *   node tools/benchmark_native_modules.js findHealthBars --iterations 1000
  *   node tools/benchmark_native_modules.js all --frame /tmp/frame.raw
+ *   node tools/benchmark_native_modules.js all --recording=/tmp/session.atfr
+ *
+ * --recording replays a session captured with X11RegionCapture.startRecording()
+ * (see nativeModules/x11RegionCapture/replay.js): every iteration runs on the
+ * next recorded frame, looping, and defaults to one pass over the recording.
  */
 
 const fs = require('fs');
 const path = require('path');
 const { performance } = require('perf_hooks');
+const { FrameReplay } = require('../nativeModules/x11RegionCapture/replay.js');
 
 // Module configurations
 const MODULES = {
@@ -91,8 +97,10 @@ const DEFAULT_FRAME = '/tmp/hb_mismatch_1760002760077.raw';
 // Parse command line arguments
 const args = process.argv.slice(2);
 const moduleName = args[0] || 'all';
-const iterations = parseInt(args.find(a => a.startsWith('--iterations='))?.split('=')[1] || '100');
 const framePath = args.find(a => a.startsWith('--frame='))?.split('=')[1] || DEFAULT_FRAME;
+const recordingPath = args.find(a => a.startsWith('--recording='))?.split('=')[1];
+const replay = recordingPath ? new FrameReplay(recordingPath, { loop: true }) : null;
+const iterations = parseInt(args.find(a => a.startsWith('--iterations='))?.split('=')[1] || (replay ? String(replay.frameCount) : '100'));
 const warmup = parseInt(args.find(a => a.startsWith('--warmup='))?.split('=')[1] || '10');
 const verbose = args.includes('--verbose') || args.includes('-v');
 
@@ -101,17 +109,23 @@ console.log('NATIVE MODULE PERFORMANCE BENCHMARK');
 console.log('='.repeat(80));
 console.log(`Iterations: ${iterations}`);
 console.log(`Warmup: ${warmup}`);
-console.log(`Frame: ${framePath}`);
+console.log(replay ? `Recording: ${recordingPath} (${replay.frameCount} frames)` : `Frame: ${framePath}`);
 console.log('');
 
 // Load test frame
-if (!fs.existsSync(framePath)) {
+if (!replay && !fs.existsSync(framePath)) {
   console.error(`❌ Frame file not found: ${framePath}`);
   console.error('Please provide a valid frame dump with --frame=path');
   process.exit(1);
 }
 
-const frameData = fs.readFileSync(framePath);
+// In replay mode frameData is the replay's decode buffer: nextFrame() decodes
+// the next recorded frame into it in place, so parameters built once stay valid.
+const frameData = replay ? replay.frameBuffer : fs.readFileSync(framePath);
+function nextFrame() {
+  if (replay) replay.getLatestFrame();
+}
+nextFrame();
 const width = frameData.readUInt32LE(0);
 const height = frameData.readUInt32LE(4);
 
@@ -165,6 +179,7 @@ function benchmarkModule(name, config) {
   // Warmup
   if (verbose) console.log('Warming up...');
   for (let i = 0; i < warmup; i++) {
+    nextFrame();
     try {
       testFunction(...params);
     } catch (error) {
@@ -180,6 +195,7 @@ function benchmarkModule(name, config) {
   if (verbose) console.log(`Running ${iterations} iterations...`);
   
   for (let i = 0; i < iterations; i++) {
+    nextFrame();
     const start = performance.now();
     try {
       result = testFunction(...params);